@@ -0,0 +1,390 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+
+#include "BatchProcessing.hpp"
+#include "Cascades.hpp"
+#include "CvUtils.hpp"
+#include "DebugTap.hpp"
+#include "EyeDetectors.hpp"
+#include "ThreadPool.hpp"
+#include "Utils.hpp"
+
+
+// cascade classifiers can't be shared between threads, every worker loads its own copy once
+WorkerCascades& getWorkerCascades(const CascadeFile& faceCascadeFile, const CascadeFile& eyesCascadeFile)
+{
+	thread_local std::unique_ptr<WorkerCascades> workerCascades;
+
+	if (!workerCascades)
+	{
+		workerCascades = std::make_unique<WorkerCascades>();
+		workerCascades->face_cascade = loadCascade(faceCascadeFile, "face");
+		workerCascades->eyes_cascade = loadCascade(eyesCascadeFile, "eyes");
+	}
+
+	return *workerCascades;
+}
+
+
+bool isImageFile(const std::filesystem::path& filePath)
+{
+	std::string extension = filePath.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	return extension == ".jpg" || extension == ".jpeg" || extension == ".png";
+}
+
+
+// the innermost folder with the dataset prefix, empty if the image is outside any dataset
+std::string getDatasetName(const std::string& imagePath)
+{
+	std::string datasetName;
+
+	for (const std::filesystem::path& pathPart : std::filesystem::path(imagePath).parent_path())
+	{
+		if (pathPart.string().rfind(BATCH_DATASET_PREFIX, 0) == 0)
+		{
+			datasetName = pathPart.string();
+		}
+	}
+
+	return datasetName;
+}
+
+
+std::vector<std::string> findDatasetImages(const std::string& rootPath)
+{
+	std::vector<std::string> imagePaths;
+
+	for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(rootPath))
+	{
+		if (entry.is_regular_file() && isImageFile(entry.path()) && !getDatasetName(entry.path().string()).empty())
+		{
+			imagePaths.push_back(entry.path().string());
+		}
+	}
+
+	std::sort(imagePaths.begin(), imagePaths.end());
+
+	return imagePaths;
+}
+
+
+// one Parameters copy per sclera:pupil pair of batch_detector_variants, unknown names fail before any image is processed
+std::vector<Parameters> getBatchVariantsParameters(const Parameters& parameters)
+{
+	std::vector<Parameters> variantsParameters;
+	std::stringstream variantsStream(parameters.batchDetectorVariants);
+	std::string variant;
+
+	while (std::getline(variantsStream, variant, ','))
+	{
+		size_t separatorIndex = variant.find(':');
+
+		if (separatorIndex == std::string::npos)
+		{
+			throw std::runtime_error("Bad detector variant: " + variant);
+		}
+
+		Parameters variantParameters = parameters;
+		variantParameters.detectors.scleraDetector = variant.substr(0, separatorIndex);
+		variantParameters.detectors.pupilDetector = variant.substr(separatorIndex + 1);
+		resolveEyeDetectors(variantParameters);
+
+		variantsParameters.push_back(variantParameters);
+	}
+
+	if (variantsParameters.empty())
+	{
+		variantsParameters.push_back(parameters);
+	}
+
+	return variantsParameters;
+}
+
+
+// faces and eyes are detected once, every detector variant processes the same eyes of the same decoded frame
+BatchImageResult processBatchImage(const std::string& imagePath, const CascadeFile& faceCascadeFile, const CascadeFile& eyesCascadeFile, const Parameters& parameters, const std::vector<Parameters>& variantsParameters)
+{
+	BatchImageResult imageResult;
+	imageResult.imagePath = imagePath;
+
+	cv::Mat image = readImageMapped(imagePath);
+
+	if (image.empty())
+	{
+		return imageResult;
+	}
+
+	imageResult.isDecoded = true;
+
+	WorkerCascades& workerCascades = getWorkerCascades(faceCascadeFile, eyesCascadeFile);
+	FaceTrackingState trackingState;
+
+	std::vector<FaceDetectionResult> faceResults = detectFacesAndEyes(workerCascades.face_cascade, workerCascades.eyes_cascade, image, trackingState, parameters);
+
+	for (const Parameters& variantParameters : variantsParameters)
+	{
+		BatchVariantResult variantResult;
+		variantResult.faceResults = faceResults;
+
+		int64 startTicks = cv::getTickCount();
+		processEyes(image, variantResult.faceResults, variantParameters);
+		variantResult.eyeProcessingTicks = cv::getTickCount() - startTicks;
+
+		imageResult.variantResults.push_back(variantResult);
+	}
+
+	imageResult.faceResults = imageResult.variantResults[0].faceResults;
+	imageResult.eyeCandidatesCount = trackingState.statistics.eyeCandidatesCount;
+	imageResult.skippedEyeCandidatesCount = trackingState.statistics.skippedEyeCandidatesCount;
+
+	return imageResult;
+}
+
+
+void runBatchProcessing(const CascadeFile& faceCascadeFile, const CascadeFile& eyesCascadeFile, const Parameters& parameters)
+{
+	// headless mode, debug windows can't be shown from workers
+	setDebugTapSink(nullptr);
+
+	std::vector<std::string> imagePaths = findDatasetImages(BATCH_DATASETS_ROOT_PATH);
+
+	std::vector<Parameters> variantsParameters = getBatchVariantsParameters(parameters);
+
+	ThreadPool& threadPool = getProcessingThreadPool();
+
+	int64 startTicks = cv::getTickCount();
+
+	// bounded, so only a few decoded images are alive and waiting tasks find no other images to nest
+	std::vector<BatchImageResult> imageResults = threadPool.map(imagePaths.size(), [&](size_t imageIndex) {
+		return processBatchImage(imagePaths[imageIndex], faceCascadeFile, eyesCascadeFile, parameters, variantsParameters);
+	});
+
+	double elapsedSeconds = ticksToMilliseconds(cv::getTickCount() - startTicks) / 1000.0;
+
+	writeBatchResults(BATCH_RESULTS_FILE_NAME, imageResults);
+
+	std::cout << "Batch images/threads : " << imageResults.size() << "/" << threadPool.getThreadsCount() << std::endl;
+	std::cout << "Batch time, s : " << elapsedSeconds << std::endl;
+	std::cout << "Batch throughput, images/s : " << (elapsedSeconds > 0 ? imageResults.size() / elapsedSeconds : 0.0) << std::endl;
+
+	printBatchEyeCandidates(imageResults);
+	printBatchPupilRefinement(imageResults);
+
+	if (variantsParameters.size() > 1)
+	{
+		writeBatchVariantResults(BATCH_VARIANT_RESULTS_FILE_NAME, imageResults, variantsParameters);
+		printBatchVariants(imageResults, variantsParameters);
+	}
+}
+
+
+// eye rects found by the cascade against the ones that didn't get the eye processing, per dataset
+void printBatchEyeCandidates(const std::vector<BatchImageResult>& imageResults)
+{
+	std::map<std::string, std::pair<int64, int64>> datasetEyeCandidates;
+
+	for (const BatchImageResult& imageResult : imageResults)
+	{
+		std::pair<int64, int64>& eyeCandidates = datasetEyeCandidates[getDatasetName(imageResult.imagePath)];
+		eyeCandidates.first += imageResult.eyeCandidatesCount;
+		eyeCandidates.second += imageResult.skippedEyeCandidatesCount;
+	}
+
+	for (const auto& datasetCandidates : datasetEyeCandidates)
+	{
+		std::cout << datasetCandidates.first << " : eye candidates/skipped eye analyses " <<
+			datasetCandidates.second.first << "/" << datasetCandidates.second.second << std::endl;
+	}
+}
+
+
+// mean and worst sub-pixel pupil refinement time per eye, per dataset
+void printBatchPupilRefinement(const std::vector<BatchImageResult>& imageResults)
+{
+	struct RefinementTicks
+	{
+		int64 eyesCount = 0;
+		int64 ticksSum = 0;
+		int64 maxTicks = 0;
+	};
+
+	std::map<std::string, RefinementTicks> datasetRefinementTicks;
+
+	for (const BatchImageResult& imageResult : imageResults)
+	{
+		RefinementTicks& refinementTicks = datasetRefinementTicks[getDatasetName(imageResult.imagePath)];
+
+		for (const FaceDetectionResult& faceResult : imageResult.faceResults)
+		{
+			for (const EyeDetectionResult& eyeResult : faceResult.eyes)
+			{
+				refinementTicks.eyesCount++;
+				refinementTicks.ticksSum += eyeResult.eyeCenters.pupilRefinementTicks;
+				refinementTicks.maxTicks = std::max(refinementTicks.maxTicks, eyeResult.eyeCenters.pupilRefinementTicks);
+			}
+		}
+	}
+
+	for (const auto& datasetTicks : datasetRefinementTicks)
+	{
+		const RefinementTicks& refinementTicks = datasetTicks.second;
+		int64 meanTicks = refinementTicks.eyesCount > 0 ? refinementTicks.ticksSum / refinementTicks.eyesCount : 0;
+
+		std::cout << datasetTicks.first << " : pupil refinement per eye mean/max, us " <<
+			ticksToMicroseconds(meanTicks) << "/" << ticksToMicroseconds(refinementTicks.maxTicks) << std::endl;
+	}
+}
+
+
+// one line per eye in frame coordinates, images without faces and faces without eyes get a line with empty fields
+void writeBatchResults(const std::string& filePath, const std::vector<BatchImageResult>& imageResults)
+{
+	std::ofstream fout(filePath);
+
+	if (!fout.is_open())
+	{
+		throw std::runtime_error("Can't write file: " + filePath);
+	}
+
+	fout << "image,decoded,face_index,face_x,face_y,face_width,face_height," <<
+		"eye_index,eye_x,eye_y,eye_width,eye_height,sclera_x,sclera_y,sclera_found,pupil_x,pupil_y,pupil_found," <<
+		"pupil_refined_x,pupil_refined_y,pupil_refinement_us" << std::endl;
+
+	for (const BatchImageResult& imageResult : imageResults)
+	{
+		std::string imagePrefix = quoteCsvField(imageResult.imagePath) + "," + (imageResult.isDecoded ? "1" : "0");
+
+		if (imageResult.faceResults.empty())
+		{
+			fout << imagePrefix << ",,,,,,,,,,,,,,,,,,," << std::endl;
+			continue;
+		}
+
+		for (size_t faceIndex = 0; faceIndex < imageResult.faceResults.size(); faceIndex++)
+		{
+			const FaceDetectionResult& faceResult = imageResult.faceResults[faceIndex];
+			const cv::Rect& faceRect = faceResult.faceRect;
+
+			std::stringstream facePrefixStream;
+			facePrefixStream << imagePrefix << "," << faceIndex << "," <<
+				faceRect.x << "," << faceRect.y << "," << faceRect.width << "," << faceRect.height;
+			std::string facePrefix = facePrefixStream.str();
+
+			if (faceResult.eyes.empty())
+			{
+				fout << facePrefix << ",,,,,,,,,,,,,," << std::endl;
+				continue;
+			}
+
+			for (const EyeDetectionResult& eyeResult : faceResult.eyes)
+			{
+				cv::Rect eyeRect = getEyeFrameRect(faceResult, eyeResult);
+				cv::Point scleraCenter = getEyeFramePoint(faceResult, eyeResult, eyeResult.eyeCenters.scleraCenter);
+				cv::Point pupilCenter = getEyeFramePoint(faceResult, eyeResult, eyeResult.eyeCenters.pupilCenter);
+				cv::Point2f refinedPupilCenter = getEyeFramePoint(faceResult, eyeResult, eyeResult.eyeCenters.refinedPupilCenter);
+
+				fout << facePrefix << "," << eyeResult.eyeIndex << "," <<
+					eyeRect.x << "," << eyeRect.y << "," << eyeRect.width << "," << eyeRect.height << "," <<
+					scleraCenter.x << "," << scleraCenter.y << "," << (eyeResult.eyeCenters.isScleraFound ? "1" : "0") << "," <<
+					pupilCenter.x << "," << pupilCenter.y << "," << (eyeResult.eyeCenters.isPupilFound ? "1" : "0") << "," <<
+					refinedPupilCenter.x << "," << refinedPupilCenter.y << "," <<
+					ticksToMicroseconds(eyeResult.eyeCenters.pupilRefinementTicks) << std::endl;
+			}
+		}
+	}
+}
+
+
+// eye processing time and center shift against the first variant, per detector variant
+void printBatchVariants(const std::vector<BatchImageResult>& imageResults, const std::vector<Parameters>& variantsParameters)
+{
+	for (size_t variantIndex = 0; variantIndex < variantsParameters.size(); variantIndex++)
+	{
+		int64 eyesCount = 0;
+		int64 eyeProcessingTicksSum = 0;
+		double scleraShiftSum = 0;
+		double pupilShiftSum = 0;
+
+		for (const BatchImageResult& imageResult : imageResults)
+		{
+			if (imageResult.variantResults.empty())
+			{
+				continue;
+			}
+
+			const BatchVariantResult& variantResult = imageResult.variantResults[variantIndex];
+			const BatchVariantResult& firstVariantResult = imageResult.variantResults[0];
+			eyeProcessingTicksSum += variantResult.eyeProcessingTicks;
+
+			for (size_t faceIndex = 0; faceIndex < variantResult.faceResults.size(); faceIndex++)
+			{
+				const std::vector<EyeDetectionResult>& eyes = variantResult.faceResults[faceIndex].eyes;
+				const std::vector<EyeDetectionResult>& firstVariantEyes = firstVariantResult.faceResults[faceIndex].eyes;
+
+				for (size_t eyeIndex = 0; eyeIndex < eyes.size(); eyeIndex++)
+				{
+					const EyeCenters& eyeCenters = eyes[eyeIndex].eyeCenters;
+					const EyeCenters& firstVariantEyeCenters = firstVariantEyes[eyeIndex].eyeCenters;
+
+					eyesCount++;
+					scleraShiftSum += cv::norm(cv::Point2d(eyeCenters.scleraCenter - firstVariantEyeCenters.scleraCenter));
+					pupilShiftSum += cv::norm(cv::Point2d(eyeCenters.pupilCenter - firstVariantEyeCenters.pupilCenter));
+				}
+			}
+		}
+
+		double meanEyeMicroseconds = eyesCount > 0 ? ticksToMicroseconds(eyeProcessingTicksSum) / (double)eyesCount : 0.0;
+
+		std::cout << "Detectors " << getEyeDetectorsName(variantsParameters[variantIndex].detectors) << " : eyes " << eyesCount <<
+			", eye processing, ms " << ticksToMilliseconds(eyeProcessingTicksSum) << ", per eye, us " << meanEyeMicroseconds <<
+			", mean sclera/pupil shift, px " << (eyesCount > 0 ? scleraShiftSum / eyesCount : 0.0) << "/" <<
+			(eyesCount > 0 ? pupilShiftSum / eyesCount : 0.0) << std::endl;
+	}
+}
+
+
+// one line per eye and detector variant in frame coordinates, eyes are the same for every variant
+void writeBatchVariantResults(const std::string& filePath, const std::vector<BatchImageResult>& imageResults, const std::vector<Parameters>& variantsParameters)
+{
+	std::ofstream fout(filePath);
+
+	if (!fout.is_open())
+	{
+		throw std::runtime_error("Can't write file: " + filePath);
+	}
+
+	fout << "image,detectors,eye_processing_us,face_index,eye_index,sclera_x,sclera_y,sclera_found,pupil_x,pupil_y,pupil_found,pupil_refined_x,pupil_refined_y" << std::endl;
+
+	for (const BatchImageResult& imageResult : imageResults)
+	{
+		for (size_t variantIndex = 0; variantIndex < imageResult.variantResults.size(); variantIndex++)
+		{
+			const BatchVariantResult& variantResult = imageResult.variantResults[variantIndex];
+			std::string variantPrefix = quoteCsvField(imageResult.imagePath) + "," + getEyeDetectorsName(variantsParameters[variantIndex].detectors) + "," +
+				std::to_string(ticksToMicroseconds(variantResult.eyeProcessingTicks));
+
+			for (size_t faceIndex = 0; faceIndex < variantResult.faceResults.size(); faceIndex++)
+			{
+				const FaceDetectionResult& faceResult = variantResult.faceResults[faceIndex];
+
+				for (const EyeDetectionResult& eyeResult : faceResult.eyes)
+				{
+					cv::Point scleraCenter = getEyeFramePoint(faceResult, eyeResult, eyeResult.eyeCenters.scleraCenter);
+					cv::Point pupilCenter = getEyeFramePoint(faceResult, eyeResult, eyeResult.eyeCenters.pupilCenter);
+					cv::Point2f refinedPupilCenter = getEyeFramePoint(faceResult, eyeResult, eyeResult.eyeCenters.refinedPupilCenter);
+
+					fout << variantPrefix << "," << faceIndex << "," << eyeResult.eyeIndex << "," <<
+						scleraCenter.x << "," << scleraCenter.y << "," << (eyeResult.eyeCenters.isScleraFound ? "1" : "0") << "," <<
+						pupilCenter.x << "," << pupilCenter.y << "," << (eyeResult.eyeCenters.isPupilFound ? "1" : "0") << "," <<
+						refinedPupilCenter.x << "," << refinedPupilCenter.y << std::endl;
+				}
+			}
+		}
+	}
+}
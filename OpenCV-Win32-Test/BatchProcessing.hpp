@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Constants.hpp"
+#include "FaceProcessing.hpp"
+
+
+struct WorkerCascades
+{
+	DetectionCascade face_cascade;
+	DetectionCascade eyes_cascade;
+};
+
+
+// eye processing of the frame eyes with one sclera:pupil detector pair
+struct BatchVariantResult
+{
+	std::vector<FaceDetectionResult> faceResults;
+	int64 eyeProcessingTicks = 0;
+};
+
+
+struct BatchImageResult
+{
+	std::string imagePath;
+	bool isDecoded = false;
+	std::vector<FaceDetectionResult> faceResults; // first detector variant
+	std::vector<BatchVariantResult> variantResults; // one per detector variant, empty if not decoded
+	int64 eyeCandidatesCount = 0;
+	int64 skippedEyeCandidatesCount = 0;
+};
+
+
+WorkerCascades& getWorkerCascades(const CascadeFile& faceCascadeFile, const CascadeFile& eyesCascadeFile);
+std::string getDatasetName(const std::string& imagePath);
+std::vector<std::string> findDatasetImages(const std::string& rootPath);
+std::vector<Parameters> getBatchVariantsParameters(const Parameters& parameters);
+void runBatchProcessing(const CascadeFile& faceCascadeFile, const CascadeFile& eyesCascadeFile, const Parameters& parameters);
+void printBatchEyeCandidates(const std::vector<BatchImageResult>& imageResults);
+void printBatchPupilRefinement(const std::vector<BatchImageResult>& imageResults);
+void writeBatchResults(const std::string& filePath, const std::vector<BatchImageResult>& imageResults);
+void printBatchVariants(const std::vector<BatchImageResult>& imageResults, const std::vector<Parameters>& variantsParameters);
+void writeBatchVariantResults(const std::string& filePath, const std::vector<BatchImageResult>& imageResults, const std::vector<Parameters>& variantsParameters);
@@ -0,0 +1,990 @@
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+
+#include <opencv2/imgproc.hpp>
+
+#include "Benchmark.hpp"
+#include "BatchProcessing.hpp"
+#include "Cascades.hpp"
+#include "CvUtils.hpp"
+#include "DebugTap.hpp"
+#include "EyeChannels.hpp"
+#include "EyeDetectors.hpp"
+#include "EyeProcessing.hpp"
+#include "FaceProcessing.hpp"
+#include "FaceTracking.hpp"
+#include "FrameArena.hpp"
+#include "FusedEyeProcessing.hpp"
+#include "HeapCounter.hpp"
+#include "MaskMorphology.hpp"
+#include "Utils.hpp"
+
+
+CountingMatAllocator::CountingMatAllocator(cv::MatAllocator* wrappedAllocator) :
+	wrappedAllocator(wrappedAllocator),
+	allocationsCount(0),
+	allocatedBytesCount(0)
+{
+}
+
+
+cv::UMatData* CountingMatAllocator::allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const
+{
+	cv::UMatData* allocatedData = wrappedAllocator->allocate(dims, sizes, type, data, step, flags, usageFlags);
+
+	// user provided buffers aren't allocations
+	if (allocatedData && !data)
+	{
+		allocationsCount++;
+		allocatedBytesCount += allocatedData->size;
+	}
+
+	return allocatedData;
+}
+
+
+bool CountingMatAllocator::allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const
+{
+	return wrappedAllocator->allocate(data, accessFlags, usageFlags);
+}
+
+
+void CountingMatAllocator::deallocate(cv::UMatData* data) const
+{
+	wrappedAllocator->deallocate(data);
+}
+
+
+int64 CountingMatAllocator::getAllocationsCount() const
+{
+	return allocationsCount;
+}
+
+
+int64 CountingMatAllocator::getAllocatedBytesCount() const
+{
+	return allocatedBytesCount;
+}
+
+
+struct BenchmarkRecorder
+{
+	const CountingMatAllocator* allocator = nullptr;
+	std::vector<BenchmarkStage> stages;
+	std::vector<FaceResolutionComparison> faceResolutionComparisons;
+	std::vector<EqualizationComparison> equalizationComparisons;
+	std::vector<EyeLocalizationComparison> eyeLocalizationComparisons;
+	std::vector<HaarCascadeComparison> haarCascadeComparisons;
+	std::string datasetName;
+	bool isRecording = false;
+};
+
+
+BenchmarkStage& getBenchmarkStage(BenchmarkRecorder& recorder, const std::string& stageName)
+{
+	for (BenchmarkStage& stage : recorder.stages)
+	{
+		if (stage.datasetName == recorder.datasetName && stage.stageName == stageName)
+		{
+			return stage;
+		}
+	}
+
+	BenchmarkStage stage;
+	stage.datasetName = recorder.datasetName;
+	stage.stageName = stageName;
+	recorder.stages.push_back(stage);
+
+	return recorder.stages.back();
+}
+
+
+// only the stage call is measured, inputs are prepared by the caller
+template <typename Stage>
+void measureBenchmarkStage(BenchmarkRecorder& recorder, const std::string& stageName, Stage&& stage)
+{
+	int64 allocationsCount = recorder.allocator->getAllocationsCount();
+	int64 allocatedBytesCount = recorder.allocator->getAllocatedBytesCount();
+	int64 heapAllocationsCount = getHeapAllocationsCount();
+	int64 heapAllocatedBytesCount = getHeapAllocatedBytesCount();
+	int64 startTicks = cv::getTickCount();
+
+	stage();
+
+	int64 ticks = cv::getTickCount() - startTicks;
+
+	if (!recorder.isRecording)
+	{
+		return; // warm up
+	}
+
+	BenchmarkSample sample;
+	sample.milliseconds = ticksToMilliseconds(ticks);
+	sample.allocationsCount = recorder.allocator->getAllocationsCount() - allocationsCount;
+	sample.allocatedBytesCount = recorder.allocator->getAllocatedBytesCount() - allocatedBytesCount;
+	sample.heapAllocationsCount = getHeapAllocationsCount() - heapAllocationsCount;
+	sample.heapAllocatedBytesCount = getHeapAllocatedBytesCount() - heapAllocatedBytesCount;
+
+	getBenchmarkStage(recorder, stageName).samples.push_back(sample);
+}
+
+
+struct BenchmarkEye
+{
+	cv::Mat eyeRoi;
+	cv::Mat cutEyeImage;
+	cv::Mat hue;
+	cv::Mat saturation;
+	cv::Mat value;
+};
+
+
+struct BenchmarkImage
+{
+	std::string imagePath;
+	cv::Mat image;
+	cv::Mat processingImage; // equalized grayscale
+	std::vector<cv::Rect> faceRects;
+	std::vector<FaceDetectionResult> faceResults;
+	std::vector<BenchmarkEye> eyes;
+};
+
+
+// detection results are computed once, every stage is then measured on the same inputs
+BenchmarkImage prepareBenchmarkImage(const std::string& imagePath, DetectionCascade& face_cascade, DetectionCascade& eyes_cascade, const Parameters& parameters)
+{
+	BenchmarkImage benchmarkImage;
+	benchmarkImage.imagePath = imagePath;
+
+	cv::Mat image = readImageMapped(imagePath);
+
+	if (image.empty())
+	{
+		throw std::runtime_error("Can't read benchmark image: " + imagePath);
+	}
+
+	cv::cvtColor(image, benchmarkImage.processingImage, cv::COLOR_BGR2GRAY);
+	cv::equalizeHist(benchmarkImage.processingImage, benchmarkImage.processingImage);
+
+	FaceTrackingState trackingState;
+	std::vector<FaceDetectionResult> faceResults = detectFacesAndEyes(face_cascade, eyes_cascade, image, trackingState, parameters);
+	benchmarkImage.image = image;
+	benchmarkImage.faceResults = faceResults;
+
+	for (const FaceDetectionResult& faceResult : faceResults)
+	{
+		benchmarkImage.faceRects.push_back(faceResult.faceRect);
+
+		for (const EyeDetectionResult& eyeResult : faceResult.eyes)
+		{
+			BenchmarkEye eye;
+			eye.eyeRoi = image(getEyeFrameRect(faceResult, eyeResult));
+			eye.cutEyeImage = eye.eyeRoi(getEyeCutRowsRange(eye.eyeRoi, parameters.eye), cv::Range(0, eye.eyeRoi.cols));
+
+			cv::Mat hsvImage;
+			cv::cvtColor(eye.cutEyeImage, hsvImage, cv::COLOR_BGR2HSV);
+
+			std::vector<cv::Mat> separatedChannels;
+			cv::split(hsvImage, separatedChannels);
+
+			eye.hue = separatedChannels[0];
+			eye.saturation = separatedChannels[1];
+			eye.value = separatedChannels[2];
+
+			benchmarkImage.eyes.push_back(eye);
+		}
+	}
+
+	return benchmarkImage;
+}
+
+
+std::vector<std::string> getBenchmarkImagePaths(const std::string& datasetName)
+{
+	std::vector<std::string> imagePaths;
+
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(datasetName))
+	{
+		if (entry.is_regular_file())
+		{
+			imagePaths.push_back(entry.path().string());
+		}
+	}
+
+	std::sort(imagePaths.begin(), imagePaths.end());
+
+	return imagePaths;
+}
+
+
+void measureCascadeLoad(BenchmarkRecorder& recorder, const CascadeFile& faceCascadeFile, const CascadeFile& eyesCascadeFile)
+{
+	recorder.datasetName = "-";
+	recorder.isRecording = true;
+
+	std::string faceCascadeSourceContent = readCascadeSource(FACE_CASCADE_FILE_NAME);
+	std::string eyesCascadeSourceContent = readCascadeSource(EYES_CASCADE_FILE_NAME);
+
+	for (int iteration = 0; iteration < BENCHMARK_CASCADE_LOAD_ITERATIONS_COUNT; iteration++)
+	{
+		measureBenchmarkStage(recorder, "face cascade read", []() {
+			readCascade(FACE_CASCADE_FILE_NAME);
+		});
+		measureBenchmarkStage(recorder, "face cascade source parse", [&faceCascadeSourceContent]() {
+			parseCascadeSource(faceCascadeSourceContent);
+		});
+		measureBenchmarkStage(recorder, "face cascade load", [&faceCascadeFile]() {
+			loadCascade(faceCascadeFile, "face");
+		});
+		measureBenchmarkStage(recorder, "eyes cascade read", []() {
+			readCascade(EYES_CASCADE_FILE_NAME);
+		});
+		measureBenchmarkStage(recorder, "eyes cascade source parse", [&eyesCascadeSourceContent]() {
+			parseCascadeSource(eyesCascadeSourceContent);
+		});
+		measureBenchmarkStage(recorder, "eyes cascade load", [&eyesCascadeFile]() {
+			loadCascade(eyesCascadeFile, "eyes");
+		});
+	}
+}
+
+
+// reference rects overlapped by a found rect with IoU >= 0.5, their IoU is added to the sum
+int matchRects(const std::vector<cv::Rect>& referenceRects, const std::vector<cv::Rect>& rects, double& matchedIntersectionOverUnionSum)
+{
+	int matchedCount = 0;
+
+	for (const cv::Rect& referenceRect : referenceRects)
+	{
+		double bestIntersectionOverUnion = 0.0;
+
+		for (const cv::Rect& rect : rects)
+		{
+			bestIntersectionOverUnion = std::max(bestIntersectionOverUnion, getIntersectionOverUnion(referenceRect, rect));
+		}
+
+		if (bestIntersectionOverUnion >= 0.5)
+		{
+			matchedCount++;
+			matchedIntersectionOverUnionSum += bestIntersectionOverUnion;
+		}
+	}
+
+	return matchedCount;
+}
+
+
+void compareFaceDetectionResolutions(BenchmarkRecorder& recorder, const std::vector<BenchmarkImage>& benchmarkImages, DetectionCascade& face_cascade, const FaceDetectionParameters& parameters)
+{
+	FaceResolutionComparison comparison;
+	comparison.datasetName = recorder.datasetName;
+
+	for (const BenchmarkImage& benchmarkImage : benchmarkImages)
+	{
+		const cv::Mat& processingImage = benchmarkImage.processingImage;
+		cv::Size minFaceSize = getMinFaceSize(processingImage.size(), parameters);
+		cv::Size maxFaceSize = getMaxFaceSize(processingImage.size(), parameters);
+		comparison.workingScale = getFaceDetectionWorkingScale(minFaceSize, parameters);
+
+		std::vector<cv::Rect> referenceFaceRects;
+		detectFacesScaled(face_cascade, processingImage, 1.0, minFaceSize, maxFaceSize, parameters, referenceFaceRects);
+
+		std::vector<cv::Rect> workingFaceRects;
+		detectFacesScaled(face_cascade, processingImage, comparison.workingScale, minFaceSize, maxFaceSize, parameters, workingFaceRects);
+
+		comparison.referenceFacesCount += (int)referenceFaceRects.size();
+		comparison.workingFacesCount += (int)workingFaceRects.size();
+		comparison.matchedFacesCount += matchRects(referenceFaceRects, workingFaceRects, comparison.matchedIntersectionOverUnionSum);
+	}
+
+	recorder.faceResolutionComparisons.push_back(comparison);
+}
+
+
+// face and eye detections of one image with the given detector
+template <typename Detect>
+std::vector<cv::Rect> detectBenchmarkObjects(const BenchmarkImage& benchmarkImage, const Parameters& parameters, Detect&& detect)
+{
+	const cv::Mat& processingImage = benchmarkImage.processingImage;
+	std::vector<cv::Rect> objects;
+
+	detect(true, processingImage, parameters.face.scaleFactor, parameters.face.minNeighbours,
+		getMinFaceSize(processingImage.size(), parameters.face), getMaxFaceSize(processingImage.size(), parameters.face), objects);
+
+	for (const cv::Rect& faceRect : benchmarkImage.faceRects)
+	{
+		std::vector<cv::Rect> eyeRects;
+		detect(false, processingImage(faceRect), parameters.eye.scaleFactor, parameters.eye.minNeighbours, cv::Size(), cv::Size(), eyeRects);
+		objects.insert(objects.end(), eyeRects.begin(), eyeRects.end());
+	}
+
+	return objects;
+}
+
+
+void compareHaarCascades(BenchmarkRecorder& recorder, const std::vector<BenchmarkImage>& benchmarkImages, DetectionCascade& face_cascade, DetectionCascade& eyes_cascade, const Parameters& parameters)
+{
+	HaarCascadeComparison comparison;
+	comparison.datasetName = recorder.datasetName;
+
+	auto detectStock = [&face_cascade, &eyes_cascade](bool isFace, const cv::Mat& image, double scaleFactor, int minNeighbours, const cv::Size& minSize, const cv::Size& maxSize, std::vector<cv::Rect>& objects) {
+		(isFace ? face_cascade : eyes_cascade).classifier.detectMultiScale(image, objects, scaleFactor, minNeighbours, 0, minSize, maxSize);
+	};
+	auto detectHaar = [&face_cascade, &eyes_cascade](bool isFace, const cv::Mat& image, double scaleFactor, int minNeighbours, const cv::Size& minSize, const cv::Size& maxSize, std::vector<cv::Rect>& objects) {
+		detectHaarCascade((isFace ? face_cascade : eyes_cascade).haarCascade, image, objects, scaleFactor, minNeighbours, minSize, maxSize);
+	};
+
+	for (int iteration = 0; iteration < BENCHMARK_ITERATIONS_COUNT; iteration++)
+	{
+		for (const BenchmarkImage& benchmarkImage : benchmarkImages)
+		{
+			comparison.imageSize = benchmarkImage.processingImage.size();
+
+			int64 startTicks = cv::getTickCount();
+			std::vector<cv::Rect> stockObjects = detectBenchmarkObjects(benchmarkImage, parameters, detectStock);
+			comparison.stockTicksSum += cv::getTickCount() - startTicks;
+
+			startTicks = cv::getTickCount();
+			std::vector<cv::Rect> haarObjects = detectBenchmarkObjects(benchmarkImage, parameters, detectHaar);
+			comparison.haarTicksSum += cv::getTickCount() - startTicks;
+
+			comparison.mismatchedFramesCount += !isSameRects(stockObjects, haarObjects);
+			comparison.framesCount++;
+		}
+	}
+
+	recorder.haarCascadeComparisons.push_back(comparison);
+}
+
+
+// the equalizer keeps its state over the loops, so it reaches the steady state of a video stream
+void compareEqualization(BenchmarkRecorder& recorder, const std::vector<BenchmarkImage>& benchmarkImages, DetectionCascade& face_cascade, const FaceDetectionParameters& parameters)
+{
+	EqualizationComparison comparison;
+	comparison.datasetName = recorder.datasetName;
+
+	TemporalEqualizer equalizer;
+	cv::Mat grayscaleImage;
+	cv::Mat exactImage;
+	cv::Mat temporalImage;
+
+	for (int iteration = 0; iteration < BENCHMARK_ITERATIONS_COUNT; iteration++)
+	{
+		for (const BenchmarkImage& benchmarkImage : benchmarkImages)
+		{
+			cv::cvtColor(benchmarkImage.image, grayscaleImage, cv::COLOR_BGR2GRAY);
+
+			int64 startTicks = cv::getTickCount();
+			cv::equalizeHist(grayscaleImage, exactImage);
+			comparison.exactTicksSum += cv::getTickCount() - startTicks;
+
+			startTicks = cv::getTickCount();
+			equalizer.equalize(grayscaleImage, temporalImage, parameters);
+			comparison.temporalTicksSum += cv::getTickCount() - startTicks;
+
+			comparison.meanAbsoluteDifferenceSum += cv::norm(exactImage, temporalImage, cv::NORM_L1) / exactImage.total();
+
+			// detections are compared on the last loop only, when the LUT has settled
+			if (iteration < BENCHMARK_ITERATIONS_COUNT - 1)
+			{
+				continue;
+			}
+
+			cv::Size minFaceSize = getMinFaceSize(grayscaleImage.size(), parameters);
+			cv::Size maxFaceSize = getMaxFaceSize(grayscaleImage.size(), parameters);
+			double detectionScale = parameters.isDownscaleEnabled ? getFaceDetectionWorkingScale(minFaceSize, parameters) : 1.0;
+
+			std::vector<cv::Rect> referenceFaceRects;
+			detectFacesScaled(face_cascade, exactImage, detectionScale, minFaceSize, maxFaceSize, parameters, referenceFaceRects);
+
+			std::vector<cv::Rect> temporalFaceRects;
+			detectFacesScaled(face_cascade, temporalImage, detectionScale, minFaceSize, maxFaceSize, parameters, temporalFaceRects);
+
+			comparison.referenceFacesCount += (int)referenceFaceRects.size();
+			comparison.temporalFacesCount += (int)temporalFaceRects.size();
+			comparison.matchedFacesCount += matchRects(referenceFaceRects, temporalFaceRects, comparison.matchedIntersectionOverUnionSum);
+		}
+	}
+
+	comparison.framesCount = equalizer.getFramesCount();
+	comparison.rebuildsCount = equalizer.getRebuildsCount();
+
+	recorder.equalizationComparisons.push_back(comparison);
+}
+
+
+std::vector<cv::Rect> getUpperFaceEyeRects(const std::vector<cv::Rect>& eyeRects, const cv::Size& faceSize)
+{
+	std::vector<cv::Rect> upperFaceEyeRects;
+
+	for (const cv::Rect& eyeRect : eyeRects)
+	{
+		if (isEyeInUpperFace(eyeRect, faceSize))
+		{
+			upperFaceEyeRects.push_back(eyeRect);
+		}
+	}
+
+	return upperFaceEyeRects;
+}
+
+
+// every image is played as a still video, eyes kept by the face processing are compared to the full face search
+void compareEyeLocalization(BenchmarkRecorder& recorder, const std::vector<BenchmarkImage>& benchmarkImages, DetectionCascade& eyes_cascade, const EyeDetectionParameters& parameters)
+{
+	EyeDetectionParameters fullFaceParameters = parameters;
+	fullFaceParameters.isUpperFaceSearchEnabled = false;
+	fullFaceParameters.isPairPredictionEnabled = false;
+
+	EyeDetectionParameters upperFaceParameters = parameters;
+	upperFaceParameters.isUpperFaceSearchEnabled = true;
+	upperFaceParameters.isPairPredictionEnabled = false;
+
+	EyeDetectionParameters pairPredictionParameters = parameters;
+	pairPredictionParameters.isUpperFaceSearchEnabled = true;
+	pairPredictionParameters.isPairPredictionEnabled = true;
+
+	const std::vector<std::pair<std::string, EyeDetectionParameters>> modes = {
+		{ "full face", fullFaceParameters },
+		{ "upper face", upperFaceParameters },
+		{ "upper face + pair prediction", pairPredictionParameters }
+	};
+
+	for (const std::pair<std::string, EyeDetectionParameters>& mode : modes)
+	{
+		EyeLocalizationComparison comparison;
+		comparison.datasetName = recorder.datasetName;
+		comparison.modeName = mode.first;
+
+		for (const BenchmarkImage& benchmarkImage : benchmarkImages)
+		{
+			const std::vector<cv::Rect>& faceRects = benchmarkImage.faceRects;
+
+			FaceTrackingState referenceState;
+			referenceState.eyeRects.assign(faceRects.size(), std::vector<cv::Rect>());
+			referenceState.eyePairPredictions.assign(faceRects.size(), EyePairPrediction());
+
+			FaceTrackingState trackingState = referenceState;
+
+			std::vector<std::vector<cv::Rect>> referenceEyeRects(faceRects.size());
+
+			for (size_t faceIndex = 0; faceIndex < faceRects.size(); faceIndex++)
+			{
+				cv::Mat faceRoi = benchmarkImage.processingImage(faceRects[faceIndex]);
+				std::vector<cv::Rect> eyeRects;
+				detectEyes(eyes_cascade, faceRoi, referenceState, faceIndex, false, fullFaceParameters, eyeRects);
+				referenceEyeRects[faceIndex] = getUpperFaceEyeRects(eyeRects, faceRoi.size());
+			}
+
+			for (int frameIndex = 0; frameIndex < BENCHMARK_ITERATIONS_COUNT; frameIndex++)
+			{
+				for (size_t faceIndex = 0; faceIndex < faceRects.size(); faceIndex++)
+				{
+					cv::Mat faceRoi = benchmarkImage.processingImage(faceRects[faceIndex]);
+					std::vector<cv::Rect> eyeRects;
+
+					int64 startTicks = cv::getTickCount();
+					detectEyes(eyes_cascade, faceRoi, trackingState, faceIndex, frameIndex > 0, mode.second, eyeRects);
+					comparison.eyeTicksSum += cv::getTickCount() - startTicks;
+
+					std::vector<cv::Rect> keptEyeRects = getUpperFaceEyeRects(eyeRects, faceRoi.size());
+
+					comparison.referenceEyesCount += (int)referenceEyeRects[faceIndex].size();
+					comparison.eyesCount += (int)keptEyeRects.size();
+					comparison.matchedEyesCount += matchRects(referenceEyeRects[faceIndex], keptEyeRects, comparison.matchedIntersectionOverUnionSum);
+				}
+
+				comparison.framesCount++;
+			}
+
+			comparison.cascadeSearchesCount += trackingState.statistics.cascadeEyeSearchesCount;
+			comparison.predictedSearchesCount += trackingState.statistics.predictedEyeSearchesCount;
+		}
+
+		recorder.eyeLocalizationComparisons.push_back(comparison);
+	}
+}
+
+
+// every reader decodes the same files, the datasets are grouped by file format
+void measureImageReaders(BenchmarkRecorder& recorder)
+{
+	std::vector<std::string> imagePaths = findDatasetImages(BATCH_DATASETS_ROOT_PATH);
+
+	for (int iteration = 0; iteration < BENCHMARK_WARMUP_ITERATIONS_COUNT + BENCHMARK_ITERATIONS_COUNT; iteration++)
+	{
+		recorder.isRecording = iteration >= BENCHMARK_WARMUP_ITERATIONS_COUNT;
+
+		for (const std::string& imagePath : imagePaths)
+		{
+			std::string extension = std::filesystem::path(imagePath).extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+			recorder.datasetName = "reader " + extension;
+
+			measureBenchmarkStage(recorder, "readImage", [&imagePath]() {
+				readImage(imagePath);
+			});
+			measureBenchmarkStage(recorder, "readImageAsBinary", [&imagePath]() {
+				readImageAsBinary(imagePath);
+			});
+			measureBenchmarkStage(recorder, "readImageAsBinaryStream", [&imagePath]() {
+				readImageAsBinaryStream(imagePath);
+			});
+			measureBenchmarkStage(recorder, "readImageMapped", [&imagePath]() {
+				readImageMapped(imagePath);
+			});
+		}
+	}
+}
+
+
+// every image is played as a still video with its own tracking state, the frame goes through the whole
+// headless video path; heap allocations left in it: the face and eye result vectors, the frame result,
+// the scale lists and thread pool tasks of the Haar search, the eye candidate selection and the eye tasks
+void measureSteadyStateFrames(BenchmarkRecorder& recorder, const std::vector<BenchmarkImage>& benchmarkImages, DetectionCascade& face_cascade, DetectionCascade& eyes_cascade, const Parameters& parameters)
+{
+	for (const BenchmarkImage& benchmarkImage : benchmarkImages)
+	{
+		FaceTrackingState trackingState;
+		cv::Mat frame = benchmarkImage.image;
+
+		for (int frameIndex = 0; frameIndex < BENCHMARK_WARMUP_ITERATIONS_COUNT + BENCHMARK_ITERATIONS_COUNT; frameIndex++)
+		{
+			recorder.isRecording = frameIndex >= BENCHMARK_WARMUP_ITERATIONS_COUNT;
+
+			measureBenchmarkStage(recorder, "frame steady state", [&face_cascade, &eyes_cascade, &frame, &trackingState, &parameters, frameIndex]() {
+				int64 frameTicks = cv::getTickCount();
+
+				std::vector<FaceDetectionResult> faceResults = detectFacesAndEyes(face_cascade, eyes_cascade, frame, trackingState, parameters);
+				processEyes(frame, faceResults, parameters);
+				writeFrameResult(makeFrameResult(frameIndex, frameTicks, faceResults));
+			});
+		}
+	}
+}
+
+
+void measureDataset(BenchmarkRecorder& recorder, const std::string& datasetName, DetectionCascade& face_cascade, DetectionCascade& eyes_cascade, const Parameters& parameters)
+{
+	recorder.datasetName = datasetName;
+
+	std::vector<BenchmarkImage> benchmarkImages;
+
+	for (const std::string& imagePath : getBenchmarkImagePaths(datasetName))
+	{
+		benchmarkImages.push_back(prepareBenchmarkImage(imagePath, face_cascade, eyes_cascade, parameters));
+	}
+
+	compareFaceDetectionResolutions(recorder, benchmarkImages, face_cascade, parameters.face);
+	compareEqualization(recorder, benchmarkImages, face_cascade, parameters.face);
+	compareHaarCascades(recorder, benchmarkImages, face_cascade, eyes_cascade, parameters);
+
+	for (int iteration = 0; iteration < BENCHMARK_WARMUP_ITERATIONS_COUNT + BENCHMARK_ITERATIONS_COUNT; iteration++)
+	{
+		recorder.isRecording = iteration >= BENCHMARK_WARMUP_ITERATIONS_COUNT;
+
+		for (const BenchmarkImage& benchmarkImage : benchmarkImages)
+		{
+			// face stages
+
+			cv::Mat image;
+			measureBenchmarkStage(recorder, "image decode", [&image, &benchmarkImage]() {
+				image = readImageMapped(benchmarkImage.imagePath);
+			});
+
+			cv::Mat processingImage;
+			measureBenchmarkStage(recorder, "grayscale + equalizeHist", [&image, &processingImage]() {
+				cv::cvtColor(image, processingImage, cv::COLOR_BGR2GRAY);
+				cv::equalizeHist(processingImage, processingImage);
+			});
+
+			// fresh state, every frame is a full frame detection
+			FaceTrackingState trackingState;
+			std::vector<cv::Rect> faceRects;
+			measureBenchmarkStage(recorder, "face detectMultiScale", [&face_cascade, &processingImage, &trackingState, &parameters, &faceRects]() {
+				detectFaces(face_cascade, processingImage, trackingState, parameters.face, faceRects);
+			});
+
+			// both resolutions are measured regardless of the configured one
+			const cv::Mat& preparedImage = benchmarkImage.processingImage;
+			cv::Size minFaceSize = getMinFaceSize(preparedImage.size(), parameters.face);
+			cv::Size maxFaceSize = getMaxFaceSize(preparedImage.size(), parameters.face);
+			double workingScale = getFaceDetectionWorkingScale(minFaceSize, parameters.face);
+			std::vector<cv::Rect> scaledFaceRects;
+
+			measureBenchmarkStage(recorder, "face full resolution", [&face_cascade, &preparedImage, &minFaceSize, &maxFaceSize, &parameters, &scaledFaceRects]() {
+				detectFacesScaled(face_cascade, preparedImage, 1.0, minFaceSize, maxFaceSize, parameters.face, scaledFaceRects);
+			});
+			measureBenchmarkStage(recorder, "face working resolution", [&face_cascade, &preparedImage, workingScale, &minFaceSize, &maxFaceSize, &parameters, &scaledFaceRects]() {
+				detectFacesScaled(face_cascade, preparedImage, workingScale, minFaceSize, maxFaceSize, parameters.face, scaledFaceRects);
+			});
+
+			for (size_t faceIndex = 0; faceIndex < faceRects.size(); faceIndex++)
+			{
+				cv::Mat faceRoi = processingImage(faceRects[faceIndex]);
+				std::vector<cv::Rect> eyeRects;
+				measureBenchmarkStage(recorder, "eyes detectMultiScale", [&eyes_cascade, &faceRoi, &trackingState, faceIndex, &parameters, &eyeRects]() {
+					detectEyes(eyes_cascade, faceRoi, trackingState, faceIndex, false, parameters.eye, eyeRects);
+				});
+			}
+
+			// end face stages
+
+
+			// eye stages, detectors work in place so every call gets its own copy
+
+			for (size_t eyeIndex = 0; eyeIndex < benchmarkImage.eyes.size(); eyeIndex++)
+			{
+				const BenchmarkEye& eye = benchmarkImage.eyes[eyeIndex];
+
+				cv::Mat eyeRoi = eye.eyeRoi.clone();
+				measureBenchmarkStage(recorder, "processEye", [&eyeRoi, eyeIndex, &parameters]() {
+					processEye(eyeRoi, (int)eyeIndex, parameters);
+				});
+
+				// planes of all detectors against the planes of the active ones only
+				measureBenchmarkStage(recorder, "eye planes HSV split", [&eye]() {
+					FrameArenaScope arenaScope;
+					int rows = eye.cutEyeImage.rows;
+					int cols = eye.cutEyeImage.cols;
+
+					cv::Mat hsvImage = arenaScope.acquire(rows, cols, CV_8UC3);
+					cv::cvtColor(eye.cutEyeImage, hsvImage, cv::COLOR_BGR2HSV);
+
+					std::vector<cv::Mat> separatedChannels = {
+						arenaScope.acquire(rows, cols, CV_8UC1), arenaScope.acquire(rows, cols, CV_8UC1), arenaScope.acquire(rows, cols, CV_8UC1)
+					};
+					cv::split(hsvImage, separatedChannels);
+				});
+
+				int eyeChannels = getEyeChannels(parameters.eyeDetectors);
+				measureBenchmarkStage(recorder, "eye planes active channels", [&eye, eyeChannels]() {
+					FrameArenaScope arenaScope;
+					int rows = eye.cutEyeImage.rows;
+					int cols = eye.cutEyeImage.cols;
+
+					cv::Mat hue = arenaScope.acquire(rows, cols, CV_8UC1);
+					cv::Mat saturation = arenaScope.acquire(rows, cols, CV_8UC1);
+					cv::Mat value = arenaScope.acquire(rows, cols, CV_8UC1);
+					computeEyeChannels(eye.cutEyeImage, eyeChannels, hue, saturation, value);
+				});
+
+				cv::Mat hue = eye.hue.clone();
+				measureBenchmarkStage(recorder, "sclera hue", [&hue, eyeIndex, &parameters]() {
+					detectScleraCenterHue(hue, (int)eyeIndex, parameters.hueSclera, parameters.modes.isMaskMorphologyActive);
+				});
+
+				cv::Mat saturation = eye.saturation.clone();
+				measureBenchmarkStage(recorder, "sclera saturation", [&saturation, eyeIndex, &parameters]() {
+					detectScleraCenterSaturation(saturation, (int)eyeIndex, parameters.saturationSclera, parameters.modes.isMaskMorphologyActive);
+				});
+
+				cv::Mat value = eye.value.clone();
+				cv::Point pupilCenter;
+				measureBenchmarkStage(recorder, "pupil value", [&value, eyeIndex, &parameters, &pupilCenter]() {
+					pupilCenter = detectPupilCenterValue(value, (int)eyeIndex, parameters.pupil, parameters.modes.isMaskMorphologyActive).center;
+				});
+
+				measureBenchmarkStage(recorder, "pupil refinement", [&eye, &pupilCenter, &parameters]() {
+					refinePupilCenter(eye.cutEyeImage, pupilCenter, parameters.pupilRefinement);
+				});
+
+				measureBenchmarkStage(recorder, "fused sclera + pupil", [&eye, &parameters]() {
+					detectEyeCentersFused(eye.cutEyeImage, parameters);
+				});
+
+				// saturation sclera mask, threshold and morphology only
+				const CenterDetectorParameters& scleraParameters = parameters.saturationSclera;
+				cv::Mat mask;
+				measureBenchmarkStage(recorder, "sclera mask chain", [&eye, &scleraParameters, &mask]() {
+					cv::threshold(eye.saturation, mask, scleraParameters.threshold, scleraParameters.maxThreshold, cv::THRESH_BINARY_INV);
+
+					if (scleraParameters.isErosionEnabled)
+					{
+						cv::erode(mask, mask, cv::Mat(), cv::Point(-1, -1), scleraParameters.erosionIterationsCount);
+					}
+
+					if (scleraParameters.isDilationEnabled)
+					{
+						cv::dilate(mask, mask, cv::Mat(), cv::Point(-1, -1), scleraParameters.dilationIterationsCount);
+					}
+				});
+				measureBenchmarkStage(recorder, "sclera mask single pass", [&eye, &scleraParameters, &mask]() {
+					thresholdMaskMorphology(eye.saturation, mask, scleraParameters, cv::THRESH_BINARY_INV);
+				});
+			}
+
+			// whole eye analysis of a frame, no Mat allocations expected once the frame arena has grown
+			cv::Mat frameImage = benchmarkImage.image;
+			std::vector<FaceDetectionResult> faceResults = benchmarkImage.faceResults;
+			measureBenchmarkStage(recorder, "frame processEyes", [&frameImage, &faceResults, &parameters]() {
+				processEyes(frameImage, faceResults, parameters);
+			});
+
+			// end eye stages
+		}
+	}
+
+	measureSteadyStateFrames(recorder, benchmarkImages, face_cascade, eyes_cascade, parameters);
+}
+
+
+void measureEyeLocalization(BenchmarkRecorder& recorder, const std::string& datasetName, DetectionCascade& face_cascade, DetectionCascade& eyes_cascade, const Parameters& parameters)
+{
+	recorder.datasetName = datasetName;
+
+	std::vector<BenchmarkImage> benchmarkImages;
+
+	for (const std::string& imagePath : getBenchmarkImagePaths(datasetName))
+	{
+		benchmarkImages.push_back(prepareBenchmarkImage(imagePath, face_cascade, eyes_cascade, parameters));
+	}
+
+	compareEyeLocalization(recorder, benchmarkImages, eyes_cascade, parameters.eye);
+}
+
+
+void runBenchmark(const CascadeFile& faceCascadeFile, const CascadeFile& eyesCascadeFile, const Parameters& parameters)
+{
+	// intermediate images aren't needed
+	setDebugTapSink(nullptr);
+
+	if (parameters.modes.isDebugActive)
+	{
+		std::cout << "Warning: benchmark is running with IS_DEBUG, debug taps are measured too" << std::endl;
+	}
+
+	// the stock classifier is compared against the flat evaluator
+	DetectionCascade face_cascade = loadCascade(faceCascadeFile, "face", true);
+	DetectionCascade eyes_cascade = loadCascade(eyesCascadeFile, "eyes", true);
+
+	cv::MatAllocator* defaultAllocator = cv::Mat::getDefaultAllocator();
+	CountingMatAllocator countingAllocator(defaultAllocator);
+	cv::Mat::setDefaultAllocator(&countingAllocator);
+
+	BenchmarkRecorder recorder;
+	recorder.allocator = &countingAllocator;
+
+	setHeapCountingEnabled(true);
+
+	try
+	{
+		measureCascadeLoad(recorder, faceCascadeFile, eyesCascadeFile);
+		measureImageReaders(recorder);
+
+		for (const std::string& datasetName : BENCHMARK_DATASET_NAMES)
+		{
+			measureDataset(recorder, datasetName, face_cascade, eyes_cascade, parameters);
+		}
+
+		for (const std::string& datasetName : BENCHMARK_EYE_LOCALIZATION_DATASET_NAMES)
+		{
+			measureEyeLocalization(recorder, datasetName, face_cascade, eyes_cascade, parameters);
+		}
+	}
+	catch (...)
+	{
+		setHeapCountingEnabled(false);
+		cv::Mat::setDefaultAllocator(defaultAllocator);
+		throw;
+	}
+
+	setHeapCountingEnabled(false);
+
+	// buffers are owned by the wrapped allocator, so they stay valid after restoring it
+	cv::Mat::setDefaultAllocator(defaultAllocator);
+
+	printBenchmarkResults(recorder.stages, parameters.modes);
+	printFaceResolutionComparisons(recorder.faceResolutionComparisons, parameters.face);
+	printEqualizationComparisons(recorder.equalizationComparisons, parameters.face);
+	printEyeLocalizationComparisons(recorder.eyeLocalizationComparisons, parameters.eye);
+	printHaarCascadeComparisons(recorder.haarCascadeComparisons);
+	writeBenchmarkResults(BENCHMARK_RESULTS_FILE_NAME, recorder.stages);
+}
+
+
+// nearest rank percentile of the sorted values
+double getPercentile(const std::vector<double>& sortedValues, double percentile)
+{
+	if (sortedValues.empty())
+	{
+		return 0.0;
+	}
+
+	size_t rank = (size_t)std::ceil(percentile / 100.0 * sortedValues.size());
+
+	return sortedValues[std::max<size_t>(rank, 1) - 1];
+}
+
+
+BenchmarkStageStatistics getBenchmarkStageStatistics(const BenchmarkStage& stage)
+{
+	BenchmarkStageStatistics statistics;
+	statistics.samplesCount = stage.samples.size();
+
+	if (stage.samples.empty())
+	{
+		return statistics;
+	}
+
+	std::vector<double> milliseconds;
+	int64 allocationsCount = 0;
+	int64 allocatedBytesCount = 0;
+	int64 heapAllocationsCount = 0;
+	int64 heapAllocatedBytesCount = 0;
+
+	for (const BenchmarkSample& sample : stage.samples)
+	{
+		milliseconds.push_back(sample.milliseconds);
+		allocationsCount += sample.allocationsCount;
+		allocatedBytesCount += sample.allocatedBytesCount;
+		heapAllocationsCount += sample.heapAllocationsCount;
+		heapAllocatedBytesCount += sample.heapAllocatedBytesCount;
+	}
+
+	std::sort(milliseconds.begin(), milliseconds.end());
+
+	statistics.medianMilliseconds = getPercentile(milliseconds, 50.0);
+	statistics.p95Milliseconds = getPercentile(milliseconds, 95.0);
+	statistics.p99Milliseconds = getPercentile(milliseconds, 99.0);
+	statistics.allocationsPerSample = (double)allocationsCount / stage.samples.size();
+	statistics.allocatedKilobytesPerSample = allocatedBytesCount / 1024.0 / stage.samples.size();
+	statistics.heapAllocationsPerSample = (double)heapAllocationsCount / stage.samples.size();
+	statistics.heapAllocatedKilobytesPerSample = heapAllocatedBytesCount / 1024.0 / stage.samples.size();
+
+	return statistics;
+}
+
+
+void printBenchmarkResults(const std::vector<BenchmarkStage>& stages, const ProcessingModes& modes)
+{
+	std::cout << "Benchmark iterations/warm up : " << BENCHMARK_ITERATIONS_COUNT << "/" << BENCHMARK_WARMUP_ITERATIONS_COUNT << std::endl;
+	std::cout << "Parallel/Fused/Frame arena/Debug : " << modes.isParallelProcessingActive << "/" << modes.isFusedEyeProcessingActive << "/" <<
+		IS_FRAME_ARENA_ENABLED << "/" << modes.isDebugActive << std::endl;
+
+	std::cout << std::left << std::setw(30) << "dataset" << std::setw(28) << "stage" <<
+		std::right << std::setw(8) << "samples" << std::setw(12) << "median, ms" << std::setw(12) << "p95, ms" << std::setw(12) << "p99, ms" <<
+		std::setw(10) << "allocs" << std::setw(12) << "alloc, KB" << std::setw(12) << "heap allocs" << std::setw(12) << "heap, KB" << std::endl;
+
+	for (const BenchmarkStage& stage : stages)
+	{
+		BenchmarkStageStatistics statistics = getBenchmarkStageStatistics(stage);
+
+		std::cout << std::left << std::setw(30) << stage.datasetName << std::setw(28) << stage.stageName <<
+			std::right << std::setw(8) << statistics.samplesCount << std::fixed << std::setprecision(3) <<
+			std::setw(12) << statistics.medianMilliseconds << std::setw(12) << statistics.p95Milliseconds << std::setw(12) << statistics.p99Milliseconds <<
+			std::setprecision(1) << std::setw(10) << statistics.allocationsPerSample << std::setw(12) << statistics.allocatedKilobytesPerSample <<
+			std::setw(12) << statistics.heapAllocationsPerSample << std::setw(12) << statistics.heapAllocatedKilobytesPerSample <<
+			std::defaultfloat << std::endl;
+	}
+}
+
+
+void writeBenchmarkResults(const std::string& filePath, const std::vector<BenchmarkStage>& stages)
+{
+	std::ofstream fout(filePath);
+
+	if (!fout.is_open())
+	{
+		throw std::runtime_error("Can't write file: " + filePath);
+	}
+
+	fout << "dataset,stage,samples,median_ms,p95_ms,p99_ms,allocations,allocated_kb,heap_allocations,heap_allocated_kb" << std::endl;
+
+	for (const BenchmarkStage& stage : stages)
+	{
+		BenchmarkStageStatistics statistics = getBenchmarkStageStatistics(stage);
+
+		fout << stage.datasetName << "," << stage.stageName << "," << statistics.samplesCount << "," <<
+			statistics.medianMilliseconds << "," << statistics.p95Milliseconds << "," << statistics.p99Milliseconds << "," <<
+			statistics.allocationsPerSample << "," << statistics.allocatedKilobytesPerSample << "," <<
+			statistics.heapAllocationsPerSample << "," << statistics.heapAllocatedKilobytesPerSample << std::endl;
+	}
+}
+
+
+void printFaceResolutionComparisons(const std::vector<FaceResolutionComparison>& comparisons, const FaceDetectionParameters& parameters)
+{
+	std::cout << "Face working resolution, min face size, px : " << parameters.minFaceWorkingSize <<
+		(parameters.isDownscaleEnabled ? " (enabled)" : " (disabled)") << std::endl;
+
+	for (const FaceResolutionComparison& comparison : comparisons)
+	{
+		double meanIntersectionOverUnion = comparison.matchedFacesCount > 0 ?
+			comparison.matchedIntersectionOverUnionSum / comparison.matchedFacesCount : 0.0;
+
+		std::cout << comparison.datasetName << " : scale " << comparison.workingScale <<
+			", reference/working/matched faces " << comparison.referenceFacesCount << "/" << comparison.workingFacesCount << "/" << comparison.matchedFacesCount <<
+			", matched mean IoU " << meanIntersectionOverUnion << std::endl;
+	}
+}
+
+
+void printEqualizationComparisons(const std::vector<EqualizationComparison>& comparisons, const FaceDetectionParameters& parameters)
+{
+	std::cout << "Temporal equalization, sampling step " << parameters.equalizationSamplingStep <<
+		", smoothing " << parameters.equalizationSmoothing << ", rebuild drift " << parameters.equalizationRebuildDrift << std::endl;
+
+	for (const EqualizationComparison& comparison : comparisons)
+	{
+		double exactAverage = comparison.framesCount > 0 ? ticksToMilliseconds(comparison.exactTicksSum) / comparison.framesCount : 0.0;
+		double temporalAverage = comparison.framesCount > 0 ? ticksToMilliseconds(comparison.temporalTicksSum) / comparison.framesCount : 0.0;
+		double meanAbsoluteDifference = comparison.framesCount > 0 ? comparison.meanAbsoluteDifferenceSum / comparison.framesCount : 0.0;
+		double meanIntersectionOverUnion = comparison.matchedFacesCount > 0 ?
+			comparison.matchedIntersectionOverUnionSum / comparison.matchedFacesCount : 0.0;
+
+		std::cout << comparison.datasetName << " : frames/full rebuilds " << comparison.framesCount << "/" << comparison.rebuildsCount <<
+			", exact/temporal ms " << exactAverage << "/" << temporalAverage << ", saved ms per frame " << exactAverage - temporalAverage <<
+			", mean abs difference " << meanAbsoluteDifference << std::endl;
+		std::cout << comparison.datasetName << " : reference/temporal/matched faces " <<
+			comparison.referenceFacesCount << "/" << comparison.temporalFacesCount << "/" << comparison.matchedFacesCount <<
+			", matched mean IoU " << meanIntersectionOverUnion << std::endl;
+	}
+}
+
+
+void printEyeLocalizationComparisons(const std::vector<EyeLocalizationComparison>& comparisons, const EyeDetectionParameters& parameters)
+{
+	std::cout << "Eye localization, pair confirmation interval : " << parameters.pairConfirmationInterval << std::endl;
+
+	double fullFaceAverage = 0.0;
+
+	for (const EyeLocalizationComparison& comparison : comparisons)
+	{
+		double eyeAverage = comparison.framesCount > 0 ? ticksToMilliseconds(comparison.eyeTicksSum) / comparison.framesCount : 0.0;
+		double meanIntersectionOverUnion = comparison.matchedEyesCount > 0 ?
+			comparison.matchedIntersectionOverUnionSum / comparison.matchedEyesCount : 0.0;
+
+		// modes of a dataset are listed after its full face search
+		if (comparison.modeName == "full face")
+		{
+			fullFaceAverage = eyeAverage;
+		}
+
+		std::cout << comparison.datasetName << ", " << comparison.modeName << " : eye stage ms per frame " << eyeAverage <<
+			", speedup " << (eyeAverage > 0 ? fullFaceAverage / eyeAverage : 0.0) <<
+			", cascade/predicted searches " << comparison.cascadeSearchesCount << "/" << comparison.predictedSearchesCount << std::endl;
+		std::cout << comparison.datasetName << ", " << comparison.modeName << " : reference/found/matched eyes " <<
+			comparison.referenceEyesCount << "/" << comparison.eyesCount << "/" << comparison.matchedEyesCount <<
+			", matched mean IoU " << meanIntersectionOverUnion << std::endl;
+	}
+}
+
+
+void printHaarCascadeComparisons(const std::vector<HaarCascadeComparison>& comparisons)
+{
+	std::cout << "Haar cascade evaluator against cv::CascadeClassifier" << (IS_HAAR_CASCADE_ENABLED ? " (enabled)" : " (disabled)") << std::endl;
+
+	for (const HaarCascadeComparison& comparison : comparisons)
+	{
+		double stockAverage = comparison.framesCount > 0 ? ticksToMilliseconds(comparison.stockTicksSum) / comparison.framesCount : 0.0;
+		double haarAverage = comparison.framesCount > 0 ? ticksToMilliseconds(comparison.haarTicksSum) / comparison.framesCount : 0.0;
+
+		std::cout << comparison.datasetName << " " << comparison.imageSize.width << "x" << comparison.imageSize.height <<
+			" : stock/haar ms per frame " << stockAverage << "/" << haarAverage <<
+			", speedup " << (haarAverage > 0 ? stockAverage / haarAverage : 0.0) <<
+			", mismatched frames " << comparison.mismatchedFramesCount << "/" << comparison.framesCount << std::endl;
+	}
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "Cascades.hpp"
+#include "Constants.hpp"
+#include "Parameters.hpp"
+
+
+// Counts cv::Mat buffer allocations made through the default allocator.
+// Buffers are still owned and released by the wrapped allocator.
+class CountingMatAllocator : public cv::MatAllocator
+{
+public:
+	explicit CountingMatAllocator(cv::MatAllocator* wrappedAllocator);
+
+	cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+	bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override;
+	void deallocate(cv::UMatData* data) const override;
+
+	int64 getAllocationsCount() const;
+	int64 getAllocatedBytesCount() const;
+
+private:
+	cv::MatAllocator* wrappedAllocator;
+	mutable std::atomic<int64> allocationsCount;
+	mutable std::atomic<int64> allocatedBytesCount;
+};
+
+
+struct BenchmarkSample
+{
+	double milliseconds = 0.0;
+	int64 allocationsCount = 0;
+	int64 allocatedBytesCount = 0;
+	int64 heapAllocationsCount = 0;
+	int64 heapAllocatedBytesCount = 0;
+};
+
+
+struct BenchmarkStage
+{
+	std::string datasetName;
+	std::string stageName;
+	std::vector<BenchmarkSample> samples;
+};
+
+
+struct BenchmarkStageStatistics
+{
+	size_t samplesCount = 0;
+	double medianMilliseconds = 0.0;
+	double p95Milliseconds = 0.0;
+	double p99Milliseconds = 0.0;
+	double allocationsPerSample = 0.0;
+	double allocatedKilobytesPerSample = 0.0;
+	double heapAllocationsPerSample = 0.0;
+	double heapAllocatedKilobytesPerSample = 0.0;
+};
+
+
+// face detection on the downscaled working image against the full resolution reference
+struct FaceResolutionComparison
+{
+	std::string datasetName;
+	double workingScale = 1.0;
+	int referenceFacesCount = 0;
+	int workingFacesCount = 0;
+	int matchedFacesCount = 0;
+	double matchedIntersectionOverUnionSum = 0.0;
+};
+
+
+// temporal equalization of the dataset images played as a looped video, against cv::equalizeHist
+struct EqualizationComparison
+{
+	std::string datasetName;
+	int64 framesCount = 0;
+	int64 rebuildsCount = 0;
+	int64 exactTicksSum = 0;
+	int64 temporalTicksSum = 0;
+	double meanAbsoluteDifferenceSum = 0.0;
+	int referenceFacesCount = 0;
+	int temporalFacesCount = 0;
+	int matchedFacesCount = 0;
+	double matchedIntersectionOverUnionSum = 0.0;
+};
+
+
+// eye search of one localization mode over the dataset images played as still videos, against the full face search
+struct EyeLocalizationComparison
+{
+	std::string datasetName;
+	std::string modeName;
+	int64 framesCount = 0;
+	int64 eyeTicksSum = 0;
+	int64 cascadeSearchesCount = 0;
+	int64 predictedSearchesCount = 0;
+	int referenceEyesCount = 0;
+	int eyesCount = 0;
+	int matchedEyesCount = 0;
+	double matchedIntersectionOverUnionSum = 0.0;
+};
+
+
+// flat Haar evaluator against cv::CascadeClassifier on the dataset images, faces on full images and eyes on the found faces
+struct HaarCascadeComparison
+{
+	std::string datasetName;
+	cv::Size imageSize;
+	int64 framesCount = 0;
+	int64 stockTicksSum = 0;
+	int64 haarTicksSum = 0;
+	int64 mismatchedFramesCount = 0;
+};
+
+
+void runBenchmark(const CascadeFile& faceCascadeFile, const CascadeFile& eyesCascadeFile, const Parameters& parameters);
+BenchmarkStageStatistics getBenchmarkStageStatistics(const BenchmarkStage& stage);
+void printBenchmarkResults(const std::vector<BenchmarkStage>& stages, const ProcessingModes& modes);
+void printFaceResolutionComparisons(const std::vector<FaceResolutionComparison>& comparisons, const FaceDetectionParameters& parameters);
+void printEqualizationComparisons(const std::vector<EqualizationComparison>& comparisons, const FaceDetectionParameters& parameters);
+void printEyeLocalizationComparisons(const std::vector<EyeLocalizationComparison>& comparisons, const EyeDetectionParameters& parameters);
+void printHaarCascadeComparisons(const std::vector<HaarCascadeComparison>& comparisons);
+void writeBenchmarkResults(const std::string& filePath, const std::vector<BenchmarkStage>& stages);
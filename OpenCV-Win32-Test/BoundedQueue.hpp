@@ -0,0 +1,194 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+
+// fixed capacity queue, pushing into a full queue drops the oldest item
+// unless the producer is allowed to wait for a free slot
+template <typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(size_t capacity);
+
+	void push(T item);
+	void push(T item, std::chrono::milliseconds timeout);
+	void pushWaiting(T item);
+	bool pop(T& item);
+	bool tryPop(T& item);
+	void close();
+
+	size_t getDroppedCount() const;
+	size_t getDelayedCount() const;
+
+private:
+	std::deque<T> items;
+	size_t capacity;
+	size_t droppedCount = 0;
+	size_t delayedCount = 0;
+	bool isClosed = false;
+	mutable std::mutex itemsMutex;
+	std::condition_variable itemsCondition;
+	std::condition_variable spaceCondition;
+};
+
+
+template <typename T>
+BoundedQueue<T>::BoundedQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1)
+{
+}
+
+
+template <typename T>
+void BoundedQueue<T>::push(T item)
+{
+	{
+		std::lock_guard<std::mutex> lock(itemsMutex);
+
+		if (isClosed)
+		{
+			return;
+		}
+
+		if (items.size() >= capacity)
+		{
+			items.pop_front();
+			droppedCount++;
+		}
+
+		items.push_back(std::move(item));
+	}
+
+	itemsCondition.notify_one();
+}
+
+
+// waits up to the timeout for a free slot, the oldest item is dropped if there is still none
+template <typename T>
+void BoundedQueue<T>::push(T item, std::chrono::milliseconds timeout)
+{
+	{
+		std::unique_lock<std::mutex> lock(itemsMutex);
+
+		if (!isClosed && items.size() >= capacity)
+		{
+			delayedCount++;
+			spaceCondition.wait_for(lock, timeout, [this]() { return isClosed || items.size() < capacity; });
+		}
+
+		if (isClosed)
+		{
+			return;
+		}
+
+		if (items.size() >= capacity)
+		{
+			items.pop_front();
+			droppedCount++;
+		}
+
+		items.push_back(std::move(item));
+	}
+
+	itemsCondition.notify_one();
+}
+
+
+// waits for a free slot as long as needed, nothing is dropped
+template <typename T>
+void BoundedQueue<T>::pushWaiting(T item)
+{
+	{
+		std::unique_lock<std::mutex> lock(itemsMutex);
+
+		if (!isClosed && items.size() >= capacity)
+		{
+			delayedCount++;
+			spaceCondition.wait(lock, [this]() { return isClosed || items.size() < capacity; });
+		}
+
+		if (isClosed)
+		{
+			return;
+		}
+
+		items.push_back(std::move(item));
+	}
+
+	itemsCondition.notify_one();
+}
+
+
+// blocks until an item is available, returns false when the queue is closed and empty
+template <typename T>
+bool BoundedQueue<T>::pop(T& item)
+{
+	std::unique_lock<std::mutex> lock(itemsMutex);
+	itemsCondition.wait(lock, [this]() { return isClosed || !items.empty(); });
+
+	if (items.empty())
+	{
+		return false;
+	}
+
+	item = std::move(items.front());
+	items.pop_front();
+
+	lock.unlock();
+	spaceCondition.notify_one();
+
+	return true;
+}
+
+
+// doesn't wait, returns false when the queue is empty
+template <typename T>
+bool BoundedQueue<T>::tryPop(T& item)
+{
+	std::unique_lock<std::mutex> lock(itemsMutex);
+
+	if (items.empty())
+	{
+		return false;
+	}
+
+	item = std::move(items.front());
+	items.pop_front();
+
+	lock.unlock();
+	spaceCondition.notify_one();
+
+	return true;
+}
+
+
+template <typename T>
+void BoundedQueue<T>::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(itemsMutex);
+		isClosed = true;
+	}
+
+	itemsCondition.notify_all();
+	spaceCondition.notify_all();
+}
+
+
+template <typename T>
+size_t BoundedQueue<T>::getDroppedCount() const
+{
+	std::lock_guard<std::mutex> lock(itemsMutex);
+	return droppedCount;
+}
+
+
+template <typename T>
+size_t BoundedQueue<T>::getDelayedCount() const
+{
+	std::lock_guard<std::mutex> lock(itemsMutex);
+	return delayedCount;
+}
@@ -0,0 +1,245 @@
+#include <cstring>
+#include <filesystem>
+
+#include "Cascades.hpp"
+#include "MappedFile.hpp"
+#include "Utils.hpp"
+
+
+std::string getCascadePath(const std::string& cascadeFileName)
+{
+	return (std::filesystem::path(getEnvironmentVariable(OPENCV_ENVIRONMENT_VARIABLE_NAME)) / HAAR_CASCADES_RELATIVE_PATH / cascadeFileName).string();
+}
+
+
+std::string getCascadeCachePath(const std::string& cascadeFileName)
+{
+	return (std::filesystem::path(CASCADE_CACHE_RELATIVE_PATH) / (cascadeFileName + ".bin")).string();
+}
+
+
+// FNV-1a
+uint64 updateCascadeHash(uint64 hash, const uchar* data, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+
+// the source is hashed straight from the file mapping
+uint64 getCascadeSourceHash(const std::string& cascadePath)
+{
+	MappedFile mappedFile(cascadePath);
+	return updateCascadeHash(14695981039346656037ULL, mappedFile.getData(), mappedFile.getSize());
+}
+
+
+CascadeSourceStamp getCascadeSourceStamp(const std::string& cascadePath)
+{
+	CascadeSourceStamp stamp;
+	stamp.size = (uint64)std::filesystem::file_size(cascadePath);
+	stamp.modificationTime = (int64)std::filesystem::last_write_time(cascadePath).time_since_epoch().count();
+
+	return stamp;
+}
+
+
+std::string readCascadeSource(const std::string& cascadeFileName)
+{
+	return readTextFile(getCascadePath(cascadeFileName));
+}
+
+
+HaarCascade parseCascadeSource(const std::string& cascadeFileContent)
+{
+	cv::FileStorage fileStorage(cascadeFileContent, cv::FileStorage::READ | cv::FileStorage::MEMORY);
+	return readHaarCascade(fileStorage.getFirstTopLevelNode());
+}
+
+
+const char CASCADE_CACHE_MAGIC[8] = { 'H', 'A', 'A', 'R', 'B', 'I', 'N', '1' };
+
+// followed by the source path and the binary flat cascade
+struct CascadeCacheHeader
+{
+	char magic[8];
+	uint32_t sourcePathSize;
+	uint32_t reserved;
+	uint64_t sourceSize;
+	int64_t sourceModificationTime;
+	uint64_t sourceHash;
+};
+
+
+void writeCascadeCache(const std::string& cachePath, const std::string& cascadePath, const CascadeSourceStamp& stamp, uint64 sourceHash, const HaarCascade& haarCascade)
+{
+	std::filesystem::create_directory(CASCADE_CACHE_RELATIVE_PATH);
+
+	// JSON caches of previous versions
+	std::string cacheFileName = std::filesystem::path(cachePath).filename().string();
+	std::string sourceFileName = std::filesystem::path(cascadePath).filename().string();
+
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(CASCADE_CACHE_RELATIVE_PATH))
+	{
+		std::string entryFileName = entry.path().filename().string();
+
+		if (entryFileName != cacheFileName && entryFileName.rfind(sourceFileName + ".", 0) == 0)
+		{
+			std::filesystem::remove(entry.path());
+		}
+	}
+
+	CascadeCacheHeader header = {};
+	std::memcpy(header.magic, CASCADE_CACHE_MAGIC, sizeof(header.magic));
+	header.sourcePathSize = (uint32_t)cascadePath.size();
+	header.sourceSize = stamp.size;
+	header.sourceModificationTime = stamp.modificationTime;
+	header.sourceHash = sourceHash;
+
+	std::string cacheContent((const char*)&header, sizeof(header));
+	cacheContent += cascadePath;
+	appendHaarCascadeBinary(cacheContent, haarCascade);
+
+	std::ofstream fout(cachePath, std::ios::out | std::ios::binary);
+
+	if (!fout.is_open())
+	{
+		throw std::runtime_error("Can't write file: " + cachePath);
+	}
+
+	fout.write(cacheContent.data(), cacheContent.size());
+}
+
+
+// Path, size and modification time of the source are compared first, the source is hashed only when
+// the size or time changed, and a matching hash refreshes the stamp so the next start skips hashing again.
+bool readCascadeCache(const std::string& cachePath, const std::string& cascadePath, const CascadeSourceStamp& stamp, HaarCascade& haarCascade)
+{
+	if (!std::filesystem::exists(cachePath) || std::filesystem::file_size(cachePath) < sizeof(CascadeCacheHeader))
+	{
+		return false;
+	}
+
+	CascadeCacheHeader header;
+	bool isStampSame = false;
+
+	{
+		MappedFile cacheFile(cachePath);
+		const uchar* data = cacheFile.getData();
+		size_t size = cacheFile.getSize();
+
+		std::memcpy(&header, data, sizeof(header));
+		size_t cascadeOffset = sizeof(header) + header.sourcePathSize;
+
+		if (std::memcmp(header.magic, CASCADE_CACHE_MAGIC, sizeof(header.magic)) != 0 || header.sourcePathSize != cascadePath.size() ||
+			size < cascadeOffset || std::memcmp(data + sizeof(header), cascadePath.data(), cascadePath.size()) != 0)
+		{
+			return false;
+		}
+
+		isStampSame = header.sourceSize == stamp.size && header.sourceModificationTime == stamp.modificationTime;
+
+		// touched source, e.g. reinstalled, the content decides
+		if (!isStampSame && header.sourceHash != getCascadeSourceHash(cascadePath))
+		{
+			return false;
+		}
+
+		if (!readHaarCascadeBinary(data + cascadeOffset, size - cascadeOffset, haarCascade))
+		{
+			return false;
+		}
+	}
+
+	// rewritten after the mapping is closed
+	if (!isStampSame)
+	{
+		writeCascadeCache(cachePath, cascadePath, stamp, header.sourceHash, haarCascade);
+	}
+
+	return true;
+}
+
+
+CascadeFile readCascade(const std::string& cascadeFileName)
+{
+	std::string cascadePath = getCascadePath(cascadeFileName);
+
+	CascadeFile cascadeFile;
+	cascadeFile.name = cascadeFileName;
+
+	if (!IS_CASCADE_CACHE_ENABLED)
+	{
+		cascadeFile.haarCascade = parseCascadeSource(readTextFile(cascadePath));
+		return cascadeFile;
+	}
+
+	std::string cachePath = getCascadeCachePath(cascadeFileName);
+	CascadeSourceStamp stamp = getCascadeSourceStamp(cascadePath);
+
+	cascadeFile.isCacheHit = readCascadeCache(cachePath, cascadePath, stamp, cascadeFile.haarCascade);
+
+	if (cascadeFile.isCacheHit)
+	{
+		return cascadeFile;
+	}
+
+	cascadeFile.haarCascade = parseCascadeSource(readTextFile(cascadePath));
+	writeCascadeCache(cachePath, cascadePath, stamp, getCascadeSourceHash(cascadePath), cascadeFile.haarCascade);
+
+	if (IS_LOGGING)
+	{
+		std::cout << "Cascade cache written: " << cachePath << std::endl;
+	}
+
+	return cascadeFile;
+}
+
+
+std::string getCascadeCacheStatus(const CascadeFile& cascadeFile)
+{
+	if (!IS_CASCADE_CACHE_ENABLED)
+	{
+		return "off";
+	}
+
+	return cascadeFile.isCacheHit ? "hit" : "miss";
+}
+
+
+DetectionCascade loadCascade(const CascadeFile& cascadeFile, const std::string& cascadeName, bool isClassifierLoaded)
+{
+	DetectionCascade cascade;
+	cascade.haarCascade = cascadeFile.haarCascade;
+
+	// the stock classifier still parses the source
+	if (isClassifierLoaded)
+	{
+		cv::FileStorage fileStorage(readCascadeSource(cascadeFile.name), cv::FileStorage::READ | cv::FileStorage::MEMORY);
+
+		if (!cascade.classifier.read(fileStorage.getFirstTopLevelNode()))
+		{
+			throw std::runtime_error("Can't read " + cascadeName + " cascade");
+		}
+	}
+
+	return cascade;
+}
+
+
+void detectCascadeObjects(DetectionCascade& cascade, const cv::Mat& image, std::vector<cv::Rect>& objects, double scaleFactor, int minNeighbours, const cv::Size& minSize, const cv::Size& maxSize)
+{
+	if (IS_HAAR_CASCADE_ENABLED)
+	{
+		detectHaarCascade(cascade.haarCascade, image, objects, scaleFactor, minNeighbours, minSize, maxSize);
+	}
+	else
+	{
+		cascade.classifier.detectMultiScale(image, objects, scaleFactor, minNeighbours, 0, minSize, maxSize);
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+
+#include <opencv2/objdetect.hpp>
+
+#include "Constants.hpp"
+#include "HaarCascade.hpp"
+
+
+// source file identity kept in the cascade cache
+struct CascadeSourceStamp
+{
+	uint64 size = 0;
+	int64 modificationTime = 0;
+};
+
+
+// flat cascade of a cascade file, read from the binary cache when it is up to date
+struct CascadeFile
+{
+	std::string name;
+	HaarCascade haarCascade;
+	bool isCacheHit = false;
+};
+
+
+std::string getCascadePath(const std::string& cascadeFileName);
+std::string getCascadeCachePath(const std::string& cascadeFileName);
+uint64 getCascadeSourceHash(const std::string& cascadePath);
+CascadeSourceStamp getCascadeSourceStamp(const std::string& cascadePath);
+std::string readCascadeSource(const std::string& cascadeFileName);
+HaarCascade parseCascadeSource(const std::string& cascadeFileContent);
+// the cache is rebuilt from the source when it is missing or stale
+CascadeFile readCascade(const std::string& cascadeFileName);
+// hit, miss or off
+std::string getCascadeCacheStatus(const CascadeFile& cascadeFile);
+
+
+// the stock classifier and the flat Haar cascade read from the same file
+struct DetectionCascade
+{
+	cv::CascadeClassifier classifier;
+	HaarCascade haarCascade;
+};
+
+
+// the stock classifier is parsed from the source only when it is used
+DetectionCascade loadCascade(const CascadeFile& cascadeFile, const std::string& cascadeName, bool isClassifierLoaded = !IS_HAAR_CASCADE_ENABLED);
+// detectMultiScale through the Haar evaluator when it is enabled
+void detectCascadeObjects(DetectionCascade& cascade, const cv::Mat& image, std::vector<cv::Rect>& objects, double scaleFactor, int minNeighbours, const cv::Size& minSize, const cv::Size& maxSize);
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "CenterOfMass.hpp"
+#include "Constants.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CENTER_OF_MASS_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CENTER_OF_MASS_SSE2
+#endif
+
+
+// adds the row pixels to the per column sums and returns the row sum
+uint64_t accumulateRow8UC1(const uint8_t* rowPtr, int columnsCount, uint32_t* columnSums)
+{
+	uint64_t rowSum = 0;
+	int j = 0;
+
+#if defined(CENTER_OF_MASS_AVX2)
+	__m256i rowSumVector = _mm256_setzero_si256();
+
+	for (; j + 32 <= columnsCount; j += 32)
+	{
+		__m256i pixels = _mm256_loadu_si256((const __m256i*)(rowPtr + j));
+		rowSumVector = _mm256_add_epi64(rowSumVector, _mm256_sad_epu8(pixels, _mm256_setzero_si256()));
+
+		for (int k = 0; k < 32; k += 8)
+		{
+			__m256i weights = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(rowPtr + j + k)));
+			__m256i sums = _mm256_loadu_si256((const __m256i*)(columnSums + j + k));
+			_mm256_storeu_si256((__m256i*)(columnSums + j + k), _mm256_add_epi32(sums, weights));
+		}
+	}
+
+	alignas(32) uint64_t rowSumParts[4];
+	_mm256_store_si256((__m256i*)rowSumParts, rowSumVector);
+	rowSum = rowSumParts[0] + rowSumParts[1] + rowSumParts[2] + rowSumParts[3];
+#elif defined(CENTER_OF_MASS_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	__m128i rowSumVector = zero;
+
+	for (; j + 16 <= columnsCount; j += 16)
+	{
+		__m128i pixels = _mm_loadu_si128((const __m128i*)(rowPtr + j));
+		rowSumVector = _mm_add_epi64(rowSumVector, _mm_sad_epu8(pixels, zero));
+
+		__m128i lowWeights = _mm_unpacklo_epi8(pixels, zero);
+		__m128i highWeights = _mm_unpackhi_epi8(pixels, zero);
+		__m128i weights[4] = {
+			_mm_unpacklo_epi16(lowWeights, zero),
+			_mm_unpackhi_epi16(lowWeights, zero),
+			_mm_unpacklo_epi16(highWeights, zero),
+			_mm_unpackhi_epi16(highWeights, zero)
+		};
+
+		for (int k = 0; k < 4; k++)
+		{
+			__m128i* sumsPtr = (__m128i*)(columnSums + j + k * 4);
+			_mm_storeu_si128(sumsPtr, _mm_add_epi32(_mm_loadu_si128(sumsPtr), weights[k]));
+		}
+	}
+
+	alignas(16) uint64_t rowSumParts[2];
+	_mm_store_si128((__m128i*)rowSumParts, rowSumVector);
+	rowSum = rowSumParts[0] + rowSumParts[1];
+#endif
+
+	for (; j < columnsCount; j++)
+	{
+		uint8_t weight = rowPtr[j];
+		columnSums[j] += weight;
+		rowSum += weight;
+	}
+
+	return rowSum;
+}
+
+
+CenterOfMassMoments accumulateMoments8UC1(const cv::Mat& processingImage, int startRow, int endRow)
+{
+	int columnsCount = processingImage.cols;
+
+	cv::AutoBuffer<uint32_t, 1024> columnSums(columnsCount);
+	std::fill(columnSums.data(), columnSums.data() + columnsCount, 0);
+
+	CenterOfMassMoments moments;
+
+	for (int i = startRow; i < endRow; i++)
+	{
+		uint64_t rowSum = accumulateRow8UC1(processingImage.ptr<uint8_t>(i), columnsCount, columnSums.data());
+
+		moments.ySum += i * rowSum;
+		moments.weightSum += rowSum;
+	}
+
+	for (int j = 0; j < columnsCount; j++)
+	{
+		moments.xSum += (uint64_t)j * columnSums[j];
+	}
+
+	return moments;
+}
+
+
+CenterOfMass makeCenterOfMass(const CenterOfMassMoments& moments)
+{
+	CenterOfMass centerOfMass;
+
+	if (moments.weightSum == 0)
+	{
+		return centerOfMass;
+	}
+
+	uint64_t yCenter = std::round((double_t)moments.ySum / moments.weightSum);
+	uint64_t xCenter = std::round((double_t)moments.xSum / moments.weightSum);
+
+	centerOfMass.center = cv::Point(xCenter, yCenter);
+	centerOfMass.isEmpty = false;
+
+	return centerOfMass;
+}
+
+
+CenterOfMass getCenterOfMass8UC1(const cv::Mat& processingImage, int bandsCount)
+{
+	if (processingImage.type() != CV_8UC1)
+	{
+		throw std::runtime_error("Center of mass expects 8UC1 image");
+	}
+
+	int rowsCount = processingImage.rows;
+
+	if (bandsCount <= 0)
+	{
+		bool isBig = processingImage.total() >= CENTER_OF_MASS_PARALLEL_MIN_PIXELS_COUNT;
+		bandsCount = isBig ? std::min(cv::getNumThreads(), rowsCount / CENTER_OF_MASS_MIN_BAND_ROWS_COUNT) : 1;
+	}
+
+	bandsCount = std::max(std::min(bandsCount, rowsCount), 1);
+
+	if (bandsCount == 1)
+	{
+		return makeCenterOfMass(accumulateMoments8UC1(processingImage, 0, rowsCount));
+	}
+
+	std::vector<CenterOfMassMoments> bandsMoments(bandsCount);
+
+	cv::parallel_for_(cv::Range(0, bandsCount), [&](const cv::Range& range) {
+		for (int band = range.start; band < range.end; band++)
+		{
+			int startRow = rowsCount * band / bandsCount;
+			int endRow = rowsCount * (band + 1) / bandsCount;
+			bandsMoments[band] = accumulateMoments8UC1(processingImage, startRow, endRow);
+		}
+	});
+
+	CenterOfMassMoments moments;
+
+	for (const CenterOfMassMoments& bandMoments : bandsMoments)
+	{
+		moments.xSum += bandMoments.xSum;
+		moments.ySum += bandMoments.ySum;
+		moments.weightSum += bandMoments.weightSum;
+	}
+
+	return makeCenterOfMass(moments);
+}
+
+
+CenterOfMass getCenterOfMass8UC1Reference(const cv::Mat& processingImage)
+{
+	int rowsCount = processingImage.rows;
+	int columnsCount = processingImage.cols;
+
+	CenterOfMassMoments moments;
+
+	for (int i = 0; i < rowsCount; i++)
+	{
+		const uint8_t* rowPtr = processingImage.ptr<uint8_t>(i);
+
+		for (int j = 0; j < columnsCount; j++)
+		{
+			uint64_t weight = rowPtr[j];
+
+			moments.ySum += i * weight;
+			moments.xSum += j * weight;
+			moments.weightSum += weight;
+		}
+	}
+
+	return makeCenterOfMass(moments);
+}
+
+
+DetectedCenter getDetectedCenter(const CenterOfMass& centerOfMass, cv::Size size)
+{
+	DetectedCenter detectedCenter;
+	detectedCenter.center = centerOfMass.isEmpty ? cv::Point(size.width / 2, size.height / 2) : centerOfMass.center;
+	detectedCenter.isFound = !centerOfMass.isEmpty;
+
+	return detectedCenter;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+
+struct CenterOfMass
+{
+	cv::Point center;
+	bool isEmpty = true; // all pixels are zero, center is undefined
+};
+
+
+// center reported by the sclera and pupil detectors
+struct DetectedCenter
+{
+	cv::Point center; // the image center when nothing was found
+	bool isFound = false;
+};
+
+
+struct CenterOfMassMoments
+{
+	uint64_t xSum = 0;
+	uint64_t ySum = 0;
+	uint64_t weightSum = 0;
+};
+
+
+CenterOfMass makeCenterOfMass(const CenterOfMassMoments& moments);
+// bandsCount = 0 splits big images into row bands automatically
+CenterOfMass getCenterOfMass8UC1(const cv::Mat& processingImage, int bandsCount = 0);
+CenterOfMass getCenterOfMass8UC1Reference(const cv::Mat& processingImage);
+// empty center of mass falls back to the center of the image size
+DetectedCenter getDetectedCenter(const CenterOfMass& centerOfMass, cv::Size size);
@@ -1,38 +1,180 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 
 const std::string OPENCV_ENVIRONMENT_VARIABLE_NAME = "OPENCV_DIR";
-const std::string HAAR_CASCADES_RELATIVE_PATH = "\\build\\etc\\haarcascades";
+const std::string HAAR_CASCADES_RELATIVE_PATH = "build/etc/haarcascades";
 const std::string FACE_CASCADE_FILE_NAME = "haarcascade_frontalface_alt2.xml";
 const std::string EYES_CASCADE_FILE_NAME = "haarcascade_righteye_2splits.xml";
+// flat Haar cascades are cached in binary, validated by the source path, size and modification time, then content hash
+const bool IS_CASCADE_CACHE_ENABLED = true;
+const std::string CASCADE_CACHE_RELATIVE_PATH = "CascadeCache";
 const std::string TEST_DATASET_NAME = "dataset_mobile_camera";
 const std::string TEST_IMAGE_NAME = "eyes_right";
 const std::string TEST_IMAGE_EXTENSION = "jpg";
+const std::string CENTER_OF_MASS_DATASET_NAME = "dataset_center_of_mass";
+
+const std::string BATCH_DATASETS_ROOT_PATH = ".";
+const std::string BATCH_DATASET_PREFIX = "dataset_";
+const std::string BATCH_RESULTS_FILE_NAME = "batch_results.csv";
+// sclera:pupil detector pairs separated by commas, e.g. saturation:value,hue:value,roi_center:value;
+// every pair processes the same decoded frames and detected eyes, the first one goes to the batch results,
+// empty runs only the configured detectors
+const std::string BATCH_DETECTOR_VARIANTS = "";
+const std::string BATCH_VARIANT_RESULTS_FILE_NAME = "batch_variant_results.csv";
+
+const std::vector<std::string> BENCHMARK_DATASET_NAMES = { "dataset_mobile_camera_480p", "dataset_mobile_camera_720p", "dataset_mobile_camera" };
+const std::string BENCHMARK_RESULTS_FILE_NAME = "benchmark_results.csv";
+const int BENCHMARK_WARMUP_ITERATIONS_COUNT = 2;
+const int BENCHMARK_ITERATIONS_COUNT = 20;
+const int BENCHMARK_CASCADE_LOAD_ITERATIONS_COUNT = 10;
+const std::vector<std::string> BENCHMARK_EYE_LOCALIZATION_DATASET_NAMES = { "dataset_webcam", "dataset_webcam_light", "dataset_webcam_no_light" };
+
+// sweep grid, zero iterations disable erosion or dilation
+const std::vector<int> SWEEP_PUPIL_THRESHOLDS = { 5, 10, 15, 20, 30, 40 };
+const std::vector<int> SWEEP_SATURATION_SCLERA_THRESHOLDS = { 10, 20, 30, 40, 60 };
+const std::vector<int> SWEEP_HUE_SCLERA_THRESHOLDS = { 10, 20, 30, 45, 60 };
+const std::vector<int> SWEEP_EROSION_ITERATIONS = { 0, 1, 2 };
+const std::vector<int> SWEEP_DILATION_ITERATIONS = { 0, 2, 4 };
+// a mask covering more of the eye than this is a failed detection, same as an empty one
+const double SWEEP_MAX_MASK_COVERAGE = 0.5;
+const std::string SWEEP_RESULTS_FILE_NAME = "sweep_results.csv";
+const std::string SWEEP_PARAMETERS_FILE_NAME = "sweep_parameters.yml";
+
+enum class FrameResultFormat
+{
+	JSON_LINES,
+	BINARY
+};
+
+// per frame face/eye rects and sclera/pupil centers, the path may also be a named pipe
+const bool IS_FRAME_RESULT_STREAM_ENABLED = true;
+const std::string FRAME_RESULT_STREAM_PATH = "frame_results.jsonl";
+const FrameResultFormat FRAME_RESULT_STREAM_FORMAT = FrameResultFormat::JSON_LINES;
 
 const std::string RESULT_IMAGE_RELATIVE_PATH = "EyeTrackingResults";
-const std::string RESULT_IMAGE_EXTENSION = "png";
 const bool IS_RESULT_IMAGE_WRITRE_ENABLED = true;
 
-const bool IS_VIDEO_MODE = false;
+enum class ResultImageEncoder
+{
+	PNG,
+	RAW, // binary PGM/PPM
+	JPEG
+};
+
+const ResultImageEncoder RESULT_IMAGE_ENCODER = ResultImageEncoder::PNG;
+const int RESULT_IMAGE_PNG_COMPRESSION = 1;
+const int RESULT_IMAGE_JPEG_QUALITY = 95;
+
+// result images are encoded and written on a background thread
+const bool IS_RESULT_WRITER_ASYNC = true;
+const int RESULT_WRITER_QUEUE_CAPACITY = 64;
+// a full queue delays the producer up to this time, then the oldest image is dropped
+const int RESULT_WRITER_MAX_DELAY_MS = 200;
+
+enum class ApplicationMode
+{
+	TEST_IMAGE,
+	VIDEO,
+	BATCH,
+	BENCHMARK,
+	SWEEP,
+	SELF_CHECK,
+	HEADLESS_VIDEO
+};
+
+// default mode, overridden at runtime with --mode
+const ApplicationMode APPLICATION_MODE = ApplicationMode::TEST_IMAGE;
+
+// debug tap bodies are compiled in by these switches, whether they run follows the mode, see ProcessingModes:
+// every tap in the image modes with IS_DEBUG, key taps in the video modes with IS_DEBUG_VIDEO_MODE
 const bool IS_DEBUG_VIDEO_MODE = false;
 const bool IS_DEBUG = true;
 const bool IS_DRAWING = true;
 const bool IS_LOGGING = false;
 
+// the fast paths below are switched off at runtime while debug taps run, see ProcessingModes
+const bool IS_PARALLEL_PROCESSING_ENABLED = true;
+
+// sclera (hue, saturation, roi_center) and pupil (value, roi_center) detectors of the eye pipeline, overridden at runtime
+// with --sclera_detector and --pupil_detector; only the planes of the chosen detectors are computed,
+// hue needs the full HSV conversion, saturation and value are computed straight from BGR
+const std::string SCLERA_DETECTOR_NAME = "saturation";
+const std::string PUPIL_DETECTOR_NAME = "value";
+
+// the fused kernel runs only for the saturation sclera and value pupil detectors
+const bool IS_FUSED_EYE_PROCESSING_ENABLED = true;
+const bool IS_MASK_MORPHOLOGY_ENABLED = true;
+const bool IS_VIDEO_PIPELINE_ENABLED = true;
+const int VIDEO_PIPELINE_QUEUE_CAPACITY = 2;
+
+// working Mats of a frame come from a per-thread arena that is reused between frames
+const bool IS_FRAME_ARENA_ENABLED = true;
+const size_t FRAME_ARENA_INITIAL_BLOCK_SIZE = 4 * 1024 * 1024;
+
 const int DEBUG_RESULT_WINDOW_WIDTH = 1000;
 
+// input of the headless video mode, overridden at runtime with --video_file
+const std::string HEADLESS_VIDEO_FILE_PATH = "video.mp4";
+
+// face and eye cascades are evaluated by the flat Haar evaluator instead of cv::CascadeClassifier, detections are the same;
+// scales of images with at least HAAR_CASCADE_PARALLEL_MIN_PIXELS_COUNT pixels run on the processing pool
+const bool IS_HAAR_CASCADE_ENABLED = true;
+const int HAAR_CASCADE_PARALLEL_MIN_PIXELS_COUNT = 320 * 240;
+
 const double FACE_SCALE_FACTOR = 1.3;
 const int FACE_MIN_NEIGHBOURS = 5;
 const int MIN_FACE_RELATIVE_SIZE = 20;
 const int MAX_FACE_RELATIVE_SIZE = 90;
 
+// full frame and tracked face searches run on a copy downscaled so the smallest searched face
+// is FACE_DETECTION_MIN_FACE_WORKING_SIZE pixels wide, eyes are still detected on full resolution crops
+const bool IS_FACE_DETECTION_DOWNSCALE_ENABLED = false;
+const int FACE_DETECTION_MIN_FACE_WORKING_SIZE = 48;
+
+const bool IS_FACE_TRACKING_ENABLED = true;
+const int FACE_TRACKING_SEARCH_EXPANSION = 25;
+const int FACE_TRACKING_REDETECTION_INTERVAL = 30;
+// a redetected face overlapping a tracked one by at least FACE_REDETECTION_MATCH_OVERLAP (IoU) keeps its previous frame eyes
+const double FACE_REDETECTION_MATCH_OVERLAP = 0.3;
+
+// video mode frame equalization: the histogram is sampled every EQUALIZATION_SAMPLING_STEP pixels in both directions,
+// the LUT moves by EQUALIZATION_SMOOTHING towards the new frame and is rebuilt on the full frame
+// when the sampled histogram drifts by more than EQUALIZATION_REBUILD_DRIFT (half L1 distance, 0..1)
+const bool IS_TEMPORAL_EQUALIZATION_ENABLED = true;
+const int EQUALIZATION_SAMPLING_STEP = 4;
+const double EQUALIZATION_SMOOTHING = 0.25;
+const double EQUALIZATION_REBUILD_DRIFT = 0.1;
+
 const double EYE_SCALE_FACTOR = 1.3;
 const int EYE_MIN_NEIGHBOURS = 5;
 const int MIN_EYE_RELATIVE_SIZE = 10;
 const int MAX_EYE_RELATIVE_SIZE = 60;
 
+const int EYE_TRACKING_SEARCH_EXPANSION = 50;
+
+// eyes are searched only in the upper half of the face, extended by half of the biggest eye
+const bool IS_EYE_UPPER_FACE_SEARCH_ENABLED = true;
+// a found eye pair is kept relative to the face rect and follows the tracked face without the eye cascade,
+// the cascade confirms the pair every EYE_PAIR_CONFIRMATION_INTERVAL frames
+const bool IS_EYE_PAIR_PREDICTION_ENABLED = true;
+const int EYE_PAIR_CONFIRMATION_INTERVAL = 5;
+// upper face eye candidates overlapping a better one by more than EYE_CANDIDATE_MAX_OVERLAP (IoU) are dropped,
+// the rest are paired when the smaller eye has at least EYE_PAIR_MIN_SIZE_RATIO of the bigger eye area and the centers
+// are within EYE_PAIR_MAX_VERTICAL_OFFSET percent of the face height; pairs are scored by size ratio, level and
+// symmetry around the face center, candidates by the distance to the previous frame eyes relative to
+// EYE_CANDIDATE_TRACKING_RADIUS percent of the face width. Only the best pair, or the best single eye, is processed.
+const bool IS_EYE_CANDIDATE_FILTERING_ENABLED = true;
+const double EYE_CANDIDATE_MAX_OVERLAP = 0.3;
+const double EYE_PAIR_MIN_SIZE_RATIO = 0.5;
+const int EYE_PAIR_MAX_VERTICAL_OFFSET = 15;
+const int EYE_CANDIDATE_TRACKING_RADIUS = 25;
+
+const int CENTER_OF_MASS_PARALLEL_MIN_PIXELS_COUNT = 512 * 512;
+const int CENTER_OF_MASS_MIN_BAND_ROWS_COUNT = 64;
+
 const int EYE_CUT_TOP_OFFSET = 40;
 const int EYE_CUT_BOTTOM_OFFSET = 0;
 
@@ -58,3 +200,12 @@ const bool IS_PUPIL_EROSION_ENABLED = false;
 const int PUPIL_EROSION_ITERATIONS_COUNT = 2;
 const bool IS_PUPIL_DILATION_ENABLED = false;
 const int PUPIL_DILATION_ITERATIONS_COUNT = 4;
+
+// sub-pixel pupil center voted by the value gradients in a window around the thresholded center,
+// the window radius is PUPIL_REFINEMENT_WINDOW_RELATIVE_SIZE percent of the eye width, at most PUPIL_REFINEMENT_MAX_WINDOW_RADIUS pixels,
+// gradients weaker than PUPIL_REFINEMENT_MIN_GRADIENT_RATIO of the strongest one in the window don't vote
+const bool IS_PUPIL_REFINEMENT_ENABLED = true;
+const int PUPIL_REFINEMENT_WINDOW_RELATIVE_SIZE = 15;
+const int PUPIL_REFINEMENT_MAX_WINDOW_RADIUS = 24;
+const int PUPIL_REFINEMENT_MIN_RADIUS = 2;
+const double PUPIL_REFINEMENT_MIN_GRADIENT_RATIO = 0.3;
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <tuple>
+
+#include "CvUtils.hpp"
 #include "Utils.hpp"
 
 
@@ -19,40 +23,113 @@ cv::Point getMatCenter(cv::Mat& mat)
 }
 
 
-cv::Point getCenterOfMass8UC1(cv::Mat& processingImage)
+cv::Mat drawCenterOfMassDebugImage(const cv::Mat& processingImage, cv::Point center)
 {
-	uint8_t* dataPtr = processingImage.ptr();
-	int rowsCount = processingImage.rows;
-	int columnsCount = processingImage.cols;
-	int channelsCount = processingImage.channels();
+	int rows = processingImage.rows;
+	int cols = processingImage.cols;
+
+	int markerSize = std::min(rows, cols);
+	int markerThickness = std::max(markerSize / 100, 1);
 
-	uint64_t ySum = 0;
-	uint64_t xSum = 0;
-	uint64_t weightSum = 0;
+	cv::Mat coloredImage = cv::Mat(rows, cols, CV_8UC3);
+	cv::cvtColor(processingImage, coloredImage, cv::COLOR_GRAY2BGR);
 
-	for (uint16_t i = 0; i < rowsCount; i++)
+	if (IS_DRAWING)
 	{
-		int rowOffset = i * columnsCount * channelsCount;
+		cv::drawMarker(coloredImage, center, CV_RGB(255, 0, 0), cv::MARKER_CROSS, markerSize, markerThickness, cv::LINE_8);
+	}
 
-		for (uint16_t j = 0; j < columnsCount; j++)
-		{
-			int columnOffset = j * channelsCount;
-			int pixelOffset = rowOffset + columnOffset;
+	return coloredImage;
+}
+
+
+cv::Rect expandRect(const cv::Rect& rect, int expansionPercent, const cv::Size& boundsSize)
+{
+	int horizontalOffset = rect.width * expansionPercent / 100;
+	int verticalOffset = rect.height * expansionPercent / 100;
+
+	cv::Rect expandedRect = cv::Rect(
+		rect.x - horizontalOffset,
+		rect.y - verticalOffset,
+		rect.width + horizontalOffset * 2,
+		rect.height + verticalOffset * 2);
+
+	return expandedRect & cv::Rect(cv::Point(0, 0), boundsSize);
+}
 
-			uint8_t color = dataPtr[pixelOffset];
 
-			uint16_t weight = color;
+cv::Rect getLargestRect(const std::vector<cv::Rect>& rects)
+{
+	cv::Rect largestRect;
 
-			ySum += i * weight;
-			xSum += j * weight;
-			weightSum += weight;
+	for (const cv::Rect& rect : rects)
+	{
+		if (rect.area() > largestRect.area())
+		{
+			largestRect = rect;
 		}
 	}
 
-	uint64_t yCenter = std::round((double_t)ySum / weightSum);
-	uint64_t xCenter = std::round((double_t)xSum / weightSum);
+	return largestRect;
+}
+
+
+double getIntersectionOverUnion(const cv::Rect& first, const cv::Rect& second)
+{
+	int intersectionArea = (first & second).area();
+	int unionArea = first.area() + second.area() - intersectionArea;
+
+	return unionArea > 0 ? (double)intersectionArea / unionArea : 0.0;
+}
+
+
+bool isSameRects(std::vector<cv::Rect> first, std::vector<cv::Rect> second)
+{
+	auto isRectLess = [](const cv::Rect& a, const cv::Rect& b) {
+		return std::tie(a.y, a.x, a.height, a.width) < std::tie(b.y, b.x, b.height, b.width);
+	};
+
+	std::sort(first.begin(), first.end(), isRectLess);
+	std::sort(second.begin(), second.end(), isRectLess);
+
+	return first == second;
+}
+
+
+double ticksToMilliseconds(int64 ticks)
+{
+	return ticks * 1000.0 / cv::getTickFrequency();
+}
+
+
+// same lookup table as cv::equalizeHist builds
+void buildEqualizeHistLut(const int* histogram, int total, uint8_t* lut)
+{
+	std::fill(lut, lut + 256, 0);
+
+	int i = 0;
+	while (i < 256 && histogram[i] == 0)
+	{
+		i++;
+	}
+
+	if (i == 256)
+	{
+		return;
+	}
 
-	cv::Point center = cv::Point(xCenter, yCenter);
+	if (histogram[i] == total)
+	{
+		std::fill(lut, lut + 256, (uint8_t)i);
+		return;
+	}
+
+	float scale = (256 - 1.f) / (total - histogram[i]);
+	int sum = 0;
 
-	return center;
+	for (lut[i++] = 0; i < 256; i++)
+	{
+		sum += histogram[i];
+		lut[i] = cv::saturate_cast<uint8_t>(sum * scale);
+	}
 }
@@ -3,12 +3,20 @@
 #include <iostream>
 #include <fstream>
 
-#include <opencv2/highgui.hpp>
+#include <opencv2/imgproc.hpp>
 
 #include "Constants.hpp"
+#include "CenterOfMass.hpp"
 
 
 int getLineThicknessForMat(cv::Mat& mat, int delimeter = 100, int minValue = 2);
 int getMarkerSizeForMat(cv::Mat& mat, int delimeter = 2, int minValue = 10);
 cv::Point getMatCenter(cv::Mat& mat);
-cv::Point getCenterOfMass8UC1(cv::Mat& processingImage);
+cv::Mat drawCenterOfMassDebugImage(const cv::Mat& processingImage, cv::Point center);
+cv::Rect expandRect(const cv::Rect& rect, int expansionPercent, const cv::Size& boundsSize);
+cv::Rect getLargestRect(const std::vector<cv::Rect>& rects);
+double getIntersectionOverUnion(const cv::Rect& first, const cv::Rect& second);
+// same rects in any order
+bool isSameRects(std::vector<cv::Rect> first, std::vector<cv::Rect> second);
+double ticksToMilliseconds(int64 ticks);
+void buildEqualizeHistLut(const int* histogram, int total, uint8_t* lut);
@@ -0,0 +1,53 @@
+#include "DebugTap.hpp"
+#include "Utils.hpp"
+
+
+// headless default, the viewer installs a sink that also shows the windows
+void writeDebugTapResult(const std::string& tapName, const cv::Mat& image, const DebugWindowLayout& layout)
+{
+	writeResult(tapName, image);
+}
+
+
+DebugTapSink debugTapSink = writeDebugTapResult;
+
+
+void setDebugTapSink(DebugTapSink sink)
+{
+	debugTapSink = sink;
+}
+
+
+// defaults of the default mode until main sets the resolved modes
+bool isDebugActiveFlag = IS_DEBUG;
+bool isKeyDebugActiveFlag = false;
+
+void setDebugTapsActive(bool isDebugActive, bool isKeyDebugActive)
+{
+	isDebugActiveFlag = isDebugActive;
+	isKeyDebugActiveFlag = isKeyDebugActive;
+}
+
+
+bool isDebugTapActive(bool isKeyStage)
+{
+	return isDebugActiveFlag || (isKeyStage && isKeyDebugActiveFlag);
+}
+
+
+void emitDebugTap(const char* stageName, int index, const cv::Mat& image, const DebugWindowLayout& layout)
+{
+	if (!debugTapSink)
+	{
+		return;
+	}
+
+	std::string tapName = stageName;
+
+	if (index >= 0)
+	{
+		tapName += " " + std::to_string(index);
+	}
+
+	debugTapSink(tapName, image, layout);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include <opencv2/core.hpp>
+
+#include "Constants.hpp"
+
+
+struct DebugWindowLayout
+{
+	cv::Point position = cv::Point(-1, -1); // window isn't moved if negative
+	int sizeDivider = 0; // window isn't resized if zero
+};
+
+
+typedef std::function<void(const std::string& tapName, const cv::Mat& image, const DebugWindowLayout& layout)> DebugTapSink;
+
+
+// the default sink writes the tap images as results, without windows
+void setDebugTapSink(DebugTapSink sink);
+// runtime gates of the compiled-in taps, set once at startup from ProcessingModes
+void setDebugTapsActive(bool isDebugActive, bool isKeyDebugActive);
+bool isDebugTapActive(bool isKeyStage);
+void emitDebugTap(const char* stageName, int index, const cv::Mat& image, const DebugWindowLayout& layout);
+
+
+inline DebugWindowLayout makeDebugWindowLayout(int x, int y)
+{
+	DebugWindowLayout layout;
+	layout.position = cv::Point(x, y);
+	return layout;
+}
+
+
+inline DebugWindowLayout makeDebugWindowLayout(int sizeDivider)
+{
+	DebugWindowLayout layout;
+	layout.sizeDivider = sizeDivider;
+	return layout;
+}
+
+
+// Debug taps are compiled in or out: the disabled policy has empty inline bodies,
+// so no window names are formatted and no debug images are built in production builds.
+// Compiled-in taps still run only when their runtime gate is set for the application mode.
+// Stage names are stable, a tap is identified by the stage name and the face/eye index.
+template <bool IsEnabled, bool IsKeyStage>
+struct DebugTapPolicy
+{
+	static void tap(const char* stageName, int index, const cv::Mat& image, const DebugWindowLayout& layout = DebugWindowLayout())
+	{
+	}
+
+	template <typename ImageFactory>
+	static void tapLazy(const char* stageName, int index, ImageFactory&& imageFactory, const DebugWindowLayout& layout = DebugWindowLayout())
+	{
+	}
+};
+
+
+template <bool IsKeyStage>
+struct DebugTapPolicy<true, IsKeyStage>
+{
+	static void tap(const char* stageName, int index, const cv::Mat& image, const DebugWindowLayout& layout = DebugWindowLayout())
+	{
+		if (isDebugTapActive(IsKeyStage))
+		{
+			emitDebugTap(stageName, index, image, layout);
+		}
+	}
+
+	// the image is built only when the tap is active
+	template <typename ImageFactory>
+	static void tapLazy(const char* stageName, int index, ImageFactory&& imageFactory, const DebugWindowLayout& layout = DebugWindowLayout())
+	{
+		if (isDebugTapActive(IsKeyStage))
+		{
+			emitDebugTap(stageName, index, imageFactory(), layout);
+		}
+	}
+};
+
+
+// every intermediate image
+typedef DebugTapPolicy<IS_DEBUG, false> DebugTap;
+// key stages only, also shown in debug video mode
+typedef DebugTapPolicy<IS_DEBUG || IS_DEBUG_VIDEO_MODE, true> KeyDebugTap;
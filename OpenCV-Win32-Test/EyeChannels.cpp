@@ -0,0 +1,117 @@
+#include <array>
+
+#include <opencv2/imgproc.hpp>
+
+#include "EyeChannels.hpp"
+#include "FrameArena.hpp"
+
+
+const int* getSaturationDivisionTable()
+{
+	static const std::array<int, 256> saturationDivisionTable = []() {
+		std::array<int, 256> table;
+		table[0] = 0;
+
+		for (int i = 1; i < 256; i++)
+		{
+			table[i] = cvRound((255 << HSV_SHIFT) / (1.0 * i));
+		}
+
+		return table;
+	}();
+
+	return saturationDivisionTable.data();
+}
+
+
+void computeEyeChannels(const cv::Mat& eyeImage, int channels, cv::Mat& hue, cv::Mat& saturation, cv::Mat& value)
+{
+	CV_Assert(eyeImage.type() == CV_8UC3);
+
+	int rows = eyeImage.rows;
+	int cols = eyeImage.cols;
+
+	bool isHueNeeded = (channels & EYE_CHANNEL_HUE) != 0;
+	bool isSaturationNeeded = (channels & EYE_CHANNEL_SATURATION) != 0;
+	bool isValueNeeded = (channels & EYE_CHANNEL_VALUE) != 0;
+
+	if (isHueNeeded)
+	{
+		hue.create(rows, cols, CV_8UC1);
+	}
+
+	if (isSaturationNeeded)
+	{
+		saturation.create(rows, cols, CV_8UC1);
+	}
+
+	if (isValueNeeded)
+	{
+		value.create(rows, cols, CV_8UC1);
+	}
+
+
+	// full conversion, hue has no shortcut
+
+	if (isHueNeeded)
+	{
+		FrameArenaScope arenaScope;
+		cv::Mat hsvImage = arenaScope.acquire(rows, cols, CV_8UC3);
+
+		cv::cvtColor(eyeImage, hsvImage, cv::COLOR_BGR2HSV);
+
+		cv::extractChannel(hsvImage, hue, 0);
+
+		if (isSaturationNeeded)
+		{
+			cv::extractChannel(hsvImage, saturation, 1);
+		}
+
+		if (isValueNeeded)
+		{
+			cv::extractChannel(hsvImage, value, 2);
+		}
+
+		return;
+	}
+
+	// end full conversion
+
+
+	// saturation and value from BGR
+
+	const int* saturationDivisionTable = getSaturationDivisionTable();
+
+	for (int i = 0; i < rows; i++)
+	{
+		const uint8_t* pixel = eyeImage.ptr<uint8_t>(i);
+
+		if (isSaturationNeeded)
+		{
+			uint8_t* saturationRow = saturation.ptr<uint8_t>(i);
+			uint8_t* valueRow = isValueNeeded ? value.ptr<uint8_t>(i) : nullptr;
+			uint8_t pixelValue = 0;
+
+			for (int j = 0; j < cols; j++, pixel += 3)
+			{
+				computeSaturationValue(pixel, saturationDivisionTable, saturationRow[j], pixelValue);
+
+				if (isValueNeeded)
+				{
+					valueRow[j] = pixelValue;
+				}
+			}
+		}
+		else if (isValueNeeded)
+		{
+			uint8_t* valueRow = value.ptr<uint8_t>(i);
+
+			for (int j = 0; j < cols; j++, pixel += 3)
+			{
+				valueRow[j] = std::max(pixel[0], std::max(pixel[1], pixel[2]));
+			}
+		}
+	}
+
+	// end saturation and value from BGR
+}
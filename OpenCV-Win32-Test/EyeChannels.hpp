@@ -0,0 +1,45 @@
+#pragma once
+
+#include <algorithm>
+
+#include <opencv2/core.hpp>
+
+#include "Constants.hpp"
+
+
+// HSV planes of the eye image, flags of the planes the active detectors read
+enum EyeChannel
+{
+	EYE_CHANNEL_HUE = 1,
+	EYE_CHANNEL_SATURATION = 2,
+	EYE_CHANNEL_VALUE = 4
+};
+
+
+const int HSV_SHIFT = 12;
+
+
+// same fixed point division table as cv::cvtColor uses for 8-bit BGR to HSV
+const int* getSaturationDivisionTable();
+
+
+inline void computeSaturationValue(const uint8_t* pixel, const int* saturationDivisionTable, uint8_t& saturation, uint8_t& value)
+{
+	int b = pixel[0];
+	int g = pixel[1];
+	int r = pixel[2];
+
+	int maxValue = std::max(b, std::max(g, r));
+	int minValue = std::min(b, std::min(g, r));
+	int diff = maxValue - minValue;
+
+	saturation = (uint8_t)((diff * saturationDivisionTable[maxValue] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT);
+	value = (uint8_t)maxValue;
+}
+
+
+// Only the requested planes are written, the others are left untouched.
+// Hue takes the full HSV conversion, saturation and value alone are computed straight from BGR,
+// V as max(B, G, R) and S with the cv::cvtColor fixed point division, so the planes are bit-identical to cv::cvtColor.
+// Requested planes are (re)allocated only when they don't have the eye image size.
+void computeEyeChannels(const cv::Mat& eyeImage, int channels, cv::Mat& hue, cv::Mat& saturation, cv::Mat& value);
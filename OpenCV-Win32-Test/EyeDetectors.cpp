@@ -0,0 +1,108 @@
+#include <stdexcept>
+
+#include "EyeDetectors.hpp"
+#include "PupilProcessing.hpp"
+#include "ScleraProcessing.hpp"
+#include "ScleraProcessingNew.hpp"
+
+
+DetectedCenter detectScleraCenterHuePlane(cv::Mat plane, cv::Size eyeSize, int eyeIndex, const Parameters& parameters)
+{
+	return detectScleraCenterHue(plane, eyeIndex, parameters.hueSclera, parameters.modes.isMaskMorphologyActive);
+}
+
+
+DetectedCenter detectScleraCenterSaturationPlane(cv::Mat plane, cv::Size eyeSize, int eyeIndex, const Parameters& parameters)
+{
+	return detectScleraCenterSaturation(plane, eyeIndex, parameters.saturationSclera, parameters.modes.isMaskMorphologyActive);
+}
+
+
+DetectedCenter detectPupilCenterValuePlane(cv::Mat plane, cv::Size eyeSize, int eyeIndex, const Parameters& parameters)
+{
+	return detectPupilCenterValue(plane, eyeIndex, parameters.pupil, parameters.modes.isMaskMorphologyActive);
+}
+
+
+// baseline without a plane, same as getMatCenter of the cut eye image, it never finds anything
+DetectedCenter getEyeRoiCenter(cv::Mat plane, cv::Size eyeSize, int eyeIndex, const Parameters& parameters)
+{
+	return getDetectedCenter(CenterOfMass(), eyeSize);
+}
+
+
+const std::vector<CenterDetector>& getScleraDetectors()
+{
+	static const std::vector<CenterDetector> scleraDetectors = {
+		{ "hue", EYE_CHANNEL_HUE, detectScleraCenterHuePlane },
+		{ "saturation", EYE_CHANNEL_SATURATION, detectScleraCenterSaturationPlane },
+		{ "roi_center", 0, getEyeRoiCenter }
+	};
+
+	return scleraDetectors;
+}
+
+
+const std::vector<CenterDetector>& getPupilDetectors()
+{
+	static const std::vector<CenterDetector> pupilDetectors = {
+		{ "value", EYE_CHANNEL_VALUE, detectPupilCenterValuePlane },
+		{ "roi_center", 0, getEyeRoiCenter }
+	};
+
+	return pupilDetectors;
+}
+
+
+const CenterDetector* findCenterDetector(const std::vector<CenterDetector>& detectors, const std::string& name, const std::string& kind)
+{
+	for (const CenterDetector& detector : detectors)
+	{
+		if (detector.name == name)
+		{
+			return &detector;
+		}
+	}
+
+	throw std::runtime_error("Unknown " + kind + " detector: " + name);
+}
+
+
+EyeDetectors getEyeDetectors(const EyeDetectorParameters& parameters)
+{
+	EyeDetectors detectors;
+	detectors.scleraDetector = findCenterDetector(getScleraDetectors(), parameters.scleraDetector, "sclera");
+	detectors.pupilDetector = findCenterDetector(getPupilDetectors(), parameters.pupilDetector, "pupil");
+	detectors.isFused = detectors.scleraDetector->detectCenter == detectScleraCenterSaturationPlane &&
+		detectors.pupilDetector->detectCenter == detectPupilCenterValuePlane;
+
+	return detectors;
+}
+
+
+int getEyeChannels(const EyeDetectors& detectors)
+{
+	return detectors.scleraDetector->channel | detectors.pupilDetector->channel;
+}
+
+
+cv::Mat getEyeChannelPlane(int channel, const cv::Mat& hue, const cv::Mat& saturation, const cv::Mat& value)
+{
+	switch (channel)
+	{
+	case EYE_CHANNEL_HUE:
+		return hue;
+	case EYE_CHANNEL_SATURATION:
+		return saturation;
+	case EYE_CHANNEL_VALUE:
+		return value;
+	default:
+		return cv::Mat();
+	}
+}
+
+
+std::string getEyeDetectorsName(const EyeDetectorParameters& parameters)
+{
+	return parameters.scleraDetector + ":" + parameters.pupilDetector;
+}
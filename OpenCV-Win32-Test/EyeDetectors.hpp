@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "CenterOfMass.hpp"
+#include "Constants.hpp"
+#include "EyeChannels.hpp"
+#include "Parameters.hpp"
+
+
+// Sclera or pupil detector: reads one plane of the cut eye image and returns the center in eye image coordinates,
+// not found when its mask is empty.
+// Detectors are plain functions looked up by name, the call goes through a function pointer once per eye
+// and the per-pixel loops stay inside the detectors.
+typedef DetectedCenter (*CenterDetectorFunction)(cv::Mat plane, cv::Size eyeSize, int eyeIndex, const Parameters& parameters);
+
+
+struct CenterDetector
+{
+	std::string name;
+	int channel = 0; // EyeChannel flag of the plane, 0 when no plane is read
+	CenterDetectorFunction detectCenter = nullptr;
+};
+
+
+const std::vector<CenterDetector>& getScleraDetectors();
+const std::vector<CenterDetector>& getPupilDetectors();
+// throws for unknown names, Parameters keep the resolved detectors, see resolveEyeDetectors
+EyeDetectors getEyeDetectors(const EyeDetectorParameters& parameters);
+// planes read by the detectors
+int getEyeChannels(const EyeDetectors& detectors);
+// plane of the channel flag, empty for 0
+cv::Mat getEyeChannelPlane(int channel, const cv::Mat& hue, const cv::Mat& saturation, const cv::Mat& value);
+std::string getEyeDetectorsName(const EyeDetectorParameters& parameters);
@@ -1,151 +1,189 @@
 #include "EyeProcessing.hpp"
 #include "CvUtils.hpp"
-#include "Utils.hpp"
+#include "DebugTap.hpp"
+#include "EyeChannels.hpp"
+#include "EyeDetectors.hpp"
+#include "ThreadPool.hpp"
+#include "FusedEyeProcessing.hpp"
+#include "FrameArena.hpp"
 
 
-void processEye(cv::Mat eyeRoi, int eyeIndex)
+DebugWindowLayout getEyeDebugWindowLayout(int eyeIndex, int row)
 {
-	cv::Mat processingImage;
-	std::stringstream windowNameStringStream;
-	std::string windowName;
+	return makeDebugWindowLayout(100 + eyeIndex * 200, 50 + row * 100);
+}
 
-	int windowOffsetX = 100 + (int)eyeIndex * 200;
-	int windowOffsetY = 50 + (int)eyeIndex * 0;
 
-	// clone for editing
-	processingImage = eyeRoi.clone();
+cv::Range getEyeCutRowsRange(const cv::Mat& eyeRoi, const EyeDetectionParameters& parameters)
+{
+	int rowsCount = eyeRoi.rows;
 
-	if (IS_DEBUG)
-	{
-		windowNameStringStream << "Eye " << eyeIndex << " source";
-		windowName = windowNameStringStream.str();
-		cv::imshow(windowName, processingImage);
-		cv::moveWindow(windowName, windowOffsetX, windowOffsetY);
-		windowNameStringStream.str("");
+	int topOffset = rowsCount * parameters.cutTopOffset / 100;
+	int bottomOffset = rowsCount * parameters.cutBottomOffset / 100;
 
-		writeResult(windowName, processingImage);
+	return cv::Range(topOffset, rowsCount - bottomOffset);
+}
 
-		windowOffsetY += 100;
-	}
-	// end clone for editing
 
+EyeCenters processEye(cv::Mat eyeRoi, int eyeIndex, const Parameters& parameters)
+{
+	cv::Mat processingImage;
 
-	// cut top and bottom
-	int rowsCount = processingImage.rows;
-	int colsCount = processingImage.cols;
+	DebugTap::tap("Eye source", eyeIndex, eyeRoi, getEyeDebugWindowLayout(eyeIndex, 0));
 
-	int topOffset = rowsCount * EYE_CUT_TOP_OFFSET / 100;
-	int bottomOffset = rowsCount * EYE_CUT_BOTTOM_OFFSET / 100;
 
-	cv::Range rowsRange = cv::Range(topOffset, rowsCount - bottomOffset);
-	cv::Range colsRange = cv::Range(0, colsCount);
+	// cut top and bottom
+	cv::Range rowsRange = getEyeCutRowsRange(eyeRoi, parameters.eye);
+	cv::Range colsRange = cv::Range(0, eyeRoi.cols);
+	int topOffset = rowsRange.start;
 
-	processingImage = processingImage(rowsRange, colsRange);
+	processingImage = eyeRoi(rowsRange, colsRange);
 
-	if (IS_DEBUG)
-	{
-		windowNameStringStream << "Eye " << eyeIndex << " cut brow";
-		windowName = windowNameStringStream.str();
-		cv::imshow(windowName, processingImage);
-		cv::moveWindow(windowName, windowOffsetX, windowOffsetY);
-		windowNameStringStream.str("");
+	DebugTap::tap("Eye cut brow", eyeIndex, processingImage, getEyeDebugWindowLayout(eyeIndex, 1));
+	// end cutting top and bottom
 
-		writeResult(windowName, processingImage);
+	EyeCenters eyeCenters = parameters.modes.isFusedEyeProcessingActive && parameters.eyeDetectors.isFused ?
+		detectEyeCentersFused(processingImage, parameters) :
+		detectEyeCentersSeparated(processingImage, eyeIndex, parameters);
 
-		windowOffsetY += 100;
-	}
-	// end cutting top and bottom
 
+	// sub-pixel pupil center
+
+	eyeCenters.refinedPupilCenter = cv::Point2f((float)eyeCenters.pupilCenter.x, (float)eyeCenters.pupilCenter.y);
 
-	// convert to HSV
-	cv::cvtColor(processingImage, processingImage, cv::COLOR_BGR2HSV);
+	// an empty pupil mask leaves nothing to refine, the roi_center baseline has no mask and is refined from the center
+	bool isPupilSeeded = eyeCenters.isPupilFound || parameters.eyeDetectors.pupilDetector->channel == 0;
 
-	if (IS_DEBUG)
+	if (parameters.pupilRefinement.isEnabled && isPupilSeeded)
 	{
-		windowNameStringStream << "Eye " << eyeIndex << " HSV";
-		windowName = windowNameStringStream.str();
-		cv::imshow(windowName, processingImage);
-		cv::moveWindow(windowName, windowOffsetX, windowOffsetY);
-		windowNameStringStream.str("");
+		PupilRefinement refinement = refinePupilCenter(processingImage, eyeCenters.pupilCenter, parameters.pupilRefinement);
+		eyeCenters.refinedPupilCenter = refinement.center;
+		eyeCenters.pupilRefinementTicks = refinement.ticks;
+	}
 
-		writeResult(windowName, processingImage);
+	// end sub-pixel pupil center
 
-		windowOffsetY += 100;
-	}
-	// end convert to HSV
+	eyeCenters.scleraCenter.y += topOffset;
+	eyeCenters.pupilCenter.y += topOffset;
+	eyeCenters.refinedPupilCenter.y += topOffset;
+
+	return eyeCenters;
+}
 
 
-	// separate channels
+EyeCenters detectEyeCentersSeparated(const cv::Mat& eyeImage, int eyeIndex, const Parameters& parameters)
+{
+	// the planes are only needed until the detectors return
+	FrameArenaScope arenaScope;
 
-	int rows = processingImage.rows;
-	int cols = processingImage.cols;
+	int rows = eyeImage.rows;
+	int cols = eyeImage.cols;
 
-	cv::Mat hue = cv::Mat(rows, cols, CV_8UC1);
-	cv::Mat saturation = cv::Mat(rows, cols, CV_8UC1);
-	cv::Mat value = cv::Mat(rows, cols, CV_8UC1);
 
-	std::vector<cv::Mat> separatedChannels = { hue, saturation, value };
+	// planes of the chosen detectors, the source eye ROI stays untouched
 
-	cv::split(processingImage, separatedChannels);
+	const EyeDetectors& detectors = parameters.eyeDetectors;
+	int channels = getEyeChannels(detectors);
 
-	if (IS_DEBUG)
-	{
-		windowNameStringStream << "Hue " << eyeIndex << " ";
-		windowName = windowNameStringStream.str();
-		cv::imshow(windowName, hue);
-		cv::moveWindow(windowName, windowOffsetX, windowOffsetY);
-		windowNameStringStream.str("");
+	cv::Mat hue;
+	cv::Mat saturation;
+	cv::Mat value;
 
-		writeResult(windowName, hue);
+	if (channels & EYE_CHANNEL_HUE)
+	{
+		hue = arenaScope.acquire(rows, cols, CV_8UC1);
+	}
 
-		windowOffsetY += 100;
+	if (channels & EYE_CHANNEL_SATURATION)
+	{
+		saturation = arenaScope.acquire(rows, cols, CV_8UC1);
 	}
 
-	if (IS_DEBUG)
+	if (channels & EYE_CHANNEL_VALUE)
 	{
-		windowNameStringStream << "Saturation " << eyeIndex << " ";
-		windowName = windowNameStringStream.str();
-		cv::imshow(windowName, saturation);
-		cv::moveWindow(windowName, windowOffsetX, windowOffsetY);
-		windowNameStringStream.str("");
+		value = arenaScope.acquire(rows, cols, CV_8UC1);
+	}
 
-		writeResult(windowName, saturation);
+	computeEyeChannels(eyeImage, channels, hue, saturation, value);
 
-		windowOffsetY += 100;
+	if (!hue.empty())
+	{
+		DebugTap::tap("Hue", eyeIndex, hue, getEyeDebugWindowLayout(eyeIndex, 3));
 	}
 
-	if (IS_DEBUG)
+	if (!saturation.empty())
 	{
-		windowNameStringStream << "Value " << eyeIndex << " ";
-		windowName = windowNameStringStream.str();
-		cv::imshow(windowName, value);
-		cv::moveWindow(windowName, windowOffsetX, windowOffsetY);
-		windowNameStringStream.str("");
-
-		writeResult(windowName, value);
-
-		windowOffsetY += 100;
+		DebugTap::tap("Saturation", eyeIndex, saturation, getEyeDebugWindowLayout(eyeIndex, 4));
 	}
 
-	// end channels separation
+	if (!value.empty())
+	{
+		DebugTap::tap("Value", eyeIndex, value, getEyeDebugWindowLayout(eyeIndex, 5));
+	}
 
-	//cv::Point scleraCenter = detectScleraCenterHue(hue, eyeIndex);
-	cv::Point scleraCenter = detectScleraCenterSaturation(saturation, eyeIndex);
-	//cv::Point scleraCenter = getMatCenter(value);
-	cv::Point pupilCenter = detectPupilCenterValue(value, eyeIndex);
+	// end planes
 
-	scleraCenter.y += topOffset;
-	pupilCenter.y += topOffset;
+	const CenterDetector& scleraDetector = *detectors.scleraDetector;
+	const CenterDetector& pupilDetector = *detectors.pupilDetector;
+	cv::Mat scleraPlane = getEyeChannelPlane(scleraDetector.channel, hue, saturation, value);
+	cv::Mat pupilPlane = getEyeChannelPlane(pupilDetector.channel, hue, saturation, value);
+	cv::Size eyeSize = eyeImage.size();
 
+	EyeCenters eyeCenters;
+	DetectedCenter scleraCenter;
+	DetectedCenter pupilCenter;
 
-	if (IS_DRAWING)
+	// detectors without a plane aren't worth a task
+	if (parameters.modes.isParallelProcessingActive && scleraDetector.channel != 0 && pupilDetector.channel != 0)
+	{
+		ThreadPool& threadPool = getProcessingThreadPool();
+
+		std::future<DetectedCenter> scleraCenterFuture = threadPool.enqueue([&scleraDetector, scleraPlane, eyeSize, eyeIndex, &parameters]() {
+			return scleraDetector.detectCenter(scleraPlane, eyeSize, eyeIndex, parameters);
+		});
+
+		try
+		{
+			pupilCenter = pupilDetector.detectCenter(pupilPlane, eyeSize, eyeIndex, parameters);
+		}
+		catch (...)
+		{
+			// the sclera task references the detector and the parameters, its own error is dropped
+			try
+			{
+				threadPool.wait(scleraCenterFuture);
+			}
+			catch (...)
+			{
+			}
+
+			throw;
+		}
+
+		scleraCenter = threadPool.wait(scleraCenterFuture);
+	}
+	else
 	{
-		int markerSize = getMarkerSizeForMat(eyeRoi, 20, 2);
-		int thickness = getLineThicknessForMat(eyeRoi, 30, 1);
-		int lineType = cv::LINE_8;
-		cv::Point roiCenter = getMatCenter(eyeRoi);
-		cv::drawMarker(eyeRoi, roiCenter, CV_RGB(255, 255, 0), cv::MARKER_DIAMOND, markerSize, thickness, lineType);
-		cv::drawMarker(eyeRoi, scleraCenter, CV_RGB(0, 255, 0), cv::MARKER_DIAMOND, markerSize, thickness, lineType);
-		cv::drawMarker(eyeRoi, pupilCenter, CV_RGB(255, 0, 0), cv::MARKER_DIAMOND, markerSize, thickness, lineType);
+		scleraCenter = scleraDetector.detectCenter(scleraPlane, eyeSize, eyeIndex, parameters);
+		pupilCenter = pupilDetector.detectCenter(pupilPlane, eyeSize, eyeIndex, parameters);
 	}
+
+	eyeCenters.scleraCenter = scleraCenter.center;
+	eyeCenters.isScleraFound = scleraCenter.isFound;
+	eyeCenters.pupilCenter = pupilCenter.center;
+	eyeCenters.isPupilFound = pupilCenter.isFound;
+
+	return eyeCenters;
+}
+
+
+void drawEyeCenters(cv::Mat eyeRoi, const EyeCenters& eyeCenters)
+{
+	int markerSize = getMarkerSizeForMat(eyeRoi, 20, 2);
+	int thickness = getLineThicknessForMat(eyeRoi, 30, 1);
+	int lineType = cv::LINE_8;
+	cv::Point roiCenter = getMatCenter(eyeRoi);
+	cv::drawMarker(eyeRoi, roiCenter, CV_RGB(255, 255, 0), cv::MARKER_DIAMOND, markerSize, thickness, lineType);
+	cv::drawMarker(eyeRoi, eyeCenters.scleraCenter, CV_RGB(0, 255, 0), cv::MARKER_DIAMOND, markerSize, thickness, lineType);
+	cv::drawMarker(eyeRoi, eyeCenters.pupilCenter, CV_RGB(255, 0, 0), cv::MARKER_DIAMOND, markerSize, thickness, lineType);
 }
@@ -1,9 +1,27 @@
 #pragma once
 
 #include "Constants.hpp"
+#include "Parameters.hpp"
 #include "ScleraProcessing.hpp"
 #include "ScleraProcessingNew.hpp"
 #include "PupilProcessing.hpp"
+#include "PupilRefinement.hpp"
 
 
-void processEye(cv::Mat eyeRoi, int eyeIndex);
+struct EyeCenters
+{
+	cv::Point scleraCenter; // eye image center when not found
+	cv::Point pupilCenter; // eye image center when not found
+	bool isScleraFound = false;
+	bool isPupilFound = false;
+	cv::Point2f refinedPupilCenter; // pupilCenter when the refinement is disabled or has no edges to vote
+	int64 pupilRefinementTicks = 0;
+};
+
+
+// brow and bottom rows excluded from the eye analysis
+cv::Range getEyeCutRowsRange(const cv::Mat& eyeRoi, const EyeDetectionParameters& parameters);
+EyeCenters processEye(cv::Mat eyeRoi, int eyeIndex, const Parameters& parameters);
+// planes of the chosen detectors and the separate detectors, every stage is debug tapped
+EyeCenters detectEyeCentersSeparated(const cv::Mat& eyeImage, int eyeIndex, const Parameters& parameters);
+void drawEyeCenters(cv::Mat eyeRoi, const EyeCenters& eyeCenters);
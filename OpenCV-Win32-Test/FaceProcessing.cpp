@@ -1,30 +1,42 @@
 #include "FaceProcessing.hpp"
 #include "CvUtils.hpp"
-#include "Utils.hpp"
+#include "DebugTap.hpp"
+#include "FrameArena.hpp"
+#include "ThreadPool.hpp"
 
 
-void processFaceDetection(cv::CascadeClassifier& face_cascade, cv::CascadeClassifier& eyes_cascade, cv::Mat& sourceImage)
+cv::Rect getEyeFrameRect(const FaceDetectionResult& faceResult, const EyeDetectionResult& eyeResult)
+{
+	return eyeResult.eyeRect + faceResult.faceRect.tl();
+}
+
+
+cv::Point getEyeFramePoint(const FaceDetectionResult& faceResult, const EyeDetectionResult& eyeResult, cv::Point eyePoint)
+{
+	return eyePoint + eyeResult.eyeRect.tl() + faceResult.faceRect.tl();
+}
+
+
+cv::Point2f getEyeFramePoint(const FaceDetectionResult& faceResult, const EyeDetectionResult& eyeResult, cv::Point2f eyePoint)
+{
+	cv::Point offset = eyeResult.eyeRect.tl() + faceResult.faceRect.tl();
+
+	return cv::Point2f(eyePoint.x + offset.x, eyePoint.y + offset.y);
+}
+
+
+std::vector<FaceDetectionResult> detectFacesAndEyes(DetectionCascade& face_cascade, DetectionCascade& eyes_cascade, cv::Mat& sourceImage, FaceTrackingState& trackingState, const Parameters& parameters)
 {
 	int facesCount = 0;
 	int eyesCount = 0;
 	int pupilsCount = 0;
 
-	cv::Mat processingImage;
+	FrameArenaScope arenaScope;
+	cv::Mat processingImage = arenaScope.acquire(sourceImage.size(), CV_8UC1);
 
 	// original image
 
-	if (IS_DEBUG)
-	{
-		std::stringstream windowNameStringStream;
-		windowNameStringStream << "Face original";
-		std::string faceWindowName = windowNameStringStream.str();
-		cv::namedWindow(faceWindowName, cv::WINDOW_NORMAL);
-		cv::imshow(faceWindowName, sourceImage);
-		cv::resizeWindow(faceWindowName, sourceImage.size() / 4);
-		windowNameStringStream.str("");
-
-		writeResult(faceWindowName, sourceImage);
-	}
+	DebugTap::tap("Face original", -1, sourceImage, makeDebugWindowLayout(4));
 
 	// end original image
 
@@ -33,52 +45,30 @@ void processFaceDetection(cv::CascadeClassifier& face_cascade, cv::CascadeClassi
 
 	cv::cvtColor(sourceImage, processingImage, cv::COLOR_BGR2GRAY);
 
-	if (IS_DEBUG)
-	{
-		std::stringstream windowNameStringStream;
-		windowNameStringStream << "Face grayscale";
-		std::string faceWindowName = windowNameStringStream.str();
-		cv::namedWindow(faceWindowName, cv::WINDOW_NORMAL);
-		cv::imshow(faceWindowName, processingImage);
-		cv::resizeWindow(faceWindowName, processingImage.size() / 4);
-		windowNameStringStream.str("");
-
-		writeResult(faceWindowName, processingImage);
-	}
+	DebugTap::tap("Face grayscale", -1, processingImage, makeDebugWindowLayout(4));
 
 	// end grayscale
 
 
-	// histogram equalization
+	// histogram equalization, video frames reuse the LUT of the previous frames
 
-	cv::equalizeHist(processingImage, processingImage);
+	equalizeFrame(processingImage, trackingState, parameters);
 
-	if (IS_DEBUG)
-	{
-		std::stringstream windowNameStringStream;
-		windowNameStringStream << "Face histogram equalization";
-		std::string faceWindowName = windowNameStringStream.str();
-		cv::namedWindow(faceWindowName, cv::WINDOW_NORMAL);
-		cv::imshow(faceWindowName, processingImage);
-		cv::resizeWindow(faceWindowName, processingImage.size() / 4);
-		windowNameStringStream.str("");
-
-		writeResult(faceWindowName, processingImage);
-	}
+	DebugTap::tap("Face histogram equalization", -1, processingImage, makeDebugWindowLayout(4));
 
 	// end histogram equalization
 
 
-	cv::Size imageSize = processingImage.size();
-	cv::Size minFaceSize = imageSize * MIN_FACE_RELATIVE_SIZE / 100;
-	cv::Size maxFaceSize = imageSize * MAX_FACE_RELATIVE_SIZE / 100;
+	int64 detectionTicks = cv::getTickCount();
 
 	std::vector<cv::Rect> faceRects;
-	face_cascade.detectMultiScale(processingImage, faceRects, FACE_SCALE_FACTOR, FACE_MIN_NEIGHBOURS, 0, minFaceSize, maxFaceSize);
+	bool isTrackedFrame = detectFaces(face_cascade, processingImage, trackingState, parameters.face, faceRects);
+
+	detectionTicks = cv::getTickCount() - detectionTicks;
 
 	facesCount += faceRects.size();
 
-	std::stringstream windowNameStringStream;
+	std::vector<FaceDetectionResult> faceResults(faceRects.size());
 
 	for (size_t faceIndex = 0; faceIndex < faceRects.size(); faceIndex++)
 	{
@@ -86,114 +76,195 @@ void processFaceDetection(cv::CascadeClassifier& face_cascade, cv::CascadeClassi
 		cv::Mat faceRoi = processingImage(faceRect);
 		cv::Mat originalFaceRoi = sourceImage(faceRect);
 
-		if (IS_DEBUG)
-		{
-			windowNameStringStream << "Face " << faceIndex << " grayscale";
-			std::string faceWindowName = windowNameStringStream.str();
-			cv::namedWindow(faceWindowName, cv::WINDOW_NORMAL);
-			cv::imshow(faceWindowName, faceRoi);
-			cv::resizeWindow(faceWindowName, faceRect.size() / 2);
-			windowNameStringStream.str("");
-
-			writeResult(faceWindowName, faceRoi);
-		}
+		FaceDetectionResult& faceResult = faceResults[faceIndex];
+		faceResult.faceRect = faceRect;
 
-		if (IS_DEBUG)
-		{
-			windowNameStringStream << "Face " << faceIndex << " colored";
-			std::string faceWindowName = windowNameStringStream.str();
-			cv::namedWindow(faceWindowName, cv::WINDOW_NORMAL);
-			cv::imshow(faceWindowName, originalFaceRoi);
-			cv::resizeWindow(faceWindowName, faceRect.size() / 2);
-			windowNameStringStream.str("");
-
-			writeResult(faceWindowName, originalFaceRoi);
-		}
+		DebugTap::tap("Face ROI grayscale", (int)faceIndex, faceRoi, makeDebugWindowLayout(2));
 
-		if (IS_DRAWING)
-		{
-			int thickness = getLineThicknessForMat(sourceImage, 200);
-			cv::rectangle(sourceImage, faceRect, CV_RGB(255, 0, 0), thickness);
-		}
+		DebugTap::tap("Face ROI colored", (int)faceIndex, originalFaceRoi, makeDebugWindowLayout(2));
 
-		cv::Size faceSize = faceRect.size();
-		cv::Size minEyeSize = faceSize * MIN_EYE_RELATIVE_SIZE / 100;
-		cv::Size maxEyeSize = faceSize * MAX_EYE_RELATIVE_SIZE / 100;
+		int64 eyesDetectionTicks = cv::getTickCount();
 
 		std::vector<cv::Rect> eyeRects;
-		eyes_cascade.detectMultiScale(faceRoi, eyeRects, EYE_SCALE_FACTOR, EYE_MIN_NEIGHBOURS, 0, minEyeSize, maxEyeSize);
+		detectEyes(eyes_cascade, faceRoi, trackingState, faceIndex, isTrackedFrame, parameters.eye, eyeRects);
 		eyesCount += eyeRects.size();
 
-		for (size_t eyeIndex = 0; eyeIndex < eyeRects.size(); eyeIndex++)
+		detectionTicks += cv::getTickCount() - eyesDetectionTicks;
+
+		// duplicates and implausible eyes don't get the eye processing
+		std::vector<cv::Rect>& selectedEyeRects = trackingState.selectedEyeRects[faceIndex];
+		std::vector<size_t> selectedEyeIndices = selectEyeCandidates(eyeRects, faceRect.size(), selectedEyeRects, parameters.eye);
+
+		trackingState.statistics.eyeCandidatesCount += eyeRects.size();
+		trackingState.statistics.skippedEyeCandidatesCount += eyeRects.size() - selectedEyeIndices.size();
+		selectedEyeRects.clear();
+
+		// the eye index is the position in the selection, left to right, not the cascade order
+		for (size_t eyeIndex = 0; eyeIndex < selectedEyeIndices.size(); eyeIndex++)
 		{
-			cv::Rect eyeRect = eyeRects[eyeIndex];
+			cv::Rect eyeRect = eyeRects[selectedEyeIndices[eyeIndex]];
+			selectedEyeRects.push_back(eyeRect);
+
+			cv::Mat eyeRoi = faceRoi(eyeRect);
+			cv::Mat originalEyeRoi = originalFaceRoi(eyeRect);
+
+			DebugTap::tap("Eye grayscale", (int)eyeIndex, eyeRoi, makeDebugWindowLayout(200, 500 + (int)eyeIndex * 50));
+
+			DebugTap::tap("Eye colored", (int)eyeIndex, originalEyeRoi, makeDebugWindowLayout(300, 600 + (int)eyeIndex * 50));
+
+			EyeDetectionResult eyeResult;
+			eyeResult.eyeIndex = (int)eyeIndex;
+			eyeResult.eyeRect = eyeRect;
+			faceResult.eyes.push_back(eyeResult);
+
+			// NOTE: HSV, compare skin and sclera saturation on colored image
+			// NOTE: encode HSV and show as BGR https://stackoverflow.com/questions/3017538/opencv-image-conversion-from-rgb-to-hsv
+			// NOTE: compare skin and sclera color on colored image (especially R and B)
+			// NOTE: eye = sclera + pupil
+		}
+	}
+
+	registerDetectionLatency(trackingState, isTrackedFrame, detectionTicks);
 
-			int eyeCenterX = eyeRect.x + eyeRect.width / 2;
-			int eyeCenterY = eyeRect.y + eyeRect.height / 2;
+	if (IS_LOGGING)
+	{
+		std::cout << "Faces/Eyes/Pupils : " << facesCount << "/" << eyesCount << "/" << pupilsCount << std::endl;
+	}
+
+	return faceResults;
+}
+
+
+void processEyes(cv::Mat& sourceImage, std::vector<FaceDetectionResult>& faceResults, const Parameters& parameters)
+{
+	if (parameters.modes.isParallelProcessingActive)
+	{
+		ThreadPool& threadPool = getProcessingThreadPool();
+		std::vector<std::future<EyeCenters>> eyeCentersFutures;
 
-			#pragma MARK - eye removing condition
-			// MARK: eye removing condition
-			if (eyeCenterY > faceRect.height / 2)
+		for (FaceDetectionResult& faceResult : faceResults)
+		{
+			cv::Mat originalFaceRoi = sourceImage(faceResult.faceRect);
+
+			for (EyeDetectionResult& eyeResult : faceResult.eyes)
 			{
-				continue;
+				cv::Mat originalEyeRoi = originalFaceRoi(eyeResult.eyeRect);
+				int eyeIndex = eyeResult.eyeIndex;
+
+				eyeCentersFutures.push_back(threadPool.enqueue([originalEyeRoi, eyeIndex, &parameters]() {
+					return processEye(originalEyeRoi, eyeIndex, parameters);
+				}));
 			}
+		}
 
-			cv::Mat eyeRoi = faceRoi(eyeRect);
-			cv::Mat originalEyeRoi = originalFaceRoi(eyeRect);
+		size_t futureIndex = 0;
 
-			if (IS_DEBUG)
+		// the tasks reference the parameters, none of them may outlive a throwing eye
+		try
+		{
+			for (FaceDetectionResult& faceResult : faceResults)
 			{
-				windowNameStringStream << "Eye " << eyeIndex << " grayscale";
-				std::string windowName = windowNameStringStream.str();
-				cv::namedWindow(windowName, cv::WINDOW_NORMAL);
-				cv::imshow(windowName, eyeRoi);
-				cv::moveWindow(windowName, 200, 500 + eyeIndex * 50);
-				windowNameStringStream.str("");
-
-				writeResult(windowName, eyeRoi);
+				for (EyeDetectionResult& eyeResult : faceResult.eyes)
+				{
+					eyeResult.eyeCenters = threadPool.wait(eyeCentersFutures[futureIndex++]);
+				}
 			}
+		}
+		catch (...)
+		{
+			threadPool.drain(eyeCentersFutures);
+			throw;
+		}
+	}
+	else
+	{
+		for (FaceDetectionResult& faceResult : faceResults)
+		{
+			cv::Mat originalFaceRoi = sourceImage(faceResult.faceRect);
 
-			if (IS_DEBUG)
+			for (EyeDetectionResult& eyeResult : faceResult.eyes)
 			{
-				windowNameStringStream << "Eye " << eyeIndex << " colored";
-				std::string windowName = windowNameStringStream.str();
-				cv::namedWindow(windowName, cv::WINDOW_NORMAL);
-				cv::imshow(windowName, originalEyeRoi);
-				cv::moveWindow(windowName, 300, 600 + eyeIndex * 50);
-				windowNameStringStream.str("");
-
-				writeResult(windowName, originalEyeRoi);
+				eyeResult.eyeCenters = processEye(originalFaceRoi(eyeResult.eyeRect), eyeResult.eyeIndex, parameters);
 			}
+		}
+	}
+}
 
-			processEye(originalEyeRoi, eyeIndex);
 
+void drawFaceDetectionResults(cv::Mat& sourceImage, const std::vector<FaceDetectionResult>& faceResults)
+{
+	for (size_t faceIndex = 0; faceIndex < faceResults.size(); faceIndex++)
+	{
+		const FaceDetectionResult& faceResult = faceResults[faceIndex];
+		cv::Rect faceRect = faceResult.faceRect;
+		cv::Mat originalFaceRoi = sourceImage(faceRect);
+
+		if (IS_DRAWING)
+		{
+			int thickness = getLineThicknessForMat(sourceImage, 200);
+			cv::rectangle(sourceImage, faceRect, CV_RGB(255, 0, 0), thickness);
+		}
+
+		for (const EyeDetectionResult& eyeResult : faceResult.eyes)
+		{
 			if (IS_DRAWING)
 			{
+				drawEyeCenters(originalFaceRoi(eyeResult.eyeRect), eyeResult.eyeCenters);
+
 				int thickness = getLineThicknessForMat(originalFaceRoi, 100);
-				cv::rectangle(originalFaceRoi, eyeRect, CV_RGB(0, 255, 0), thickness);
+				cv::rectangle(originalFaceRoi, eyeResult.eyeRect, CV_RGB(0, 255, 0), thickness);
 			}
-
-			// NOTE: HSV, compare skin and sclera saturation on colored image
-			// NOTE: encode HSV and show as BGR https://stackoverflow.com/questions/3017538/opencv-image-conversion-from-rgb-to-hsv
-			// NOTE: compare skin and sclera color on colored image (especially R and B)
-			// NOTE: eye = sclera + pupil
 		}
 
-		if (IS_DEBUG)
-		{
-			windowNameStringStream << TEST_DATASET_NAME << "-" << TEST_IMAGE_NAME << " detection result";
-			std::string faceWindowName = windowNameStringStream.str();
-			cv::namedWindow(faceWindowName, cv::WINDOW_NORMAL);
-			cv::imshow(faceWindowName, originalFaceRoi);
-			cv::resizeWindow(faceWindowName, faceRect.size() / 2);
-			windowNameStringStream.str("");
-
-			writeResult(faceWindowName, originalFaceRoi);
-		}
+		DebugTap::tap("Face detection result", (int)faceIndex, originalFaceRoi, makeDebugWindowLayout(2));
 	}
+}
 
-	if (IS_LOGGING)
+
+// face, eye and center coordinates are converted to frame coordinates
+FrameResult makeFrameResult(int64 frameIndex, int64 frameTicks, const std::vector<FaceDetectionResult>& faceResults)
+{
+	FrameResult frameResult;
+	frameResult.frameIndex = frameIndex;
+	frameResult.timestampMicroseconds = ticksToMicroseconds(frameTicks);
+
+	for (const FaceDetectionResult& faceResult : faceResults)
 	{
-		std::cout << "Faces/Eyes/Pupils : " << facesCount << "/" << eyesCount << "/" << pupilsCount << std::endl;
+		FaceFrameResult face;
+		face.faceRect = faceResult.faceRect;
+
+		for (const EyeDetectionResult& eyeResult : faceResult.eyes)
+		{
+			EyeFrameResult eye;
+			eye.eyeIndex = eyeResult.eyeIndex;
+			eye.eyeRect = getEyeFrameRect(faceResult, eyeResult);
+			eye.scleraCenter = getEyeFramePoint(faceResult, eyeResult, eyeResult.eyeCenters.scleraCenter);
+			eye.isScleraFound = eyeResult.eyeCenters.isScleraFound;
+			eye.pupilCenter = getEyeFramePoint(faceResult, eyeResult, eyeResult.eyeCenters.pupilCenter);
+			eye.isPupilFound = eyeResult.eyeCenters.isPupilFound;
+			eye.refinedPupilCenter = getEyeFramePoint(faceResult, eyeResult, eyeResult.eyeCenters.refinedPupilCenter);
+			eye.pupilRefinementMicroseconds = ticksToMicroseconds(eyeResult.eyeCenters.pupilRefinementTicks);
+			face.eyes.push_back(eye);
+		}
+
+		frameResult.faces.push_back(face);
 	}
+
+	return frameResult;
+}
+
+
+FrameResult processFaceDetection(DetectionCascade& face_cascade, DetectionCascade& eyes_cascade, cv::Mat& sourceImage, FaceTrackingState& trackingState, const Parameters& parameters, int64 frameIndex)
+{
+	int64 frameTicks = cv::getTickCount();
+
+	std::vector<FaceDetectionResult> faceResults = detectFacesAndEyes(face_cascade, eyes_cascade, sourceImage, trackingState, parameters);
+	processEyes(sourceImage, faceResults, parameters);
+
+	FrameResult frameResult = makeFrameResult(frameIndex, frameTicks, faceResults);
+	writeFrameResult(frameResult);
+
+	drawFaceDetectionResults(sourceImage, faceResults);
+
+	return frameResult;
 }
\ No newline at end of file
@@ -6,6 +6,30 @@
 
 #include "Constants.hpp"
 #include "EyeProcessing.hpp"
+#include "FaceTracking.hpp"
+#include "FrameResult.hpp"
 
 
-void processFaceDetection(cv::CascadeClassifier& face_cascade, cv::CascadeClassifier& eyes_cascade, cv::Mat& sourceImage);
+struct EyeDetectionResult
+{
+	int eyeIndex = 0;
+	cv::Rect eyeRect; // relative to face rect
+	EyeCenters eyeCenters; // relative to eye rect
+};
+
+
+struct FaceDetectionResult
+{
+	cv::Rect faceRect;
+	std::vector<EyeDetectionResult> eyes;
+};
+
+
+cv::Rect getEyeFrameRect(const FaceDetectionResult& faceResult, const EyeDetectionResult& eyeResult);
+cv::Point getEyeFramePoint(const FaceDetectionResult& faceResult, const EyeDetectionResult& eyeResult, cv::Point eyePoint);
+cv::Point2f getEyeFramePoint(const FaceDetectionResult& faceResult, const EyeDetectionResult& eyeResult, cv::Point2f eyePoint);
+std::vector<FaceDetectionResult> detectFacesAndEyes(DetectionCascade& face_cascade, DetectionCascade& eyes_cascade, cv::Mat& sourceImage, FaceTrackingState& trackingState, const Parameters& parameters);
+void processEyes(cv::Mat& sourceImage, std::vector<FaceDetectionResult>& faceResults, const Parameters& parameters);
+void drawFaceDetectionResults(cv::Mat& sourceImage, const std::vector<FaceDetectionResult>& faceResults);
+FrameResult makeFrameResult(int64 frameIndex, int64 frameTicks, const std::vector<FaceDetectionResult>& faceResults);
+FrameResult processFaceDetection(DetectionCascade& face_cascade, DetectionCascade& eyes_cascade, cv::Mat& sourceImage, FaceTrackingState& trackingState, const Parameters& parameters, int64 frameIndex = 0);
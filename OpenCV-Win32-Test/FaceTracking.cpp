@@ -0,0 +1,537 @@
+#include <algorithm>
+
+#include "FaceTracking.hpp"
+#include "CvUtils.hpp"
+#include "FrameArena.hpp"
+
+
+cv::Size getMinFaceSize(const cv::Size& imageSize, const FaceDetectionParameters& parameters)
+{
+	return imageSize * parameters.minRelativeSize / 100;
+}
+
+
+cv::Size getMaxFaceSize(const cv::Size& imageSize, const FaceDetectionParameters& parameters)
+{
+	return imageSize * parameters.maxRelativeSize / 100;
+}
+
+
+double getFaceDetectionWorkingScale(const cv::Size& minFaceSize, const FaceDetectionParameters& parameters)
+{
+	if (minFaceSize.width <= 0)
+	{
+		return 1.0;
+	}
+
+	return std::min(1.0, (double)parameters.minFaceWorkingSize / minFaceSize.width);
+}
+
+
+// face sizes are given in image pixels, found rects are mapped back to the image
+void detectFacesScaled(DetectionCascade& face_cascade, const cv::Mat& image, double scale, const cv::Size& minFaceSize, const cv::Size& maxFaceSize, const FaceDetectionParameters& parameters, std::vector<cv::Rect>& faceRects)
+{
+	faceRects.clear();
+
+	if (scale >= 1.0)
+	{
+		detectCascadeObjects(face_cascade, image, faceRects, parameters.scaleFactor, parameters.minNeighbours, minFaceSize, maxFaceSize);
+		return;
+	}
+
+	cv::Size workingSize = cv::Size(std::max(1, cvRound(image.cols * scale)), std::max(1, cvRound(image.rows * scale)));
+	cv::Size workingMinFaceSize = cv::Size(cvRound(minFaceSize.width * scale), cvRound(minFaceSize.height * scale));
+	cv::Size workingMaxFaceSize = cv::Size(cvRound(maxFaceSize.width * scale), cvRound(maxFaceSize.height * scale));
+
+	FrameArenaScope arenaScope;
+	cv::Mat workingImage = arenaScope.acquire(workingSize, image.type());
+	cv::resize(image, workingImage, workingSize, 0, 0, cv::INTER_AREA);
+
+	std::vector<cv::Rect> workingFaceRects;
+	detectCascadeObjects(face_cascade, workingImage, workingFaceRects, parameters.scaleFactor, parameters.minNeighbours, workingMinFaceSize, workingMaxFaceSize);
+
+	double scaleX = (double)image.cols / workingSize.width;
+	double scaleY = (double)image.rows / workingSize.height;
+	cv::Rect imageRect = cv::Rect(cv::Point(), image.size());
+
+	for (const cv::Rect& workingFaceRect : workingFaceRects)
+	{
+		cv::Point topLeft = cv::Point(cvRound(workingFaceRect.x * scaleX), cvRound(workingFaceRect.y * scaleY));
+		cv::Point bottomRight = cv::Point(cvRound(workingFaceRect.br().x * scaleX), cvRound(workingFaceRect.br().y * scaleY));
+
+		faceRects.push_back(cv::Rect(topLeft, bottomRight) & imageRect);
+	}
+}
+
+
+// previous frame eyes of the tracked face that overlaps the redetected one most, rescaled to the new face rect;
+// genuinely new faces start without previous eyes
+std::vector<std::vector<cv::Rect>> matchPreviousEyeRects(const std::vector<cv::Rect>& faceRects, const FaceTrackingState& trackingState, double minOverlap)
+{
+	std::vector<std::vector<cv::Rect>> matchedEyeRects(faceRects.size());
+
+	for (size_t faceIndex = 0; faceIndex < faceRects.size(); faceIndex++)
+	{
+		const cv::Rect& faceRect = faceRects[faceIndex];
+		double bestOverlap = minOverlap;
+		size_t bestIndex = trackingState.faceRects.size();
+
+		for (size_t previousIndex = 0; previousIndex < trackingState.faceRects.size() && previousIndex < trackingState.selectedEyeRects.size(); previousIndex++)
+		{
+			double overlap = getIntersectionOverUnion(faceRect, trackingState.faceRects[previousIndex]);
+
+			if (overlap >= bestOverlap)
+			{
+				bestOverlap = overlap;
+				bestIndex = previousIndex;
+			}
+		}
+
+		if (bestIndex == trackingState.faceRects.size())
+		{
+			continue;
+		}
+
+		const cv::Rect& previousFaceRect = trackingState.faceRects[bestIndex];
+		double scaleX = faceRect.width / (double)std::max(previousFaceRect.width, 1);
+		double scaleY = faceRect.height / (double)std::max(previousFaceRect.height, 1);
+
+		for (const cv::Rect& eyeRect : trackingState.selectedEyeRects[bestIndex])
+		{
+			matchedEyeRects[faceIndex].push_back(cv::Rect(cvRound(eyeRect.x * scaleX), cvRound(eyeRect.y * scaleY),
+				cvRound(eyeRect.width * scaleX), cvRound(eyeRect.height * scaleY)));
+		}
+	}
+
+	return matchedEyeRects;
+}
+
+
+bool detectFaces(DetectionCascade& face_cascade, cv::Mat& processingImage, FaceTrackingState& trackingState, const FaceDetectionParameters& parameters, std::vector<cv::Rect>& faceRects)
+{
+	cv::Size imageSize = processingImage.size();
+	cv::Size minFaceSize = getMinFaceSize(imageSize, parameters);
+	cv::Size maxFaceSize = getMaxFaceSize(imageSize, parameters);
+	double detectionScale = parameters.isDownscaleEnabled ? getFaceDetectionWorkingScale(minFaceSize, parameters) : 1.0;
+
+	faceRects.clear();
+
+	bool isFullDetectionRequired = !parameters.isTrackingEnabled || !trackingState.isTracking ||
+		trackingState.framesSinceFullDetection >= parameters.trackingRedetectionInterval;
+
+	// tracked search
+
+	if (!isFullDetectionRequired)
+	{
+		for (size_t faceIndex = 0; faceIndex < trackingState.faceRects.size(); faceIndex++)
+		{
+			cv::Rect searchRect = expandRect(trackingState.faceRects[faceIndex], parameters.trackingSearchExpansion, imageSize);
+
+			std::vector<cv::Rect> searchRects;
+			detectFacesScaled(face_cascade, processingImage(searchRect), detectionScale, minFaceSize, maxFaceSize, parameters, searchRects);
+
+			if (searchRects.empty())
+			{
+				isFullDetectionRequired = true; // tracking lost
+				break;
+			}
+
+			faceRects.push_back(getLargestRect(searchRects) + searchRect.tl());
+		}
+	}
+
+	// end tracked search
+
+
+	// full frame detection
+
+	if (isFullDetectionRequired)
+	{
+		faceRects.clear();
+		detectFacesScaled(face_cascade, processingImage, detectionScale, minFaceSize, maxFaceSize, parameters, faceRects);
+
+		trackingState.framesSinceFullDetection = 0;
+		trackingState.eyeRects.assign(faceRects.size(), std::vector<cv::Rect>());
+		trackingState.eyePairPredictions.assign(faceRects.size(), EyePairPrediction());
+		trackingState.selectedEyeRects = matchPreviousEyeRects(faceRects, trackingState, parameters.redetectionMatchOverlap);
+	}
+	else
+	{
+		trackingState.framesSinceFullDetection++;
+	}
+
+	// end full frame detection
+
+	trackingState.faceRects = faceRects;
+	trackingState.isTracking = parameters.isTrackingEnabled && !faceRects.empty();
+
+	return !isFullDetectionRequired;
+}
+
+
+// eye candidates must have the center in the upper face half
+bool isEyeInUpperFace(const cv::Rect& eyeRect, const cv::Size& faceSize)
+{
+	return eyeRect.y + eyeRect.height / 2 <= faceSize.height / 2;
+}
+
+
+// starts at the face top-left, so found rects need no offset
+cv::Rect getEyeSearchRect(const cv::Size& faceSize, const cv::Size& maxEyeSize, const EyeDetectionParameters& parameters)
+{
+	if (!parameters.isUpperFaceSearchEnabled)
+	{
+		return cv::Rect(cv::Point(), faceSize);
+	}
+
+	// an eye centered on the half line still fits
+	int searchHeight = std::min(faceSize.height, faceSize.height / 2 + maxEyeSize.height / 2 + 1);
+
+	return cv::Rect(0, 0, faceSize.width, searchHeight);
+}
+
+
+cv::Point2d getRectCenter(const cv::Rect& rect)
+{
+	return cv::Point2d(rect.x + rect.width / 2.0, rect.y + rect.height / 2.0);
+}
+
+
+// 1 at a previous eye center, 0 from the tracking radius on or without previous eyes
+double getEyeTrackingScore(const cv::Rect& eyeRect, const cv::Size& faceSize, const std::vector<cv::Rect>& previousEyeRects, const EyeDetectionParameters& parameters)
+{
+	double trackingRadius = std::max(faceSize.width * parameters.candidateTrackingRadius / 100.0, 1.0);
+	double score = 0.0;
+
+	for (const cv::Rect& previousEyeRect : previousEyeRects)
+	{
+		double distance = cv::norm(getRectCenter(eyeRect) - getRectCenter(previousEyeRect));
+		score = std::max(score, 1.0 - distance / trackingRadius);
+	}
+
+	return score;
+}
+
+
+// 0 for an implausible pair, otherwise the sum of size ratio, level and symmetry terms of 0..1 each
+double getEyePairScore(const cv::Rect& leftEyeRect, const cv::Rect& rightEyeRect, const cv::Size& faceSize, const EyeDetectionParameters& parameters)
+{
+	if ((leftEyeRect & rightEyeRect).area() > 0)
+	{
+		return 0.0;
+	}
+
+	double sizeRatio = (double)std::min(leftEyeRect.area(), rightEyeRect.area()) / std::max(leftEyeRect.area(), rightEyeRect.area());
+	double verticalOffset = std::abs(getRectCenter(leftEyeRect).y - getRectCenter(rightEyeRect).y) * 100.0 / faceSize.height;
+
+	if (sizeRatio < parameters.pairMinSizeRatio || verticalOffset > parameters.pairMaxVerticalOffset)
+	{
+		return 0.0;
+	}
+
+	double faceCenterX = faceSize.width / 2.0;
+	double symmetryOffset = std::abs((getRectCenter(leftEyeRect).x + getRectCenter(rightEyeRect).x) / 2.0 - faceCenterX) / faceCenterX;
+	double levelScore = parameters.pairMaxVerticalOffset > 0 ? 1.0 - verticalOffset / parameters.pairMaxVerticalOffset : 1.0;
+
+	return sizeRatio + levelScore + std::max(1.0 - symmetryOffset, 0.0);
+}
+
+
+// indices of the eyes worth processing: upper face candidates without duplicates,
+// at most one pair ordered left to right, or the best single eye when no pair is plausible
+std::vector<size_t> selectEyeCandidates(const std::vector<cv::Rect>& eyeRects, const cv::Size& faceSize, const std::vector<cv::Rect>& previousEyeRects, const EyeDetectionParameters& parameters)
+{
+	std::vector<size_t> candidates;
+
+	for (size_t eyeIndex = 0; eyeIndex < eyeRects.size(); eyeIndex++)
+	{
+		if (isEyeInUpperFace(eyeRects[eyeIndex], faceSize))
+		{
+			candidates.push_back(eyeIndex);
+		}
+	}
+
+	if (!parameters.isCandidateFilteringEnabled || candidates.size() <= 1)
+	{
+		// left to right like the pairs below
+		std::stable_sort(candidates.begin(), candidates.end(), [&eyeRects](size_t first, size_t second) {
+			return getRectCenter(eyeRects[first]).x < getRectCenter(eyeRects[second]).x;
+		});
+
+		return candidates;
+	}
+
+	std::vector<double> trackingScores(eyeRects.size(), 0.0);
+
+	for (size_t eyeIndex : candidates)
+	{
+		trackingScores[eyeIndex] = getEyeTrackingScore(eyeRects[eyeIndex], faceSize, previousEyeRects, parameters);
+	}
+
+	// duplicates: candidates near the previous eyes win, then bigger ones
+	std::stable_sort(candidates.begin(), candidates.end(), [&eyeRects, &trackingScores](size_t first, size_t second) {
+		if (trackingScores[first] != trackingScores[second])
+		{
+			return trackingScores[first] > trackingScores[second];
+		}
+
+		return eyeRects[first].area() > eyeRects[second].area();
+	});
+
+	std::vector<size_t> distinctCandidates;
+
+	for (size_t eyeIndex : candidates)
+	{
+		const cv::Rect& eyeRect = eyeRects[eyeIndex];
+		bool isDuplicate = false;
+
+		for (size_t distinctIndex : distinctCandidates)
+		{
+			const cv::Rect& distinctRect = eyeRects[distinctIndex];
+			cv::Point eyeCenter = cv::Point(eyeRect.x + eyeRect.width / 2, eyeRect.y + eyeRect.height / 2);
+			cv::Point distinctCenter = cv::Point(distinctRect.x + distinctRect.width / 2, distinctRect.y + distinctRect.height / 2);
+
+			if (getIntersectionOverUnion(eyeRect, distinctRect) > parameters.candidateMaxOverlap ||
+				distinctRect.contains(eyeCenter) || eyeRect.contains(distinctCenter))
+			{
+				isDuplicate = true;
+				break;
+			}
+		}
+
+		if (!isDuplicate)
+		{
+			distinctCandidates.push_back(eyeIndex);
+		}
+	}
+
+	// pairs
+
+	std::vector<size_t> selectedCandidates = { distinctCandidates.front() };
+	double bestPairScore = 0.0;
+
+	for (size_t i = 0; i < distinctCandidates.size(); i++)
+	{
+		for (size_t j = i + 1; j < distinctCandidates.size(); j++)
+		{
+			size_t leftIndex = distinctCandidates[i];
+			size_t rightIndex = distinctCandidates[j];
+
+			if (getRectCenter(eyeRects[rightIndex]).x < getRectCenter(eyeRects[leftIndex]).x)
+			{
+				std::swap(leftIndex, rightIndex);
+			}
+
+			double pairScore = getEyePairScore(eyeRects[leftIndex], eyeRects[rightIndex], faceSize, parameters);
+
+			if (pairScore <= 0.0)
+			{
+				continue;
+			}
+
+			pairScore += trackingScores[leftIndex] + trackingScores[rightIndex];
+
+			if (pairScore > bestPairScore)
+			{
+				bestPairScore = pairScore;
+				selectedCandidates = { leftIndex, rightIndex };
+			}
+		}
+	}
+
+	// end pairs
+
+	return selectedCandidates;
+}
+
+
+void predictEyePair(const EyePairPrediction& pairPrediction, const cv::Size& faceSize, std::vector<cv::Rect>& eyeRects)
+{
+	cv::Rect faceBounds = cv::Rect(cv::Point(), faceSize);
+
+	for (const cv::Rect2d& relativeEyeRect : pairPrediction.relativeEyeRects)
+	{
+		cv::Rect eyeRect = cv::Rect(
+			cvRound(relativeEyeRect.x * faceSize.width), cvRound(relativeEyeRect.y * faceSize.height),
+			cvRound(relativeEyeRect.width * faceSize.width), cvRound(relativeEyeRect.height * faceSize.height)) & faceBounds;
+
+		if (eyeRect.area() > 0)
+		{
+			eyeRects.push_back(eyeRect);
+		}
+	}
+}
+
+
+// only a pair in the upper face is predicted, anything else waits for the cascade
+void updateEyePairPrediction(EyePairPrediction& pairPrediction, const std::vector<cv::Rect>& eyeRects, const cv::Size& faceSize)
+{
+	std::vector<cv::Rect> pairRects;
+
+	for (const cv::Rect& eyeRect : eyeRects)
+	{
+		if (isEyeInUpperFace(eyeRect, faceSize))
+		{
+			pairRects.push_back(eyeRect);
+		}
+	}
+
+	pairPrediction.isValid = pairRects.size() == 2;
+	pairPrediction.framesSinceConfirmation = 0;
+
+	if (!pairPrediction.isValid)
+	{
+		return;
+	}
+
+	for (size_t eyeIndex = 0; eyeIndex < 2; eyeIndex++)
+	{
+		const cv::Rect& pairRect = pairRects[eyeIndex];
+
+		pairPrediction.relativeEyeRects[eyeIndex] = cv::Rect2d(
+			(double)pairRect.x / faceSize.width, (double)pairRect.y / faceSize.height,
+			(double)pairRect.width / faceSize.width, (double)pairRect.height / faceSize.height);
+	}
+}
+
+
+void detectEyes(DetectionCascade& eyes_cascade, cv::Mat& faceRoi, FaceTrackingState& trackingState, size_t faceIndex, bool isTrackedFrame, const EyeDetectionParameters& parameters, std::vector<cv::Rect>& eyeRects)
+{
+	cv::Size faceSize = faceRoi.size();
+	cv::Size minEyeSize = faceSize * parameters.minRelativeSize / 100;
+	cv::Size maxEyeSize = faceSize * parameters.maxRelativeSize / 100;
+
+	std::vector<cv::Rect>& trackedEyeRects = trackingState.eyeRects[faceIndex];
+	EyePairPrediction& pairPrediction = trackingState.eyePairPredictions[faceIndex];
+
+	eyeRects.clear();
+
+	// predicted pair
+
+	if (parameters.isPairPredictionEnabled && isTrackedFrame && pairPrediction.isValid &&
+		pairPrediction.framesSinceConfirmation < parameters.pairConfirmationInterval)
+	{
+		predictEyePair(pairPrediction, faceSize, eyeRects);
+		pairPrediction.framesSinceConfirmation++;
+		trackingState.statistics.predictedEyeSearchesCount++;
+
+		trackedEyeRects = eyeRects;
+		return;
+	}
+
+	// end predicted pair
+
+	trackingState.statistics.cascadeEyeSearchesCount++;
+
+	bool isFullDetectionRequired = !isTrackedFrame || trackedEyeRects.empty();
+
+	// tracked search
+
+	if (!isFullDetectionRequired)
+	{
+		for (size_t eyeIndex = 0; eyeIndex < trackedEyeRects.size(); eyeIndex++)
+		{
+			cv::Rect searchRect = expandRect(trackedEyeRects[eyeIndex], parameters.trackingSearchExpansion, faceSize);
+
+			std::vector<cv::Rect> searchRects;
+			detectCascadeObjects(eyes_cascade, faceRoi(searchRect), searchRects, parameters.scaleFactor, parameters.minNeighbours, minEyeSize, maxEyeSize);
+
+			if (searchRects.empty())
+			{
+				isFullDetectionRequired = true; // tracking lost
+				break;
+			}
+
+			eyeRects.push_back(getLargestRect(searchRects) + searchRect.tl());
+		}
+	}
+
+	// end tracked search
+
+
+	// full face detection
+
+	if (isFullDetectionRequired)
+	{
+		eyeRects.clear();
+		cv::Rect searchRect = getEyeSearchRect(faceSize, maxEyeSize, parameters);
+		detectCascadeObjects(eyes_cascade, faceRoi(searchRect), eyeRects, parameters.scaleFactor, parameters.minNeighbours, minEyeSize, maxEyeSize);
+	}
+
+	// end full face detection
+
+	trackedEyeRects = eyeRects;
+	updateEyePairPrediction(pairPrediction, eyeRects, faceSize);
+}
+
+
+void equalizeFrame(cv::Mat& processingImage, FaceTrackingState& trackingState, const Parameters& parameters)
+{
+	int64 equalizationTicks = cv::getTickCount();
+
+	if (isVideoMode(parameters) && parameters.face.isTemporalEqualizationEnabled)
+	{
+		trackingState.frameEqualizer.equalize(processingImage, processingImage, parameters.face);
+	}
+	else
+	{
+		cv::equalizeHist(processingImage, processingImage);
+	}
+
+	trackingState.statistics.equalizedFramesCount++;
+	trackingState.statistics.equalizationTicksSum += cv::getTickCount() - equalizationTicks;
+}
+
+
+void registerDetectionLatency(FaceTrackingState& trackingState, bool isTrackedFrame, int64 ticks)
+{
+	FaceTrackingStatistics& statistics = trackingState.statistics;
+
+	if (isTrackedFrame)
+	{
+		statistics.trackedFramesCount++;
+		statistics.trackedTicksSum += ticks;
+	}
+	else
+	{
+		statistics.fullDetectionFramesCount++;
+		statistics.fullDetectionTicksSum += ticks;
+	}
+
+	if (IS_LOGGING)
+	{
+		std::cout << "Detection latency (" << (isTrackedFrame ? "tracked" : "full") << "), ms : " << ticksToMilliseconds(ticks) << std::endl;
+	}
+}
+
+
+void printFaceTrackingStatistics(const FaceTrackingState& trackingState)
+{
+	const FaceTrackingStatistics& statistics = trackingState.statistics;
+
+	double trackedAverage = statistics.trackedFramesCount > 0 ?
+		ticksToMilliseconds(statistics.trackedTicksSum) / statistics.trackedFramesCount : 0.0;
+	double fullDetectionAverage = statistics.fullDetectionFramesCount > 0 ?
+		ticksToMilliseconds(statistics.fullDetectionTicksSum) / statistics.fullDetectionFramesCount : 0.0;
+
+	std::cout << "Tracked/Full detection frames : " <<
+		statistics.trackedFramesCount << "/" << statistics.fullDetectionFramesCount << std::endl;
+	std::cout << "Tracked/Full detection average latency, ms : " <<
+		trackedAverage << "/" << fullDetectionAverage << std::endl;
+
+	double equalizationAverage = statistics.equalizedFramesCount > 0 ?
+		ticksToMilliseconds(statistics.equalizationTicksSum) / statistics.equalizedFramesCount : 0.0;
+	const TemporalEqualizer& frameEqualizer = trackingState.frameEqualizer;
+
+	std::cout << "Equalization average latency, ms : " << equalizationAverage << std::endl;
+	std::cout << "Cascade/Predicted eye searches : " <<
+		statistics.cascadeEyeSearchesCount << "/" << statistics.predictedEyeSearchesCount << std::endl;
+	std::cout << "Eye candidates/Skipped eye analyses : " <<
+		statistics.eyeCandidatesCount << "/" << statistics.skippedEyeCandidatesCount << std::endl;
+
+	if (frameEqualizer.getFramesCount() > 0)
+	{
+		std::cout << "Temporal equalization frames/full rebuilds : " <<
+			frameEqualizer.getFramesCount() << "/" << frameEqualizer.getRebuildsCount() << std::endl;
+	}
+}
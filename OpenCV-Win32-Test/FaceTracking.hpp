@@ -0,0 +1,63 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include <opencv2/objdetect.hpp>
+
+#include "Cascades.hpp"
+#include "Constants.hpp"
+#include "Parameters.hpp"
+#include "TemporalEqualizer.hpp"
+
+
+struct FaceTrackingStatistics
+{
+	int64 trackedFramesCount = 0;
+	int64 trackedTicksSum = 0;
+	int64 fullDetectionFramesCount = 0;
+	int64 fullDetectionTicksSum = 0;
+	int64 cascadeEyeSearchesCount = 0;
+	int64 predictedEyeSearchesCount = 0;
+	int64 eyeCandidatesCount = 0;
+	int64 skippedEyeCandidatesCount = 0; // candidates that didn't get eye processing
+	int64 equalizedFramesCount = 0;
+	int64 equalizationTicksSum = 0;
+};
+
+
+// eye pair relative to the face rect, so it follows the tracked face without the eye cascade
+struct EyePairPrediction
+{
+	bool isValid = false;
+	cv::Rect2d relativeEyeRects[2];
+	int framesSinceConfirmation = 0;
+};
+
+
+struct FaceTrackingState
+{
+	bool isTracking = false;
+	int framesSinceFullDetection = 0;
+	std::vector<cv::Rect> faceRects;
+	std::vector<std::vector<cv::Rect>> eyeRects; // relative to face rect
+	std::vector<EyePairPrediction> eyePairPredictions;
+	std::vector<std::vector<cv::Rect>> selectedEyeRects; // relative to face rect, eyes processed on the previous frame
+	TemporalEqualizer frameEqualizer; // video mode only, single image modes use cv::equalizeHist
+	FaceTrackingStatistics statistics;
+};
+
+
+cv::Size getMinFaceSize(const cv::Size& imageSize, const FaceDetectionParameters& parameters);
+cv::Size getMaxFaceSize(const cv::Size& imageSize, const FaceDetectionParameters& parameters);
+double getFaceDetectionWorkingScale(const cv::Size& minFaceSize, const FaceDetectionParameters& parameters);
+void detectFacesScaled(DetectionCascade& face_cascade, const cv::Mat& image, double scale, const cv::Size& minFaceSize, const cv::Size& maxFaceSize, const FaceDetectionParameters& parameters, std::vector<cv::Rect>& faceRects);
+std::vector<std::vector<cv::Rect>> matchPreviousEyeRects(const std::vector<cv::Rect>& faceRects, const FaceTrackingState& trackingState, double minOverlap);
+bool detectFaces(DetectionCascade& face_cascade, cv::Mat& processingImage, FaceTrackingState& trackingState, const FaceDetectionParameters& parameters, std::vector<cv::Rect>& faceRects);
+bool isEyeInUpperFace(const cv::Rect& eyeRect, const cv::Size& faceSize);
+cv::Rect getEyeSearchRect(const cv::Size& faceSize, const cv::Size& maxEyeSize, const EyeDetectionParameters& parameters);
+void detectEyes(DetectionCascade& eyes_cascade, cv::Mat& faceRoi, FaceTrackingState& trackingState, size_t faceIndex, bool isTrackedFrame, const EyeDetectionParameters& parameters, std::vector<cv::Rect>& eyeRects);
+std::vector<size_t> selectEyeCandidates(const std::vector<cv::Rect>& eyeRects, const cv::Size& faceSize, const std::vector<cv::Rect>& previousEyeRects, const EyeDetectionParameters& parameters);
+void equalizeFrame(cv::Mat& processingImage, FaceTrackingState& trackingState, const Parameters& parameters);
+void registerDetectionLatency(FaceTrackingState& trackingState, bool isTrackedFrame, int64 ticks);
+void printFaceTrackingStatistics(const FaceTrackingState& trackingState);
@@ -0,0 +1,120 @@
+#include "FrameArena.hpp"
+
+
+const int FRAME_ARENA_ALIGNMENT = 64;
+
+
+FrameArena::FrameArena(size_t initialBlockSize)
+{
+	allocateBlock(initialBlockSize);
+}
+
+
+cv::Mat FrameArena::acquire(int rows, int cols, int type)
+{
+	size_t step = cols * CV_ELEM_SIZE(type);
+	size_t size = cv::alignSize(rows * step, FRAME_ARENA_ALIGNMENT);
+
+	while (blockIndex < blocks.size() && offset + size > blocks[blockIndex].total())
+	{
+		blockIndex++;
+		offset = 0;
+	}
+
+	if (blockIndex == blocks.size())
+	{
+		allocateBlock(std::max(size, blocks.empty() ? size : blocks.back().total()));
+	}
+
+	cv::Mat mat = cv::Mat(rows, cols, type, blocks[blockIndex].ptr<uchar>() + offset, step);
+	offset += size;
+
+	return mat;
+}
+
+
+FrameArena::Mark FrameArena::getMark() const
+{
+	Mark mark;
+	mark.blockIndex = blockIndex;
+	mark.offset = offset;
+
+	return mark;
+}
+
+
+void FrameArena::rewind(const Mark& mark)
+{
+	blockIndex = mark.blockIndex;
+	offset = mark.offset;
+
+	// fully released arena that needed several blocks, one block covers the whole frame next time
+	if (blockIndex == 0 && offset == 0 && blocks.size() > 1)
+	{
+		size_t capacity = getCapacity();
+
+		blocks.clear();
+		allocateBlock(capacity);
+	}
+}
+
+
+size_t FrameArena::getCapacity() const
+{
+	size_t capacity = 0;
+
+	for (const cv::Mat& block : blocks)
+	{
+		capacity += block.total();
+	}
+
+	return capacity;
+}
+
+
+void FrameArena::allocateBlock(size_t size)
+{
+	size = cv::alignSize(std::max<size_t>(size, FRAME_ARENA_ALIGNMENT), FRAME_ARENA_ALIGNMENT);
+
+	// Mat buffers are already aligned to 64 bytes
+	blocks.push_back(cv::Mat(1, (int)size, CV_8UC1));
+	blockIndex = blocks.size() - 1;
+	offset = 0;
+}
+
+
+FrameArena& getFrameArena()
+{
+	thread_local FrameArena frameArena(FRAME_ARENA_INITIAL_BLOCK_SIZE);
+	return frameArena;
+}
+
+
+FrameArenaScope::FrameArenaScope() :
+	arena(getFrameArena()),
+	mark(arena.getMark())
+{
+}
+
+
+FrameArenaScope::~FrameArenaScope()
+{
+	arena.rewind(mark);
+}
+
+
+cv::Mat FrameArenaScope::acquire(int rows, int cols, int type)
+{
+	if (!IS_FRAME_ARENA_ENABLED)
+	{
+		return cv::Mat(rows, cols, type);
+	}
+
+	return arena.acquire(rows, cols, type);
+}
+
+
+cv::Mat FrameArenaScope::acquire(cv::Size size, int type)
+{
+	return acquire(size.height, size.width, type);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "Constants.hpp"
+
+
+// Bump allocator for the working Mats of a frame. Blocks are kept when the arena is rewound,
+// so once it has grown to the peak usage of a frame acquiring buffers doesn't allocate.
+// Blocks are Mats themselves and show up in the benchmark allocation counter when the arena grows.
+class FrameArena
+{
+public:
+	struct Mark
+	{
+		size_t blockIndex = 0;
+		size_t offset = 0;
+	};
+
+	explicit FrameArena(size_t initialBlockSize);
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// continuous Mat header over arena memory, valid until the arena is rewound below it
+	cv::Mat acquire(int rows, int cols, int type);
+	Mark getMark() const;
+	void rewind(const Mark& mark);
+
+	size_t getCapacity() const;
+
+private:
+	void allocateBlock(size_t size);
+
+	std::vector<cv::Mat> blocks;
+	size_t blockIndex = 0;
+	size_t offset = 0;
+};
+
+
+// every thread has its own arena, so pipeline stages and pool workers don't share buffers
+FrameArena& getFrameArena();
+
+
+// Rewinds the thread arena on scope exit, Mats acquired inside must not outlive the scope.
+// Scopes nest, a task run while waiting for a future takes buffers above the waiting one.
+class FrameArenaScope
+{
+public:
+	FrameArenaScope();
+	~FrameArenaScope();
+
+	FrameArenaScope(const FrameArenaScope&) = delete;
+	FrameArenaScope& operator=(const FrameArenaScope&) = delete;
+
+	// plain Mat allocation when the arena is disabled
+	cv::Mat acquire(int rows, int cols, int type);
+	cv::Mat acquire(cv::Size size, int type);
+
+private:
+	FrameArena& arena;
+	FrameArena::Mark mark;
+};
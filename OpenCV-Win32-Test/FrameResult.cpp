@@ -0,0 +1,189 @@
+#include <cstdio>
+#include <cstring>
+
+#include "FrameResult.hpp"
+
+
+FrameResultStream::FrameResultStream(const std::string& filePath, FrameResultFormat format) :
+	fout(filePath, std::ios::out | std::ios::binary),
+	format(format)
+{
+	if (!fout.is_open())
+	{
+		throw std::runtime_error("Can't write file: " + filePath);
+	}
+}
+
+
+void FrameResultStream::write(const FrameResult& frameResult)
+{
+	recordBuffer.clear();
+
+	if (format == FrameResultFormat::BINARY)
+	{
+		encodeBinaryRecord(frameResult);
+	}
+	else
+	{
+		encodeJsonLine(frameResult);
+	}
+
+	fout.write(recordBuffer.data(), recordBuffer.size());
+	fout.flush();
+
+	writtenCount++;
+}
+
+
+int64 FrameResultStream::getWrittenCount() const
+{
+	return writtenCount;
+}
+
+
+// numbers are formatted on the stack, the record buffer keeps its capacity between frames
+void appendJsonInteger(std::string& buffer, int64 value)
+{
+	char text[32];
+	std::snprintf(text, sizeof(text), "%lld", (long long)value);
+	buffer += text;
+}
+
+
+void appendJsonRect(std::string& buffer, const cv::Rect& rect)
+{
+	char text[64];
+	std::snprintf(text, sizeof(text), "[%d,%d,%d,%d]", rect.x, rect.y, rect.width, rect.height);
+	buffer += text;
+}
+
+
+void appendJsonPoint(std::string& buffer, const cv::Point& point)
+{
+	char text[32];
+	std::snprintf(text, sizeof(text), "[%d,%d]", point.x, point.y);
+	buffer += text;
+}
+
+
+void appendJsonPoint2f(std::string& buffer, const cv::Point2f& point)
+{
+	char text[64];
+	std::snprintf(text, sizeof(text), "[%.2f,%.2f]", point.x, point.y);
+	buffer += text;
+}
+
+
+void FrameResultStream::encodeJsonLine(const FrameResult& frameResult)
+{
+	recordBuffer += "{\"frame\":";
+	appendJsonInteger(recordBuffer, frameResult.frameIndex);
+	recordBuffer += ",\"timestamp_us\":";
+	appendJsonInteger(recordBuffer, frameResult.timestampMicroseconds);
+	recordBuffer += ",\"faces\":[";
+
+	for (size_t faceIndex = 0; faceIndex < frameResult.faces.size(); faceIndex++)
+	{
+		const FaceFrameResult& face = frameResult.faces[faceIndex];
+
+		recordBuffer += faceIndex > 0 ? ",{\"rect\":" : "{\"rect\":";
+		appendJsonRect(recordBuffer, face.faceRect);
+		recordBuffer += ",\"eyes\":[";
+
+		for (size_t eyeIndex = 0; eyeIndex < face.eyes.size(); eyeIndex++)
+		{
+			const EyeFrameResult& eye = face.eyes[eyeIndex];
+
+			recordBuffer += eyeIndex > 0 ? ",{\"index\":" : "{\"index\":";
+			appendJsonInteger(recordBuffer, eye.eyeIndex);
+			recordBuffer += ",\"rect\":";
+			appendJsonRect(recordBuffer, eye.eyeRect);
+			recordBuffer += ",\"sclera\":";
+			appendJsonPoint(recordBuffer, eye.scleraCenter);
+			recordBuffer += eye.isScleraFound ? ",\"sclera_found\":true,\"pupil\":" : ",\"sclera_found\":false,\"pupil\":";
+			appendJsonPoint(recordBuffer, eye.pupilCenter);
+			recordBuffer += eye.isPupilFound ? ",\"pupil_found\":true,\"pupil_refined\":" : ",\"pupil_found\":false,\"pupil_refined\":";
+			appendJsonPoint2f(recordBuffer, eye.refinedPupilCenter);
+			recordBuffer += ",\"refinement_us\":";
+			appendJsonInteger(recordBuffer, eye.pupilRefinementMicroseconds);
+			recordBuffer += "}";
+		}
+
+		recordBuffer += "]}";
+	}
+
+	recordBuffer += "]}\n";
+}
+
+
+template <typename T>
+void appendBinaryValue(std::string& buffer, T value)
+{
+	buffer.append((const char*)&value, sizeof(value));
+}
+
+
+void appendBinaryRect(std::string& buffer, const cv::Rect& rect)
+{
+	appendBinaryValue<int32_t>(buffer, rect.x);
+	appendBinaryValue<int32_t>(buffer, rect.y);
+	appendBinaryValue<int32_t>(buffer, rect.width);
+	appendBinaryValue<int32_t>(buffer, rect.height);
+}
+
+
+void FrameResultStream::encodeBinaryRecord(const FrameResult& frameResult)
+{
+	appendBinaryValue<int32_t>(recordBuffer, 0); // record size, patched below
+	appendBinaryValue<int64_t>(recordBuffer, frameResult.frameIndex);
+	appendBinaryValue<int64_t>(recordBuffer, frameResult.timestampMicroseconds);
+	appendBinaryValue<int32_t>(recordBuffer, (int32_t)frameResult.faces.size());
+
+	for (const FaceFrameResult& face : frameResult.faces)
+	{
+		appendBinaryRect(recordBuffer, face.faceRect);
+		appendBinaryValue<int32_t>(recordBuffer, (int32_t)face.eyes.size());
+
+		for (const EyeFrameResult& eye : face.eyes)
+		{
+			appendBinaryValue<int32_t>(recordBuffer, eye.eyeIndex);
+			appendBinaryRect(recordBuffer, eye.eyeRect);
+			appendBinaryValue<int32_t>(recordBuffer, eye.scleraCenter.x);
+			appendBinaryValue<int32_t>(recordBuffer, eye.scleraCenter.y);
+			appendBinaryValue<int32_t>(recordBuffer, eye.isScleraFound ? 1 : 0);
+			appendBinaryValue<int32_t>(recordBuffer, eye.pupilCenter.x);
+			appendBinaryValue<int32_t>(recordBuffer, eye.pupilCenter.y);
+			appendBinaryValue<int32_t>(recordBuffer, eye.isPupilFound ? 1 : 0);
+			appendBinaryValue<float>(recordBuffer, eye.refinedPupilCenter.x);
+			appendBinaryValue<float>(recordBuffer, eye.refinedPupilCenter.y);
+			appendBinaryValue<int32_t>(recordBuffer, (int32_t)eye.pupilRefinementMicroseconds);
+		}
+	}
+
+	int32_t recordSize = (int32_t)recordBuffer.size();
+	std::memcpy(&recordBuffer[0], &recordSize, sizeof(recordSize));
+}
+
+
+int64 ticksToMicroseconds(int64 ticks)
+{
+	return (int64)(ticks * 1000000.0 / cv::getTickFrequency());
+}
+
+
+FrameResultStream& getFrameResultStream()
+{
+	static FrameResultStream frameResultStream(FRAME_RESULT_STREAM_PATH, FRAME_RESULT_STREAM_FORMAT);
+	return frameResultStream;
+}
+
+
+void writeFrameResult(const FrameResult& frameResult)
+{
+	if (!IS_FRAME_RESULT_STREAM_ENABLED)
+	{
+		return;
+	}
+
+	getFrameResultStream().write(frameResult);
+}
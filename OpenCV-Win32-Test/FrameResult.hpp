@@ -0,0 +1,74 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "Constants.hpp"
+
+
+// All coordinates are in frame pixels.
+struct EyeFrameResult
+{
+	int eyeIndex = 0; // position in the selected eyes, left to right
+	cv::Rect eyeRect;
+	cv::Point scleraCenter;
+	bool isScleraFound = false; // the center is the eye ROI center otherwise
+	cv::Point pupilCenter;
+	bool isPupilFound = false;
+	cv::Point2f refinedPupilCenter;
+	int64 pupilRefinementMicroseconds = 0;
+};
+
+
+struct FaceFrameResult
+{
+	cv::Rect faceRect;
+	std::vector<EyeFrameResult> eyes;
+};
+
+
+struct FrameResult
+{
+	int64 frameIndex = 0;
+	int64 timestampMicroseconds = 0; // monotonic, taken when the frame entered processing
+	std::vector<FaceFrameResult> faces;
+};
+
+
+// Streams frame results to a file or a named pipe, one record per frame, flushed after every frame.
+// JSON lines: {"frame":0,"timestamp_us":0,"faces":[{"rect":[x,y,w,h],"eyes":[{"index":0,"rect":[x,y,w,h],"sclera":[x,y],"sclera_found":true,
+// "pupil":[x,y],"pupil_found":true,"pupil_refined":[x.xx,y.yy],"refinement_us":0}]}]}
+// Binary, native byte order: int32 record size in bytes (including the size field), int64 frame, int64 timestamp_us,
+// int32 faces count, then per face int32 x, y, w, h, int32 eyes count,
+// then per eye int32 index, x, y, w, h, sclera x, y, sclera found, pupil x, y, pupil found, float32 refined pupil x, y, int32 refinement_us.
+// Found is false (0) when the detector mask was empty and the center is the eye ROI center.
+class FrameResultStream
+{
+public:
+	FrameResultStream(const std::string& filePath, FrameResultFormat format);
+
+	FrameResultStream(const FrameResultStream&) = delete;
+	FrameResultStream& operator=(const FrameResultStream&) = delete;
+
+	void write(const FrameResult& frameResult);
+
+	int64 getWrittenCount() const;
+
+private:
+	void encodeJsonLine(const FrameResult& frameResult);
+	void encodeBinaryRecord(const FrameResult& frameResult);
+
+	std::ofstream fout;
+	FrameResultFormat format;
+	std::string recordBuffer; // reused between frames
+	int64 writtenCount = 0;
+};
+
+
+int64 ticksToMicroseconds(int64 ticks);
+FrameResultStream& getFrameResultStream();
+// writes to the configured stream if frame result output is enabled
+void writeFrameResult(const FrameResult& frameResult);
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/imgproc.hpp>
+
+#include "FusedEyeProcessing.hpp"
+#include "CenterOfMass.hpp"
+#include "CvUtils.hpp"
+#include "EyeChannels.hpp"
+#include "FrameArena.hpp"
+#include "MaskMorphology.hpp"
+
+
+// mask = equalized > threshold ? 0 : maxValue, same as cv::THRESH_BINARY_INV
+void buildThresholdInvLut(const uint8_t* equalizeLut, int threshold, int maxValue, uint8_t* maskLut)
+{
+	uint8_t maskValue = cv::saturate_cast<uint8_t>(maxValue);
+
+	for (int i = 0; i < 256; i++)
+	{
+		uint8_t level = equalizeLut != nullptr ? equalizeLut[i] : (uint8_t)i;
+		maskLut[i] = level > threshold ? 0 : maskValue;
+	}
+}
+
+
+DetectedCenter getMaskCenter(cv::Mat& mask, const CenterDetectorParameters& parameters, bool isMaskMorphologyActive)
+{
+	int erosionIterationsCount = parameters.isErosionEnabled ? parameters.erosionIterationsCount : 0;
+	int dilationIterationsCount = parameters.isDilationEnabled ? parameters.dilationIterationsCount : 0;
+
+	if (isMaskMorphologyActive)
+	{
+		applyMaskMorphology(mask, mask, cv::saturate_cast<uint8_t>(parameters.maxThreshold), erosionIterationsCount, dilationIterationsCount);
+	}
+	else
+	{
+		const cv::Mat kernel = cv::Mat();
+		const cv::Point anchor = cv::Point(-1, -1);
+
+		if (erosionIterationsCount > 0)
+		{
+			cv::erode(mask, mask, kernel, anchor, erosionIterationsCount);
+		}
+
+		if (dilationIterationsCount > 0)
+		{
+			cv::dilate(mask, mask, kernel, anchor, dilationIterationsCount);
+		}
+	}
+
+	return getDetectedCenter(getCenterOfMass8UC1(mask), mask.size());
+}
+
+
+DetectedCenter getMomentsCenter(const CenterOfMassMoments& moments, int rows, int cols)
+{
+	return getDetectedCenter(makeCenterOfMass(moments), cv::Size(cols, rows));
+}
+
+
+EyeCenters detectEyeCentersFused(const cv::Mat& eyeImage, const Parameters& parameters)
+{
+	const CenterDetectorParameters& scleraParameters = parameters.saturationSclera;
+	const CenterDetectorParameters& pupilParameters = parameters.pupil;
+
+	const bool isScleraMorphologyEnabled = scleraParameters.isErosionEnabled || scleraParameters.isDilationEnabled;
+	const bool isPupilMorphologyEnabled = pupilParameters.isErosionEnabled || pupilParameters.isDilationEnabled;
+
+	const int* saturationDivisionTable = getSaturationDivisionTable();
+
+	int rows = eyeImage.rows;
+	int cols = eyeImage.cols;
+
+	uint8_t saturation = 0;
+	uint8_t value = 0;
+
+
+	// histograms
+
+	int saturationHistogram[256] = { 0 };
+	int valueHistogram[256] = { 0 };
+
+	if (scleraParameters.isHistogramEqualizationEnabled || pupilParameters.isHistogramEqualizationEnabled)
+	{
+		for (int i = 0; i < rows; i++)
+		{
+			const uint8_t* pixel = eyeImage.ptr<uint8_t>(i);
+
+			for (int j = 0; j < cols; j++, pixel += 3)
+			{
+				computeSaturationValue(pixel, saturationDivisionTable, saturation, value);
+				saturationHistogram[saturation]++;
+				valueHistogram[value]++;
+			}
+		}
+	}
+
+	// end histograms
+
+
+	// lookup tables
+
+	uint8_t saturationEqualizeLut[256];
+	uint8_t valueEqualizeLut[256];
+
+	buildEqualizeHistLut(saturationHistogram, rows * cols, saturationEqualizeLut);
+	buildEqualizeHistLut(valueHistogram, rows * cols, valueEqualizeLut);
+
+	uint8_t scleraMaskLut[256];
+	uint8_t pupilMaskLut[256];
+
+	buildThresholdInvLut(scleraParameters.isHistogramEqualizationEnabled ? saturationEqualizeLut : nullptr,
+		scleraParameters.threshold, scleraParameters.maxThreshold, scleraMaskLut);
+	buildThresholdInvLut(pupilParameters.isHistogramEqualizationEnabled ? valueEqualizeLut : nullptr,
+		pupilParameters.threshold, pupilParameters.maxThreshold, pupilMaskLut);
+
+	// end lookup tables
+
+
+	// masks and moments
+
+	FrameArenaScope arenaScope;
+	cv::Mat scleraMask;
+	cv::Mat pupilMask;
+
+	if (isScleraMorphologyEnabled)
+	{
+		scleraMask = arenaScope.acquire(rows, cols, CV_8UC1);
+	}
+
+	if (isPupilMorphologyEnabled)
+	{
+		pupilMask = arenaScope.acquire(rows, cols, CV_8UC1);
+	}
+
+	CenterOfMassMoments scleraMoments;
+	CenterOfMassMoments pupilMoments;
+
+	for (int i = 0; i < rows; i++)
+	{
+		const uint8_t* pixel = eyeImage.ptr<uint8_t>(i);
+		uint8_t* scleraMaskRow = isScleraMorphologyEnabled ? scleraMask.ptr<uint8_t>(i) : nullptr;
+		uint8_t* pupilMaskRow = isPupilMorphologyEnabled ? pupilMask.ptr<uint8_t>(i) : nullptr;
+
+		uint64_t scleraRowSum = 0;
+		uint64_t pupilRowSum = 0;
+
+		for (int j = 0; j < cols; j++, pixel += 3)
+		{
+			computeSaturationValue(pixel, saturationDivisionTable, saturation, value);
+
+			uint8_t scleraWeight = scleraMaskLut[saturation];
+			uint8_t pupilWeight = pupilMaskLut[value];
+
+			if (isScleraMorphologyEnabled)
+			{
+				scleraMaskRow[j] = scleraWeight;
+			}
+			else
+			{
+				scleraMoments.xSum += (uint64_t)j * scleraWeight;
+				scleraRowSum += scleraWeight;
+			}
+
+			if (isPupilMorphologyEnabled)
+			{
+				pupilMaskRow[j] = pupilWeight;
+			}
+			else
+			{
+				pupilMoments.xSum += (uint64_t)j * pupilWeight;
+				pupilRowSum += pupilWeight;
+			}
+		}
+
+		scleraMoments.ySum += i * scleraRowSum;
+		scleraMoments.weightSum += scleraRowSum;
+		pupilMoments.ySum += i * pupilRowSum;
+		pupilMoments.weightSum += pupilRowSum;
+	}
+
+	// end masks and moments
+
+
+	// centers
+
+	DetectedCenter scleraCenter = isScleraMorphologyEnabled ?
+		getMaskCenter(scleraMask, scleraParameters, parameters.modes.isMaskMorphologyActive) :
+		getMomentsCenter(scleraMoments, rows, cols);
+
+	DetectedCenter pupilCenter = isPupilMorphologyEnabled ?
+		getMaskCenter(pupilMask, pupilParameters, parameters.modes.isMaskMorphologyActive) :
+		getMomentsCenter(pupilMoments, rows, cols);
+
+	EyeCenters eyeCenters;
+	eyeCenters.scleraCenter = scleraCenter.center;
+	eyeCenters.isScleraFound = scleraCenter.isFound;
+	eyeCenters.pupilCenter = pupilCenter.center;
+	eyeCenters.isPupilFound = pupilCenter.isFound;
+
+	// end centers
+
+	return eyeCenters;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include "Constants.hpp"
+#include "EyeProcessing.hpp"
+#include "Parameters.hpp"
+
+
+// Saturation sclera and value pupil detection straight from the BGR eye image.
+// S and V are computed per pixel, histogram equalization and threshold are folded into lookup tables
+// and both centers of mass are accumulated without intermediate planes.
+// Only a detector with enabled erosion or dilation materializes its mask.
+EyeCenters detectEyeCentersFused(const cv::Mat& eyeImage, const Parameters& parameters);
@@ -0,0 +1,830 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <stdexcept>
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/objdetect.hpp>
+
+#include "HaarCascade.hpp"
+#include "FrameArena.hpp"
+#include "ThreadPool.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAAR_CASCADE_SSE2
+#endif
+
+
+// Windows are evaluated 4 at a time. The first stage runs on consecutive windows of a row, which are
+// contiguous in the integral planes, the later stages on the windows that survived it.
+// Feature sums are converted and weighted in float in the same order as cv::CascadeClassifier,
+// so every node decision and detection is bit-identical.
+
+
+// cv::CascadeClassifier lowers every stage threshold by this
+const float HAAR_STAGE_THRESHOLD_EPSILON = 1e-5f;
+// columns after the integral row, loads of the last lanes of a row may reach into them
+const int HAAR_INTEGRAL_PADDING = 8;
+const int HAAR_INTEGRAL_STEP_ALIGNMENT = 32;
+const size_t HAAR_STEP_NODES_CACHE_SIZE = 8;
+
+
+std::atomic<int> lastCascadeId(0);
+
+
+void readHaarNodeValues(const cv::FileNode& valuesNode, std::vector<double>& values)
+{
+	values.clear();
+
+	for (cv::FileNodeIterator it = valuesNode.begin(); it != valuesNode.end(); it++)
+	{
+		values.push_back((double)*it);
+	}
+}
+
+
+HaarCascade readHaarCascade(const cv::FileNode& cascadeNode)
+{
+	cv::FileNode stagesNode = cascadeNode["stages"];
+	cv::FileNode featuresNode = cascadeNode["features"];
+
+	if ((std::string)cascadeNode["stageType"] != "BOOST" || (std::string)cascadeNode["featureType"] != "HAAR" || stagesNode.empty() || featuresNode.empty())
+	{
+		throw std::runtime_error("Haar cascade evaluator expects a HAAR cascade in the current format");
+	}
+
+	HaarCascade cascade;
+	cascade.id = ++lastCascadeId;
+	cascade.windowSize = cv::Size((int)cascadeNode["width"], (int)cascadeNode["height"]);
+
+	// features are shared by nodes in the file, every node gets its own copy
+	std::vector<HaarNode> features;
+	std::vector<double> values;
+
+	for (cv::FileNodeIterator it = featuresNode.begin(); it != featuresNode.end(); it++)
+	{
+		cv::FileNode featureNode = *it;
+		HaarNode feature;
+		int rectIndex = 0;
+
+		for (cv::FileNodeIterator rectIt = featureNode["rects"].begin(); rectIt != featureNode["rects"].end(); rectIt++)
+		{
+			readHaarNodeValues(*rectIt, values);
+
+			if (rectIndex >= 3 || values.size() != 5)
+			{
+				throw std::runtime_error("Invalid Haar feature rect");
+			}
+
+			HaarRect& rect = feature.rects[rectIndex++];
+			rect.rect = cv::Rect((int)values[0], (int)values[1], (int)values[2], (int)values[3]);
+			rect.weight = (float)values[4];
+		}
+
+		feature.isTilted = (int)featureNode["tilted"] != 0;
+		cascade.hasTiltedFeatures = cascade.hasTiltedFeatures || feature.isTilted;
+
+		features.push_back(feature);
+	}
+
+	for (cv::FileNodeIterator it = stagesNode.begin(); it != stagesNode.end(); it++)
+	{
+		cv::FileNode stageNode = *it;
+
+		HaarStage stage;
+		stage.firstTree = (int)cascade.trees.size();
+		stage.threshold = (float)(double)stageNode["stageThreshold"] - HAAR_STAGE_THRESHOLD_EPSILON;
+
+		cv::FileNode treesNode = stageNode["weakClassifiers"];
+
+		for (cv::FileNodeIterator treeIt = treesNode.begin(); treeIt != treesNode.end(); treeIt++)
+		{
+			cv::FileNode treeNode = *treeIt;
+
+			HaarTree tree;
+			tree.firstNode = (int)cascade.nodes.size();
+			tree.firstLeaf = (int)cascade.leaves.size();
+
+			readHaarNodeValues(treeNode["internalNodes"], values);
+
+			if (values.empty() || values.size() % 4 != 0)
+			{
+				throw std::runtime_error("Invalid Haar tree nodes");
+			}
+
+			for (size_t i = 0; i < values.size(); i += 4)
+			{
+				int featureIndex = (int)values[i + 2];
+
+				if (featureIndex < 0 || featureIndex >= (int)features.size())
+				{
+					throw std::runtime_error("Invalid Haar feature index");
+				}
+
+				HaarNode node = features[featureIndex];
+				node.left = (int)values[i];
+				node.right = (int)values[i + 1];
+				node.threshold = (float)values[i + 3];
+
+				cascade.nodes.push_back(node);
+			}
+
+			tree.nodesCount = (int)values.size() / 4;
+			cascade.maxTreeNodesCount = std::max(cascade.maxTreeNodesCount, tree.nodesCount);
+
+			readHaarNodeValues(treeNode["leafValues"], values);
+
+			for (double value : values)
+			{
+				cascade.leaves.push_back((float)value);
+			}
+
+			cascade.trees.push_back(tree);
+		}
+
+		stage.treesCount = (int)cascade.trees.size() - stage.firstTree;
+		cascade.stages.push_back(stage);
+	}
+
+	return cascade;
+}
+
+
+template <typename T>
+void appendHaarBinaryValue(std::string& buffer, T value)
+{
+	buffer.append((const char*)&value, sizeof(value));
+}
+
+
+template <typename T>
+void appendHaarBinaryArray(std::string& buffer, const std::vector<T>& values)
+{
+	appendHaarBinaryValue<uint64_t>(buffer, values.size());
+	buffer.append((const char*)values.data(), values.size() * sizeof(T));
+}
+
+
+void appendHaarCascadeBinary(std::string& buffer, const HaarCascade& cascade)
+{
+	// the arrays are raw structs, another build with another layout must not read them
+	appendHaarBinaryValue<uint32_t>(buffer, sizeof(HaarStage));
+	appendHaarBinaryValue<uint32_t>(buffer, sizeof(HaarTree));
+	appendHaarBinaryValue<uint32_t>(buffer, sizeof(HaarNode));
+
+	appendHaarBinaryValue<int32_t>(buffer, cascade.windowSize.width);
+	appendHaarBinaryValue<int32_t>(buffer, cascade.windowSize.height);
+	appendHaarBinaryValue<int32_t>(buffer, cascade.hasTiltedFeatures ? 1 : 0);
+	appendHaarBinaryValue<int32_t>(buffer, cascade.maxTreeNodesCount);
+
+	appendHaarBinaryArray(buffer, cascade.stages);
+	appendHaarBinaryArray(buffer, cascade.trees);
+	appendHaarBinaryArray(buffer, cascade.nodes);
+	appendHaarBinaryArray(buffer, cascade.leaves);
+}
+
+
+// bounds checked reads of the binary cascade
+struct HaarBinaryReader
+{
+	const uchar* data;
+	size_t size;
+	size_t offset;
+
+	template <typename T>
+	bool read(T& value)
+	{
+		if (size - offset < sizeof(T))
+		{
+			return false;
+		}
+
+		std::memcpy(&value, data + offset, sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+
+	template <typename T>
+	bool readArray(std::vector<T>& values)
+	{
+		uint64_t count = 0;
+
+		if (!read(count) || count > (size - offset) / sizeof(T))
+		{
+			return false;
+		}
+
+		values.resize((size_t)count);
+		std::memcpy(values.data(), data + offset, (size_t)count * sizeof(T));
+		offset += (size_t)count * sizeof(T);
+		return true;
+	}
+};
+
+
+bool readHaarCascadeBinary(const uchar* data, size_t size, HaarCascade& cascade)
+{
+	HaarBinaryReader reader = { data, size, 0 };
+
+	uint32_t stageSize = 0;
+	uint32_t treeSize = 0;
+	uint32_t nodeSize = 0;
+	int32_t width = 0;
+	int32_t height = 0;
+	int32_t hasTiltedFeatures = 0;
+	int32_t maxTreeNodesCount = 0;
+
+	if (!reader.read(stageSize) || !reader.read(treeSize) || !reader.read(nodeSize) ||
+		stageSize != sizeof(HaarStage) || treeSize != sizeof(HaarTree) || nodeSize != sizeof(HaarNode))
+	{
+		return false;
+	}
+
+	if (!reader.read(width) || !reader.read(height) || !reader.read(hasTiltedFeatures) || !reader.read(maxTreeNodesCount))
+	{
+		return false;
+	}
+
+	HaarCascade readCascade;
+	readCascade.windowSize = cv::Size(width, height);
+	readCascade.hasTiltedFeatures = hasTiltedFeatures != 0;
+	readCascade.maxTreeNodesCount = maxTreeNodesCount;
+
+	if (!reader.readArray(readCascade.stages) || !reader.readArray(readCascade.trees) ||
+		!reader.readArray(readCascade.nodes) || !reader.readArray(readCascade.leaves) || readCascade.stages.empty())
+	{
+		return false;
+	}
+
+	readCascade.id = ++lastCascadeId;
+	cascade = std::move(readCascade);
+	return true;
+}
+
+
+// node rect corners as offsets from the window origin in an integral plane with the given row step
+struct HaarStepNode
+{
+	int offsets[3][4];
+	float weights[3];
+	bool isTilted;
+	float threshold;
+	int left;
+	int right;
+};
+
+
+// a rect sum is p0 - p1 - p2 + p3
+void getHaarRectOffsets(const cv::Rect& rect, bool isTilted, int integralStep, int* offsets)
+{
+	if (isTilted)
+	{
+		offsets[0] = rect.y * integralStep + rect.x;
+		offsets[1] = (rect.y + rect.height) * integralStep + rect.x - rect.height;
+		offsets[2] = (rect.y + rect.width) * integralStep + rect.x + rect.width;
+		offsets[3] = (rect.y + rect.width + rect.height) * integralStep + rect.x + rect.width - rect.height;
+	}
+	else
+	{
+		offsets[0] = rect.y * integralStep + rect.x;
+		offsets[1] = rect.y * integralStep + rect.x + rect.width;
+		offsets[2] = (rect.y + rect.height) * integralStep + rect.x;
+		offsets[3] = (rect.y + rect.height) * integralStep + rect.x + rect.width;
+	}
+}
+
+
+std::shared_ptr<const std::vector<HaarStepNode>> compileHaarStepNodes(const HaarCascade& cascade, int integralStep)
+{
+	auto stepNodes = std::make_shared<std::vector<HaarStepNode>>(cascade.nodes.size());
+
+	for (size_t i = 0; i < cascade.nodes.size(); i++)
+	{
+		const HaarNode& node = cascade.nodes[i];
+		HaarStepNode& stepNode = (*stepNodes)[i];
+
+		for (int j = 0; j < 3; j++)
+		{
+			getHaarRectOffsets(node.rects[j].rect, node.isTilted, integralStep, stepNode.offsets[j]);
+			stepNode.weights[j] = node.rects[j].weight;
+		}
+
+		stepNode.isTilted = node.isTilted;
+		stepNode.threshold = node.threshold;
+		stepNode.left = node.left;
+		stepNode.right = node.right;
+	}
+
+	return stepNodes;
+}
+
+
+// compiled nodes of the cascades and steps last used on this thread, shared with the scale tasks of a call
+std::shared_ptr<const std::vector<HaarStepNode>> getHaarStepNodes(const HaarCascade& cascade, int integralStep)
+{
+	struct CachedStepNodes
+	{
+		int cascadeId;
+		int integralStep;
+		std::shared_ptr<const std::vector<HaarStepNode>> stepNodes;
+	};
+
+	thread_local std::vector<CachedStepNodes> cache;
+
+	for (const CachedStepNodes& cached : cache)
+	{
+		if (cached.cascadeId == cascade.id && cached.integralStep == integralStep)
+		{
+			return cached.stepNodes;
+		}
+	}
+
+	if (cache.size() >= HAAR_STEP_NODES_CACHE_SIZE)
+	{
+		cache.erase(cache.begin());
+	}
+
+	cache.push_back({ cascade.id, integralStep, compileHaarStepNodes(cascade, integralStep) });
+
+	return cache.back().stepNodes;
+}
+
+
+// 4 windows evaluated together
+struct HaarLanes
+{
+	int offsets[4]; // window origins in the integral planes
+	int stride; // 1 or 2 for consecutive windows of a row, 0 for any windows
+	float varianceNormFactors[4];
+};
+
+
+struct HaarScaleScan
+{
+	const HaarCascade* cascade;
+	const HaarStepNode* nodes;
+	const int* sum;
+	const int* squareSum;
+	const int* tiltedSum;
+	int integralStep;
+	cv::Size workingSize; // window origins
+	int windowStep;
+};
+
+
+int getHaarRectSum(const int* window, const int* offsets)
+{
+	return window[offsets[0]] - window[offsets[1]] - window[offsets[2]] + window[offsets[3]];
+}
+
+
+// 32-bit squared sums wrap on big images, the difference is taken modulo 2^32 as in cv::CascadeClassifier
+unsigned getHaarRectSquareSum(const int* window, const int* offsets)
+{
+	return (unsigned)window[offsets[0]] - (unsigned)window[offsets[1]] - (unsigned)window[offsets[2]] + (unsigned)window[offsets[3]];
+}
+
+
+#if defined(HAAR_CASCADE_SSE2)
+__m128i loadHaarLanes(const int* plane, const HaarLanes& lanes)
+{
+	const int* first = plane + lanes.offsets[0];
+
+	if (lanes.stride == 1)
+	{
+		return _mm_loadu_si128((const __m128i*)first);
+	}
+
+	if (lanes.stride == 2)
+	{
+		__m128 low = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)first));
+		__m128 high = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(first + 4)));
+		return _mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)));
+	}
+
+	return _mm_setr_epi32(plane[lanes.offsets[0]], plane[lanes.offsets[1]], plane[lanes.offsets[2]], plane[lanes.offsets[3]]);
+}
+
+
+__m128 getHaarRectSums4(const int* plane, const int* offsets, const HaarLanes& lanes)
+{
+	__m128i sums = _mm_sub_epi32(loadHaarLanes(plane + offsets[0], lanes), loadHaarLanes(plane + offsets[1], lanes));
+	sums = _mm_sub_epi32(sums, loadHaarLanes(plane + offsets[2], lanes));
+	sums = _mm_add_epi32(sums, loadHaarLanes(plane + offsets[3], lanes));
+
+	return _mm_cvtepi32_ps(sums);
+}
+#endif
+
+
+// bit per lane, set when the normalized feature value is below the node threshold
+int getHaarNodeMask4(const HaarScaleScan& scan, const HaarStepNode& node, const HaarLanes& lanes)
+{
+	const int* plane = node.isTilted ? scan.tiltedSum : scan.sum;
+
+#if defined(HAAR_CASCADE_SSE2)
+	__m128 values = _mm_add_ps(
+		_mm_mul_ps(_mm_set1_ps(node.weights[0]), getHaarRectSums4(plane, node.offsets[0], lanes)),
+		_mm_mul_ps(_mm_set1_ps(node.weights[1]), getHaarRectSums4(plane, node.offsets[1], lanes)));
+
+	if (node.weights[2] != 0.f)
+	{
+		values = _mm_add_ps(values, _mm_mul_ps(_mm_set1_ps(node.weights[2]), getHaarRectSums4(plane, node.offsets[2], lanes)));
+	}
+
+	values = _mm_mul_ps(values, _mm_loadu_ps(lanes.varianceNormFactors));
+
+	return _mm_movemask_ps(_mm_cmplt_ps(values, _mm_set1_ps(node.threshold)));
+#else
+	int mask = 0;
+
+	for (int lane = 0; lane < 4; lane++)
+	{
+		const int* window = plane + lanes.offsets[lane];
+		float value = node.weights[0] * (float)getHaarRectSum(window, node.offsets[0]) + node.weights[1] * (float)getHaarRectSum(window, node.offsets[1]);
+
+		if (node.weights[2] != 0.f)
+		{
+			value += node.weights[2] * (float)getHaarRectSum(window, node.offsets[2]);
+		}
+
+		if (value * lanes.varianceNormFactors[lane] < node.threshold)
+		{
+			mask |= 1 << lane;
+		}
+	}
+
+	return mask;
+#endif
+}
+
+
+// mask of the windows in lanesMask that pass the stage, nodeMasks holds a tree of node decisions
+int evaluateHaarStage4(const HaarScaleScan& scan, const HaarStage& stage, const HaarLanes& lanes, int lanesMask, int* nodeMasks)
+{
+	const HaarCascade& cascade = *scan.cascade;
+	double stageSums[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+	for (int treeIndex = stage.firstTree; treeIndex < stage.firstTree + stage.treesCount; treeIndex++)
+	{
+		const HaarTree& tree = cascade.trees[treeIndex];
+		const HaarStepNode* treeNodes = scan.nodes + tree.firstNode;
+
+		for (int i = 0; i < tree.nodesCount; i++)
+		{
+			nodeMasks[i] = getHaarNodeMask4(scan, treeNodes[i], lanes);
+		}
+
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if ((lanesMask >> lane & 1) == 0)
+			{
+				continue;
+			}
+
+			int nodeIndex = 0;
+
+			do
+			{
+				nodeIndex = (nodeMasks[nodeIndex] >> lane & 1) ? treeNodes[nodeIndex].left : treeNodes[nodeIndex].right;
+			} while (nodeIndex > 0);
+
+			stageSums[lane] += cascade.leaves[tree.firstLeaf - nodeIndex];
+		}
+	}
+
+	int passedMask = 0;
+
+	for (int lane = 0; lane < 4; lane++)
+	{
+		if ((lanesMask >> lane & 1) != 0 && stageSums[lane] >= stage.threshold)
+		{
+			passedMask |= 1 << lane;
+		}
+	}
+
+	return passedMask;
+}
+
+
+// scan buffers of this thread, they keep their capacity between the scales and frames
+struct HaarScanBuffers
+{
+	std::vector<float> varianceNormFactors;
+	std::vector<uint8_t> validFlags;
+	std::vector<uint8_t> firstStageFlags;
+	std::vector<int> survivors;
+	std::vector<int> nodeMasks;
+	std::vector<cv::Point> positions;
+};
+
+
+HaarScanBuffers& getHaarScanBuffers()
+{
+	thread_local HaarScanBuffers buffers;
+	return buffers;
+}
+
+
+// origins of the windows that pass every stage, in the visiting order of cv::CascadeClassifier
+void scanHaarScale(const HaarScaleScan& scan, std::vector<cv::Point>& positions)
+{
+	const HaarCascade& cascade = *scan.cascade;
+	int windowsCount = (scan.workingSize.width + scan.windowStep - 1) / scan.windowStep;
+
+	if (windowsCount <= 0 || scan.workingSize.height <= 0)
+	{
+		return;
+	}
+
+	// rows are padded to whole lanes, padding windows are invalid
+	HaarScanBuffers& buffers = getHaarScanBuffers();
+	std::vector<float>& varianceNormFactors = buffers.varianceNormFactors;
+	std::vector<uint8_t>& validFlags = buffers.validFlags;
+	std::vector<uint8_t>& firstStageFlags = buffers.firstStageFlags;
+	std::vector<int>& survivors = buffers.survivors;
+	std::vector<int>& nodeMasks = buffers.nodeMasks;
+
+	varianceNormFactors.assign(windowsCount + 3, 0.f);
+	validFlags.assign(windowsCount + 3, 0);
+	firstStageFlags.assign(windowsCount + 3, 0);
+	survivors.resize(windowsCount);
+	nodeMasks.resize(std::max(cascade.maxTreeNodesCount, 1));
+
+	// variance normalization rect, one pixel inside the window
+	cv::Rect normRect(1, 1, cascade.windowSize.width - 2, cascade.windowSize.height - 2);
+	int normOffsets[4];
+	getHaarRectOffsets(normRect, false, scan.integralStep, normOffsets);
+	double normArea = normRect.area();
+
+	HaarLanes lanes;
+
+	for (int y = 0; y < scan.workingSize.height; y += scan.windowStep)
+	{
+		int rowOffset = y * scan.integralStep;
+
+		// windows of flat areas are rejected before the first stage
+		for (int i = 0; i < windowsCount; i++)
+		{
+			int offset = rowOffset + i * scan.windowStep;
+			int windowSum = getHaarRectSum(scan.sum + offset, normOffsets);
+			unsigned windowSquareSum = getHaarRectSquareSum(scan.squareSum + offset, normOffsets);
+
+			double normFactor = normArea * windowSquareSum - (double)windowSum * windowSum;
+			float varianceNormFactor = normFactor > 0.0 ? (float)(1.0 / std::sqrt(normFactor)) : 0.f;
+			bool isValid = normFactor > 0.0 && normArea * varianceNormFactor < 1e-1;
+
+			varianceNormFactors[i] = isValid ? varianceNormFactor : 0.f;
+			validFlags[i] = isValid;
+		}
+
+		lanes.stride = scan.windowStep;
+
+		for (int i = 0; i < windowsCount; i += 4)
+		{
+			int validMask = 0;
+
+			for (int lane = 0; lane < 4; lane++)
+			{
+				lanes.offsets[lane] = rowOffset + (i + lane) * scan.windowStep;
+				lanes.varianceNormFactors[lane] = varianceNormFactors[i + lane];
+				validMask |= validFlags[i + lane] << lane;
+			}
+
+			int passedMask = validMask != 0 ? evaluateHaarStage4(scan, cascade.stages[0], lanes, validMask, nodeMasks.data()) : 0;
+
+			for (int lane = 0; lane < 4; lane++)
+			{
+				firstStageFlags[i + lane] = passedMask >> lane & 1;
+			}
+		}
+
+		// a window rejected by the first stage skips the next one
+		int survivorsCount = 0;
+
+		for (int i = 0; i < windowsCount; i++)
+		{
+			if (!validFlags[i])
+			{
+				continue;
+			}
+
+			if (!firstStageFlags[i])
+			{
+				i++;
+				continue;
+			}
+
+			survivors[survivorsCount++] = i;
+		}
+
+		lanes.stride = 0;
+
+		for (int i = 0; i < survivorsCount; i += 4)
+		{
+			int lanesMask = 0;
+
+			// missing lanes repeat the last survivor
+			for (int lane = 0; lane < 4; lane++)
+			{
+				int survivor = survivors[std::min(i + lane, survivorsCount - 1)];
+				lanes.offsets[lane] = rowOffset + survivor * scan.windowStep;
+				lanes.varianceNormFactors[lane] = varianceNormFactors[survivor];
+				lanesMask |= (i + lane < survivorsCount) << lane;
+			}
+
+			for (size_t stageIndex = 1; stageIndex < cascade.stages.size() && lanesMask != 0; stageIndex++)
+			{
+				lanesMask = evaluateHaarStage4(scan, cascade.stages[stageIndex], lanes, lanesMask, nodeMasks.data());
+			}
+
+			for (int lane = 0; lane < 4; lane++)
+			{
+				if ((lanesMask >> lane & 1) != 0)
+				{
+					positions.push_back(cv::Point(survivors[i + lane] * scan.windowStep, y));
+				}
+			}
+		}
+	}
+}
+
+
+// same scales as cv::CascadeClassifier: window sizes are rounded from the double factor,
+// size limits are checked on the float scale
+std::vector<float> getHaarScales(const cv::Size& windowSize, const cv::Size& imageSize, double scaleFactor, const cv::Size& minSize, cv::Size maxSize)
+{
+	if (maxSize.width == 0 || maxSize.height == 0)
+	{
+		maxSize = imageSize;
+	}
+
+	std::vector<float> scales;
+
+	for (double factor = 1.0; ; factor *= scaleFactor)
+	{
+		cv::Size factorWindowSize(cvRound(windowSize.width * factor), cvRound(windowSize.height * factor));
+
+		if (factorWindowSize.width > imageSize.width || factorWindowSize.height > imageSize.height)
+		{
+			break;
+		}
+
+		float scale = (float)factor;
+		cv::Size scaledWindowSize(cvRound(windowSize.width * scale), cvRound(windowSize.height * scale));
+
+		if (scaledWindowSize.width > maxSize.width || scaledWindowSize.height > maxSize.height)
+		{
+			break;
+		}
+
+		if (scaledWindowSize.width < minSize.width || scaledWindowSize.height < minSize.height)
+		{
+			continue;
+		}
+
+		scales.push_back(scale);
+	}
+
+	return scales;
+}
+
+
+void detectHaarScale(const HaarCascade& cascade, const HaarStepNode* nodes, const cv::Mat& image, float scale, int integralStep, std::vector<cv::Rect>& candidates)
+{
+	cv::Size scaledSize(cvRound(image.cols / scale), cvRound(image.rows / scale));
+	cv::Size workingSize(scaledSize.width + 1 - cascade.windowSize.width, scaledSize.height + 1 - cascade.windowSize.height);
+
+	if (workingSize.width <= 0 || workingSize.height <= 0)
+	{
+		return;
+	}
+
+	FrameArenaScope arenaScope;
+
+	cv::Mat scaledImage = image;
+
+	if (scaledSize != image.size())
+	{
+		scaledImage = arenaScope.acquire(scaledSize, CV_8UC1);
+		cv::resize(image, scaledImage, scaledSize, 0, 0, cv::INTER_LINEAR_EXACT);
+	}
+
+	// planes have the shared row step, lane loads past the row end read the padding columns
+	cv::Rect integralRect(0, 0, scaledSize.width + 1, scaledSize.height + 1);
+	cv::Mat sum = arenaScope.acquire(scaledSize.height + 1, integralStep, CV_32SC1)(integralRect);
+	cv::Mat squareSum = arenaScope.acquire(scaledSize.height + 1, integralStep, CV_32SC1)(integralRect);
+	cv::Mat tiltedSum;
+
+	if (cascade.hasTiltedFeatures)
+	{
+		tiltedSum = arenaScope.acquire(scaledSize.height + 1, integralStep, CV_32SC1)(integralRect);
+		cv::integral(scaledImage, sum, squareSum, tiltedSum, CV_32S, CV_32S);
+	}
+	else
+	{
+		cv::integral(scaledImage, sum, squareSum, CV_32S, CV_32S);
+	}
+
+	HaarScaleScan scan;
+	scan.cascade = &cascade;
+	scan.nodes = nodes;
+	scan.sum = sum.ptr<int>();
+	scan.squareSum = squareSum.ptr<int>();
+	scan.tiltedSum = cascade.hasTiltedFeatures ? tiltedSum.ptr<int>() : nullptr;
+	scan.integralStep = integralStep;
+	scan.workingSize = workingSize;
+	scan.windowStep = scale >= 2 ? 1 : 2;
+
+	std::vector<cv::Point>& positions = getHaarScanBuffers().positions;
+	positions.clear();
+	scanHaarScale(scan, positions);
+
+	cv::Size objectSize(cvRound(cascade.windowSize.width * scale), cvRound(cascade.windowSize.height * scale));
+
+	for (const cv::Point& position : positions)
+	{
+		candidates.push_back(cv::Rect(cvRound(position.x * scale), cvRound(position.y * scale), objectSize.width, objectSize.height));
+	}
+}
+
+
+void detectHaarCascadeCandidates(const HaarCascade& cascade, const cv::Mat& image, std::vector<cv::Rect>& candidates, double scaleFactor, const cv::Size& minSize, const cv::Size& maxSize)
+{
+	CV_Assert(image.type() == CV_8UC1 && scaleFactor > 1.0 && !cascade.stages.empty());
+
+	candidates.clear();
+
+	std::vector<float> scales = getHaarScales(cascade.windowSize, image.size(), scaleFactor, minSize, maxSize);
+
+	if (scales.empty())
+	{
+		return;
+	}
+
+	// the first scale has the widest integral, all scales share its row step so nodes are compiled once
+	int integralStep = (int)cv::alignSize(cvRound(image.cols / scales[0]) + 1 + HAAR_INTEGRAL_PADDING, HAAR_INTEGRAL_STEP_ALIGNMENT);
+	std::shared_ptr<const std::vector<HaarStepNode>> stepNodes = getHaarStepNodes(cascade, integralStep);
+
+	std::vector<std::vector<cv::Rect>> scalesCandidates(scales.size());
+
+	// scale tasks have no debug taps, so they don't follow the debug gate of the processing modes
+	bool isParallel = IS_PARALLEL_PROCESSING_ENABLED && scales.size() > 1 && image.total() >= HAAR_CASCADE_PARALLEL_MIN_PIXELS_COUNT;
+
+	if (isParallel)
+	{
+		ThreadPool& threadPool = getProcessingThreadPool();
+		std::vector<std::future<void>> futures;
+
+		// the first scale is the biggest one and runs on the calling thread
+		for (size_t i = 1; i < scales.size(); i++)
+		{
+			futures.push_back(threadPool.enqueue([&cascade, stepNodes, &image, &scales, &scalesCandidates, integralStep, i]() {
+				detectHaarScale(cascade, stepNodes->data(), image, scales[i], integralStep, scalesCandidates[i]);
+			}));
+		}
+
+		// the tasks reference the locals, none of them may outlive a throwing scale
+		try
+		{
+			detectHaarScale(cascade, stepNodes->data(), image, scales[0], integralStep, scalesCandidates[0]);
+
+			for (std::future<void>& future : futures)
+			{
+				threadPool.wait(future);
+			}
+		}
+		catch (...)
+		{
+			threadPool.drain(futures);
+			throw;
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < scales.size(); i++)
+		{
+			detectHaarScale(cascade, stepNodes->data(), image, scales[i], integralStep, scalesCandidates[i]);
+		}
+	}
+
+	for (const std::vector<cv::Rect>& scaleCandidates : scalesCandidates)
+	{
+		candidates.insert(candidates.end(), scaleCandidates.begin(), scaleCandidates.end());
+	}
+}
+
+
+void detectHaarCascade(const HaarCascade& cascade, const cv::Mat& image, std::vector<cv::Rect>& objects, double scaleFactor, int minNeighbours, const cv::Size& minSize, const cv::Size& maxSize)
+{
+	detectHaarCascadeCandidates(cascade, image, objects, scaleFactor, minSize, maxSize);
+
+	if (minNeighbours > 0)
+	{
+		cv::groupRectangles(objects, minNeighbours, 0.2);
+	}
+}
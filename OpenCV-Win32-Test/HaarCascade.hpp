@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "Constants.hpp"
+
+
+// Haar cascade in flat arrays, evaluated without cv::CascadeClassifier.
+// Detections are the same as detectMultiScale of the stock CPU evaluator: same scales, resize, window steps,
+// variance normalization, float feature arithmetic, stage thresholds and window skipping, then groupRectangles.
+// Only HAAR cascades of the current format (cascade/stages/features) are supported, as both bundled ones are.
+
+
+struct HaarRect
+{
+	cv::Rect rect;
+	float weight = 0.f;
+};
+
+
+// internal tree node, left and right are relative child indices or negated leaf indices
+struct HaarNode
+{
+	HaarRect rects[3];
+	bool isTilted = false;
+	float threshold = 0.f;
+	int left = 0;
+	int right = 0;
+};
+
+
+struct HaarTree
+{
+	int firstNode = 0;
+	int nodesCount = 0;
+	int firstLeaf = 0;
+};
+
+
+struct HaarStage
+{
+	int firstTree = 0;
+	int treesCount = 0;
+	float threshold = 0.f; // lowered by the same epsilon as cv::CascadeClassifier
+};
+
+
+struct HaarCascade
+{
+	int id = 0; // distinct per read cascade, keys compiled nodes
+	cv::Size windowSize;
+	bool hasTiltedFeatures = false;
+	int maxTreeNodesCount = 0;
+	std::vector<HaarStage> stages;
+	std::vector<HaarTree> trees;
+	std::vector<HaarNode> nodes;
+	std::vector<float> leaves;
+};
+
+
+HaarCascade readHaarCascade(const cv::FileNode& cascadeNode);
+// flat arrays as raw bytes for the cascade cache, readable only by a build with the same struct layout
+void appendHaarCascadeBinary(std::string& buffer, const HaarCascade& cascade);
+// false for truncated data or another layout
+bool readHaarCascadeBinary(const uchar* data, size_t size, HaarCascade& cascade);
+// scaled windows of detectMultiScale that pass every stage, before grouping
+void detectHaarCascadeCandidates(const HaarCascade& cascade, const cv::Mat& image, std::vector<cv::Rect>& candidates, double scaleFactor, const cv::Size& minSize, const cv::Size& maxSize);
+void detectHaarCascade(const HaarCascade& cascade, const cv::Mat& image, std::vector<cv::Rect>& objects, double scaleFactor, int minNeighbours, const cv::Size& minSize, const cv::Size& maxSize);
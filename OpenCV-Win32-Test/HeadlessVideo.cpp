@@ -0,0 +1,65 @@
+#include <opencv2/videoio.hpp>
+
+#include "HeadlessVideo.hpp"
+#include "CvUtils.hpp"
+#include "FaceProcessing.hpp"
+#include "Utils.hpp"
+#include "VideoPipeline.hpp"
+
+
+// total time includes decoding, the rest is the front-end overhead
+void printHeadlessVideoStatistics(int64 framesCount, int64 totalTicks)
+{
+	double averageTotal = framesCount > 0 ? ticksToMilliseconds(totalTicks) / framesCount : 0.0;
+
+	std::cout << "Headless video, frames : " << framesCount << std::endl;
+	std::cout << "Headless video, total ms per frame : " << averageTotal << std::endl;
+	std::cout << "Headless video, frames per second : " << (averageTotal > 0 ? 1000.0 / averageTotal : 0.0) << std::endl;
+}
+
+
+void runHeadlessVideo(DetectionCascade& face_cascade, DetectionCascade& eyes_cascade, const Parameters& parameters)
+{
+	cv::VideoCapture capture(parameters.videoFilePath);
+	if (!capture.isOpened())
+	{
+		throw std::runtime_error("Can't open video file: " + parameters.videoFilePath);
+	}
+
+	int64 startTicks = cv::getTickCount();
+
+	// stage threads overlap, only the total time per frame is meaningful
+	if (parameters.modes.isVideoPipelineActive)
+	{
+		VideoPipelineStatistics statistics = runVideoPipeline(capture, face_cascade, eyes_cascade, parameters, false, nullptr);
+		printHeadlessVideoStatistics(statistics.outputFramesCount, cv::getTickCount() - startTicks);
+		return;
+	}
+
+	FaceTrackingState trackingState;
+	int64 frameIndex = 0;
+	int64 processingTicksSum = 0;
+
+	cv::Mat frame;
+	while (capture.read(frame) && !frame.empty())
+	{
+		int64 frameTicks = cv::getTickCount();
+
+		std::vector<FaceDetectionResult> faceResults = detectFacesAndEyes(face_cascade, eyes_cascade, frame, trackingState, parameters);
+		processEyes(frame, faceResults, parameters);
+		writeFrameResult(makeFrameResult(frameIndex, frameTicks, faceResults));
+
+		processingTicksSum += cv::getTickCount() - frameTicks;
+
+		if (frameIndex == 0)
+		{
+			reportStartupTime("first detection");
+		}
+
+		frameIndex++;
+	}
+
+	printHeadlessVideoStatistics(frameIndex, cv::getTickCount() - startTicks);
+	std::cout << "Headless video, processing ms per frame : " << (frameIndex > 0 ? ticksToMilliseconds(processingTicksSum) / frameIndex : 0.0) << std::endl;
+	printFaceTrackingStatistics(trackingState);
+}
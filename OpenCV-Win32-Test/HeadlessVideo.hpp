@@ -0,0 +1,12 @@
+#pragma once
+
+#include <opencv2/objdetect.hpp>
+
+#include "Cascades.hpp"
+#include "Constants.hpp"
+#include "Parameters.hpp"
+
+
+// Headless front-end for display-less servers: reads every frame of the video file, streams the frame results
+// and prints the per-frame time. No HighGUI, no drawing, debug taps only write result images.
+void runHeadlessVideo(DetectionCascade& face_cascade, DetectionCascade& eyes_cascade, const Parameters& parameters);
@@ -0,0 +1,65 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "HeapCounter.hpp"
+
+
+std::atomic<bool> isHeapCountingEnabled(false);
+std::atomic<int64> heapAllocationsCount(0);
+std::atomic<int64> heapAllocatedBytesCount(0);
+
+
+void setHeapCountingEnabled(bool isEnabled)
+{
+	isHeapCountingEnabled = isEnabled;
+}
+
+
+int64 getHeapAllocationsCount()
+{
+	return heapAllocationsCount;
+}
+
+
+int64 getHeapAllocatedBytesCount()
+{
+	return heapAllocatedBytesCount;
+}
+
+
+// array, nothrow and sized forms forward to these two by default, aligned forms keep the runtime ones
+void* operator new(std::size_t size)
+{
+	if (isHeapCountingEnabled.load(std::memory_order_relaxed))
+	{
+		heapAllocationsCount.fetch_add(1, std::memory_order_relaxed);
+		heapAllocatedBytesCount.fetch_add((int64)size, std::memory_order_relaxed);
+	}
+
+	while (true)
+	{
+		// zero sized allocations still return distinct pointers
+		void* pointer = std::malloc(size > 0 ? size : 1);
+
+		if (pointer)
+		{
+			return pointer;
+		}
+
+		std::new_handler newHandler = std::get_new_handler();
+
+		if (!newHandler)
+		{
+			throw std::bad_alloc();
+		}
+
+		newHandler();
+	}
+}
+
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
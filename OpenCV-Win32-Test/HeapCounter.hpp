@@ -0,0 +1,11 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+
+// Global operator new of this executable counts allocations of every thread while counting is enabled.
+// Allocations made inside the OpenCV binaries go through their own runtime and aren't seen,
+// their Mat buffers are counted by the benchmark Mat allocator instead.
+void setHeapCountingEnabled(bool isEnabled);
+int64 getHeapAllocationsCount();
+int64 getHeapAllocatedBytesCount();
@@ -0,0 +1,153 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <stdexcept>
+
+#include "MappedFile.hpp"
+
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filePath) :
+	fileHandle(INVALID_HANDLE_VALUE),
+	mappingHandle(nullptr),
+	data(nullptr),
+	size(0)
+{
+	fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("Bad file " + filePath);
+	}
+
+	LARGE_INTEGER fileSize;
+
+	// empty files can't be mapped
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart <= 0)
+	{
+		close();
+		throw std::runtime_error("Can't read file: " + filePath);
+	}
+
+	size = (size_t)fileSize.QuadPart;
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (mappingHandle != nullptr)
+	{
+		data = (const uchar*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	}
+
+	if (data == nullptr)
+	{
+		close();
+		throw std::runtime_error("Can't map file: " + filePath);
+	}
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filePath) :
+	fileDescriptor(-1),
+	data(nullptr),
+	size(0)
+{
+	fileDescriptor = open(filePath.c_str(), O_RDONLY);
+
+	if (fileDescriptor < 0)
+	{
+		throw std::runtime_error("Bad file " + filePath);
+	}
+
+	struct stat fileStatus;
+
+	// empty files can't be mapped
+	if (fstat(fileDescriptor, &fileStatus) != 0 || fileStatus.st_size <= 0)
+	{
+		close();
+		throw std::runtime_error("Can't read file: " + filePath);
+	}
+
+	size = (size_t)fileStatus.st_size;
+	void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+
+	if (mapping == MAP_FAILED)
+	{
+		close();
+		throw std::runtime_error("Can't map file: " + filePath);
+	}
+
+	data = (const uchar*)mapping;
+	madvise(mapping, size, MADV_SEQUENTIAL);
+}
+
+#endif
+
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+
+const uchar* MappedFile::getData() const
+{
+	return data;
+}
+
+
+size_t MappedFile::getSize() const
+{
+	return size;
+}
+
+
+#ifdef _WIN32
+
+void MappedFile::close()
+{
+	if (data != nullptr)
+	{
+		UnmapViewOfFile(data);
+		data = nullptr;
+	}
+
+	if (mappingHandle != nullptr)
+	{
+		CloseHandle(mappingHandle);
+		mappingHandle = nullptr;
+	}
+
+	if (fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(fileHandle);
+		fileHandle = INVALID_HANDLE_VALUE;
+	}
+}
+
+#else
+
+void MappedFile::close()
+{
+	if (data != nullptr)
+	{
+		munmap((void*)data, size);
+		data = nullptr;
+	}
+
+	if (fileDescriptor >= 0)
+	{
+		::close(fileDescriptor);
+		fileDescriptor = -1;
+	}
+}
+
+#endif
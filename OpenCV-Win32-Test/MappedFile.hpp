@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+
+#include <opencv2/core.hpp>
+
+
+// Read-only view of a whole file mapped into memory, the mapping lives as long as the object.
+// Win32 file mapping on Windows, mmap elsewhere. Missing and empty files throw std::runtime_error.
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::string& filePath);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const uchar* getData() const;
+	size_t getSize() const;
+
+private:
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+	const uchar* data;
+	size_t size;
+
+	void close();
+};
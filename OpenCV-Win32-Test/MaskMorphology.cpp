@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cstring>
+
+#include <opencv2/imgproc.hpp>
+
+#include "MaskMorphology.hpp"
+#include "FrameArena.hpp"
+
+
+// Working planes hold bits as 0/1 bytes. A window is decided by the pixels that differ from the operation's
+// neutral value: zeros for erosion, ones for dilation. The output is set when the window has none of them
+// for erosion and at least one for dilation.
+
+
+void filterMaskRow(const uint8_t* bits, uint8_t* outputRow, int cols, int radius, bool isErosion, uint8_t setValue)
+{
+	const uint8_t decidingBit = isErosion ? 0 : 1;
+	int decidingCount = 0;
+
+	for (int j = 0; j <= std::min(radius, cols - 1); j++)
+	{
+		decidingCount += bits[j] == decidingBit;
+	}
+
+	for (int j = 0; j < cols; j++)
+	{
+		outputRow[j] = ((decidingCount > 0) != isErosion) ? setValue : 0;
+
+		int enteringCol = j + radius + 1;
+		int leavingCol = j - radius;
+
+		if (enteringCol < cols)
+		{
+			decidingCount += bits[enteringCol] == decidingBit;
+		}
+
+		if (leavingCol >= 0)
+		{
+			decidingCount -= bits[leavingCol] == decidingBit;
+		}
+	}
+}
+
+
+// bitsLut maps source levels to bits, without it the source already holds bits
+void filterMaskRows(const cv::Mat& source, const uint8_t* bitsLut, cv::Mat& output, int radius, bool isErosion, uint8_t setValue, uint8_t* rowBits)
+{
+	int cols = source.cols;
+
+	for (int i = 0; i < source.rows; i++)
+	{
+		const uint8_t* sourceRow = source.ptr<uint8_t>(i);
+		const uint8_t* bits = sourceRow;
+
+		// mapped to a separate row first, so the output may be the source
+		if (bitsLut != nullptr)
+		{
+			for (int j = 0; j < cols; j++)
+			{
+				rowBits[j] = bitsLut[sourceRow[j]];
+			}
+
+			bits = rowBits;
+		}
+
+		filterMaskRow(bits, output.ptr<uint8_t>(i), cols, radius, isErosion, setValue);
+	}
+}
+
+
+void addDecidingRow(const uint8_t* bits, int* decidingCounts, int cols, uint8_t decidingBit, int sign)
+{
+	for (int j = 0; j < cols; j++)
+	{
+		decidingCounts[j] += sign * (bits[j] == decidingBit);
+	}
+}
+
+
+// counts slide down the image, every row is added and removed once
+void filterMaskColumns(const cv::Mat& bits, cv::Mat& output, int radius, bool isErosion, uint8_t setValue, int* decidingCounts)
+{
+	const uint8_t decidingBit = isErosion ? 0 : 1;
+	int rows = bits.rows;
+	int cols = bits.cols;
+
+	std::fill(decidingCounts, decidingCounts + cols, 0);
+
+	for (int i = 0; i <= std::min(radius, rows - 1); i++)
+	{
+		addDecidingRow(bits.ptr<uint8_t>(i), decidingCounts, cols, decidingBit, 1);
+	}
+
+	for (int i = 0; i < rows; i++)
+	{
+		uint8_t* outputRow = output.ptr<uint8_t>(i);
+
+		for (int j = 0; j < cols; j++)
+		{
+			outputRow[j] = ((decidingCounts[j] > 0) != isErosion) ? setValue : 0;
+		}
+
+		int enteringRow = i + radius + 1;
+		int leavingRow = i - radius;
+
+		if (enteringRow < rows)
+		{
+			addDecidingRow(bits.ptr<uint8_t>(enteringRow), decidingCounts, cols, decidingBit, 1);
+		}
+
+		if (leavingRow >= 0)
+		{
+			addDecidingRow(bits.ptr<uint8_t>(leavingRow), decidingCounts, cols, decidingBit, -1);
+		}
+	}
+}
+
+
+void runMaskMorphology(const cv::Mat& source, const uint8_t* bitsLut, cv::Mat& mask, uint8_t maskValue, int erosionIterationsCount, int dilationIterationsCount)
+{
+	CV_Assert(source.type() == CV_8UC1);
+
+	int rows = source.rows;
+	int cols = source.cols;
+
+	mask.create(rows, cols, CV_8UC1);
+
+	if (rows == 0 || cols == 0)
+	{
+		return;
+	}
+
+	// zero iterations leave the mask untouched, as cv::erode and cv::dilate do
+	struct MorphologyStep
+	{
+		int radius;
+		bool isErosion;
+	};
+
+	MorphologyStep steps[2];
+	int stepsCount = 0;
+
+	if (erosionIterationsCount > 0)
+	{
+		steps[stepsCount++] = { erosionIterationsCount, true };
+	}
+
+	if (dilationIterationsCount > 0)
+	{
+		steps[stepsCount++] = { dilationIterationsCount, false };
+	}
+
+	FrameArenaScope arenaScope;
+	uint8_t* rowBits = arenaScope.acquire(1, cols, CV_8UC1).ptr<uint8_t>();
+
+	if (stepsCount == 0)
+	{
+		filterMaskRows(source, bitsLut, mask, 0, true, maskValue, rowBits);
+		return;
+	}
+
+	cv::Mat rowsBits = arenaScope.acquire(rows, cols, CV_8UC1);
+	cv::Mat columnsBits = arenaScope.acquire(rows, cols, CV_8UC1);
+	int* decidingCounts = arenaScope.acquire(1, cols, CV_32SC1).ptr<int>();
+
+	for (int stepIndex = 0; stepIndex < stepsCount; stepIndex++)
+	{
+		const MorphologyStep& step = steps[stepIndex];
+		bool isLastStep = stepIndex == stepsCount - 1;
+
+		// the first step reads the source through the threshold, the next one reads the previous step
+		if (stepIndex == 0)
+		{
+			filterMaskRows(source, bitsLut, rowsBits, step.radius, step.isErosion, 1, rowBits);
+		}
+		else
+		{
+			filterMaskRows(columnsBits, nullptr, rowsBits, step.radius, step.isErosion, 1, rowBits);
+		}
+
+		filterMaskColumns(rowsBits, isLastStep ? mask : columnsBits, step.radius, step.isErosion, isLastStep ? maskValue : 1, decidingCounts);
+	}
+}
+
+
+void thresholdMaskMorphology(const cv::Mat& source, cv::Mat& mask, const CenterDetectorParameters& parameters, int thresholdType)
+{
+	CV_Assert(thresholdType == cv::THRESH_BINARY || thresholdType == cv::THRESH_BINARY_INV);
+
+	// same level test as cv::threshold on 8-bit images
+	uint8_t bitsLut[256];
+
+	for (int i = 0; i < 256; i++)
+	{
+		bool isAboveThreshold = i > parameters.threshold;
+		bitsLut[i] = (thresholdType == cv::THRESH_BINARY) == isAboveThreshold ? 1 : 0;
+	}
+
+	runMaskMorphology(source, bitsLut, mask, cv::saturate_cast<uint8_t>(parameters.maxThreshold),
+		parameters.isErosionEnabled ? parameters.erosionIterationsCount : 0,
+		parameters.isDilationEnabled ? parameters.dilationIterationsCount : 0);
+}
+
+
+void applyMaskMorphology(const cv::Mat& source, cv::Mat& mask, uint8_t maskValue, int erosionIterationsCount, int dilationIterationsCount)
+{
+	uint8_t bitsLut[256];
+
+	for (int i = 0; i < 256; i++)
+	{
+		bitsLut[i] = i != 0 ? 1 : 0;
+	}
+
+	runMaskMorphology(source, bitsLut, mask, maskValue, erosionIterationsCount, dilationIterationsCount);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include "Constants.hpp"
+#include "Parameters.hpp"
+
+
+// Binary mask threshold, erosion and dilation without a pass per iteration.
+// n iterations of the default 3x3 kernel equal one (2n+1)x(2n+1) rectangle, which is separable,
+// and a binary window only needs the count of pixels that decide it, so every pass keeps running counts
+// along rows or columns and costs the same for any iterations count. The threshold is folded into the first pass.
+// Bit-identical to cv::threshold (THRESH_BINARY or THRESH_BINARY_INV), cv::erode and cv::dilate
+// with the default kernel, anchor and border. Pixels outside a submatrix are ignored, as with BORDER_ISOLATED.
+// Source and mask may be the same Mat.
+void thresholdMaskMorphology(const cv::Mat& source, cv::Mat& mask, const CenterDetectorParameters& parameters, int thresholdType);
+// erosion and dilation of a mask that holds only 0 and maskValue
+void applyMaskMorphology(const cv::Mat& source, cv::Mat& mask, uint8_t maskValue, int erosionIterationsCount, int dilationIterationsCount);
@@ -0,0 +1,478 @@
+#include <algorithm>
+#include <fstream>
+#include <future>
+#include <sstream>
+
+#include <opencv2/imgproc.hpp>
+
+#include "ParameterSweep.hpp"
+#include "BatchProcessing.hpp"
+#include "CenterOfMass.hpp"
+#include "CvUtils.hpp"
+#include "DebugTap.hpp"
+#include "MaskMorphology.hpp"
+#include "ThreadPool.hpp"
+#include "Utils.hpp"
+
+
+// scores of one pupil/sclera pair per dataset, the last dataset index holds all datasets
+typedef std::vector<SweepScore> SweepDatasetScores;
+
+
+struct SweepBest
+{
+	size_t pupilIndex = 0;
+	size_t scleraIndex = 0;
+	SweepScore score;
+};
+
+
+double SweepScore::getScore() const
+{
+	return eyesCount > 0 ? distanceSum / eyesCount : 1.0;
+}
+
+
+std::vector<CenterDetectorParameters> makeSweepGrid(const CenterDetectorParameters& baseParameters, const std::vector<int>& thresholds)
+{
+	std::vector<CenterDetectorParameters> grid = { baseParameters };
+
+	for (int threshold : thresholds)
+	{
+		for (int erosionIterationsCount : SWEEP_EROSION_ITERATIONS)
+		{
+			for (int dilationIterationsCount : SWEEP_DILATION_ITERATIONS)
+			{
+				CenterDetectorParameters gridParameters = baseParameters;
+				gridParameters.threshold = threshold;
+				gridParameters.isErosionEnabled = erosionIterationsCount > 0;
+				gridParameters.erosionIterationsCount = erosionIterationsCount;
+				gridParameters.isDilationEnabled = dilationIterationsCount > 0;
+				gridParameters.dilationIterationsCount = dilationIterationsCount;
+
+				grid.push_back(gridParameters);
+			}
+		}
+	}
+
+	return grid;
+}
+
+
+std::vector<SweepEye> cacheImageEyes(const std::string& imagePath, int datasetIndex, const CascadeFile& faceCascadeFile, const CascadeFile& eyesCascadeFile, const Parameters& parameters)
+{
+	std::vector<SweepEye> eyes;
+
+	cv::Mat image = readImageMapped(imagePath);
+
+	if (image.empty())
+	{
+		return eyes;
+	}
+
+	WorkerCascades& workerCascades = getWorkerCascades(faceCascadeFile, eyesCascadeFile);
+	FaceTrackingState trackingState;
+
+	std::vector<FaceDetectionResult> faceResults = detectFacesAndEyes(workerCascades.face_cascade, workerCascades.eyes_cascade, image, trackingState, parameters);
+
+	for (const FaceDetectionResult& faceResult : faceResults)
+	{
+		for (const EyeDetectionResult& eyeResult : faceResult.eyes)
+		{
+			cv::Mat eyeRoi = image(getEyeFrameRect(faceResult, eyeResult));
+			cv::Mat eyeImage = eyeRoi(getEyeCutRowsRange(eyeRoi, parameters.eye), cv::Range(0, eyeRoi.cols));
+
+			if (eyeImage.empty())
+			{
+				continue;
+			}
+
+			cv::Mat hsvImage;
+			cv::cvtColor(eyeImage, hsvImage, cv::COLOR_BGR2HSV);
+
+			std::vector<cv::Mat> channels;
+			cv::split(hsvImage, channels);
+
+			SweepEye eye;
+			eye.datasetIndex = datasetIndex;
+			eye.eyeWidth = eyeImage.cols;
+			eye.hue = channels[0];
+			eye.saturation = channels[1];
+			eye.value = channels[2];
+
+			// equalization doesn't depend on the swept parameters, so it's done once per eye
+			if (parameters.saturationSclera.isHistogramEqualizationEnabled)
+			{
+				cv::equalizeHist(eye.saturation, eye.saturation);
+			}
+
+			if (parameters.pupil.isHistogramEqualizationEnabled)
+			{
+				cv::equalizeHist(eye.value, eye.value);
+			}
+
+			eyes.push_back(eye);
+		}
+	}
+
+	return eyes;
+}
+
+
+const cv::Mat& getSweepPlane(const SweepEye& eye, SweepChannel channel)
+{
+	switch (channel)
+	{
+	case SweepChannel::HUE:
+		return eye.hue;
+	case SweepChannel::SATURATION:
+		return eye.saturation;
+	case SweepChannel::VALUE:
+	default:
+		return eye.value;
+	}
+}
+
+
+// same threshold, morphology and center of mass steps as the detectors, without debug taps
+std::vector<SweepDetection> evaluateSweepDetector(const std::vector<SweepEye>& eyes, const SweepDetector& detector, const CenterDetectorParameters& parameters)
+{
+	std::vector<SweepDetection> detections(eyes.size());
+
+	const cv::Mat kernel = cv::Mat();
+	const cv::Point anchor = cv::Point(-1, -1);
+	cv::Mat mask;
+
+	for (size_t eyeIndex = 0; eyeIndex < eyes.size(); eyeIndex++)
+	{
+		const cv::Mat& plane = getSweepPlane(eyes[eyeIndex], detector.channel);
+
+		if (IS_MASK_MORPHOLOGY_ENABLED)
+		{
+			thresholdMaskMorphology(plane, mask, parameters, detector.thresholdType);
+		}
+		else
+		{
+			cv::threshold(plane, mask, parameters.threshold, parameters.maxThreshold, detector.thresholdType);
+
+			if (parameters.isErosionEnabled)
+			{
+				cv::erode(mask, mask, kernel, anchor, parameters.erosionIterationsCount);
+			}
+
+			if (parameters.isDilationEnabled)
+			{
+				cv::dilate(mask, mask, kernel, anchor, parameters.dilationIterationsCount);
+			}
+		}
+
+		double maskCoverage = (double)cv::countNonZero(mask) / mask.total();
+
+		if (maskCoverage > SWEEP_MAX_MASK_COVERAGE)
+		{
+			continue;
+		}
+
+		// single band, the sweep is already parallel over grid points
+		CenterOfMass centerOfMass = getCenterOfMass8UC1(mask, 1);
+
+		detections[eyeIndex].center = centerOfMass.center;
+		detections[eyeIndex].isValid = !centerOfMass.isEmpty;
+	}
+
+	return detections;
+}
+
+
+void addSweepEyeScore(SweepScore& score, bool isValid, double distance)
+{
+	score.eyesCount++;
+
+	if (isValid)
+	{
+		score.validEyesCount++;
+		score.distanceSum += distance;
+	}
+	else
+	{
+		score.distanceSum += 1.0;
+	}
+}
+
+
+// one pupil grid point against every sclera grid point
+std::vector<SweepDatasetScores> scorePupilGridPoint(const std::vector<SweepEye>& eyes, const std::vector<SweepDetection>& pupilDetections, const std::vector<std::vector<SweepDetection>>& scleraGridDetections, size_t datasetsCount)
+{
+	std::vector<SweepDatasetScores> scores(scleraGridDetections.size(), SweepDatasetScores(datasetsCount + 1));
+
+	for (size_t scleraIndex = 0; scleraIndex < scleraGridDetections.size(); scleraIndex++)
+	{
+		const std::vector<SweepDetection>& scleraDetections = scleraGridDetections[scleraIndex];
+		SweepDatasetScores& datasetScores = scores[scleraIndex];
+
+		for (size_t eyeIndex = 0; eyeIndex < eyes.size(); eyeIndex++)
+		{
+			const SweepDetection& pupilDetection = pupilDetections[eyeIndex];
+			const SweepDetection& scleraDetection = scleraDetections[eyeIndex];
+
+			bool isValid = pupilDetection.isValid && scleraDetection.isValid;
+			double distance = isValid ?
+				std::min(1.0, cv::norm(pupilDetection.center - scleraDetection.center) / eyes[eyeIndex].eyeWidth) : 1.0;
+
+			addSweepEyeScore(datasetScores[eyes[eyeIndex].datasetIndex], isValid, distance);
+			addSweepEyeScore(datasetScores[datasetsCount], isValid, distance);
+		}
+	}
+
+	return scores;
+}
+
+
+std::vector<std::future<std::vector<SweepDetection>>> enqueueSweepDetector(ThreadPool& threadPool, const std::vector<SweepEye>& eyes, const SweepDetector& detector)
+{
+	std::vector<std::future<std::vector<SweepDetection>>> detectionFutures;
+
+	for (const CenterDetectorParameters& gridParameters : detector.grid)
+	{
+		detectionFutures.push_back(threadPool.enqueue([&eyes, &detector, &gridParameters]() {
+			return evaluateSweepDetector(eyes, detector, gridParameters);
+		}));
+	}
+
+	return detectionFutures;
+}
+
+
+template <typename Result>
+std::vector<Result> waitAll(ThreadPool& threadPool, std::vector<std::future<Result>>& futures)
+{
+	std::vector<Result> results;
+
+	for (std::future<Result>& future : futures)
+	{
+		results.push_back(threadPool.wait(future));
+	}
+
+	return results;
+}
+
+
+// the loaded parameters are the first grid point, so they win ties
+SweepBest findSweepBest(const std::vector<std::vector<SweepDatasetScores>>& scores, size_t datasetIndex)
+{
+	SweepBest best;
+	best.score = scores[0][0][datasetIndex];
+
+	for (size_t pupilIndex = 0; pupilIndex < scores.size(); pupilIndex++)
+	{
+		for (size_t scleraIndex = 0; scleraIndex < scores[pupilIndex].size(); scleraIndex++)
+		{
+			const SweepScore& score = scores[pupilIndex][scleraIndex][datasetIndex];
+
+			if (score.getScore() < best.score.getScore())
+			{
+				best.pupilIndex = pupilIndex;
+				best.scleraIndex = scleraIndex;
+				best.score = score;
+			}
+		}
+	}
+
+	return best;
+}
+
+
+std::string formatSweepGridPoint(const CenterDetectorParameters& parameters)
+{
+	std::stringstream ss;
+	ss << "threshold " << parameters.threshold <<
+		", erosion " << (parameters.isErosionEnabled ? parameters.erosionIterationsCount : 0) <<
+		", dilation " << (parameters.isDilationEnabled ? parameters.dilationIterationsCount : 0);
+	return ss.str();
+}
+
+
+void writeSweepResultLine(std::ofstream& fout, const std::string& datasetName, const std::string& scleraDetectorName, bool isCurrent, const SweepScore& score, const CenterDetectorParameters& pupilParameters, const CenterDetectorParameters& scleraParameters)
+{
+	fout << datasetName << "," << scleraDetectorName << "," << (isCurrent ? "current" : "best") << "," <<
+		score.getScore() << "," << score.validEyesCount << "," << score.eyesCount << "," <<
+		pupilParameters.threshold << "," << (pupilParameters.isErosionEnabled ? pupilParameters.erosionIterationsCount : 0) << "," <<
+		(pupilParameters.isDilationEnabled ? pupilParameters.dilationIterationsCount : 0) << "," <<
+		scleraParameters.threshold << "," << (scleraParameters.isErosionEnabled ? scleraParameters.erosionIterationsCount : 0) << "," <<
+		(scleraParameters.isDilationEnabled ? scleraParameters.dilationIterationsCount : 0) << std::endl;
+}
+
+
+void runParameterSweep(const CascadeFile& faceCascadeFile, const CascadeFile& eyesCascadeFile, const Parameters& parameters)
+{
+	// headless mode, debug windows can't be shown from workers
+	setDebugTapSink(nullptr);
+
+	std::vector<std::string> imagePaths = findDatasetImages(BATCH_DATASETS_ROOT_PATH);
+	std::vector<std::string> datasetNames;
+
+	for (const std::string& imagePath : imagePaths)
+	{
+		std::string datasetName = getDatasetName(imagePath);
+
+		if (std::find(datasetNames.begin(), datasetNames.end(), datasetName) == datasetNames.end())
+		{
+			datasetNames.push_back(datasetName);
+		}
+	}
+
+	ThreadPool& threadPool = getProcessingThreadPool();
+
+	int64 startTicks = cv::getTickCount();
+
+
+	// face and eyes detection, once per image
+
+	std::vector<std::vector<SweepEye>> imagesEyes = threadPool.map(imagePaths.size(), [&](size_t imageIndex) {
+		const std::string& imagePath = imagePaths[imageIndex];
+		int datasetIndex = (int)(std::find(datasetNames.begin(), datasetNames.end(), getDatasetName(imagePath)) - datasetNames.begin());
+
+		return cacheImageEyes(imagePath, datasetIndex, faceCascadeFile, eyesCascadeFile, parameters);
+	});
+
+	std::vector<SweepEye> eyes;
+
+	for (std::vector<SweepEye>& imageEyes : imagesEyes)
+	{
+		eyes.insert(eyes.end(), imageEyes.begin(), imageEyes.end());
+	}
+
+	int64 detectionTicks = cv::getTickCount() - startTicks;
+
+	// end face and eyes detection
+
+
+	// detector grids, every grid point of every detector is a separate task
+
+	SweepDetector pupilDetector;
+	pupilDetector.name = "pupil";
+	pupilDetector.channel = SweepChannel::VALUE;
+	pupilDetector.thresholdType = cv::THRESH_BINARY_INV;
+	pupilDetector.grid = makeSweepGrid(parameters.pupil, SWEEP_PUPIL_THRESHOLDS);
+
+	std::vector<SweepDetector> scleraDetectors(2);
+	scleraDetectors[0].name = "saturation_sclera";
+	scleraDetectors[0].channel = SweepChannel::SATURATION;
+	scleraDetectors[0].thresholdType = cv::THRESH_BINARY_INV;
+	scleraDetectors[0].grid = makeSweepGrid(parameters.saturationSclera, SWEEP_SATURATION_SCLERA_THRESHOLDS);
+	scleraDetectors[1].name = "hue_sclera";
+	scleraDetectors[1].channel = SweepChannel::HUE;
+	scleraDetectors[1].thresholdType = cv::THRESH_BINARY;
+	scleraDetectors[1].grid = makeSweepGrid(parameters.hueSclera, SWEEP_HUE_SCLERA_THRESHOLDS);
+
+	std::vector<std::future<std::vector<SweepDetection>>> pupilFutures = enqueueSweepDetector(threadPool, eyes, pupilDetector);
+	std::vector<std::vector<std::future<std::vector<SweepDetection>>>> scleraFutures;
+
+	for (const SweepDetector& scleraDetector : scleraDetectors)
+	{
+		scleraFutures.push_back(enqueueSweepDetector(threadPool, eyes, scleraDetector));
+	}
+
+	std::vector<std::vector<SweepDetection>> pupilGridDetections = waitAll(threadPool, pupilFutures);
+	std::vector<std::vector<std::vector<SweepDetection>>> scleraGridDetections;
+
+	for (std::vector<std::future<std::vector<SweepDetection>>>& scleraDetectorFutures : scleraFutures)
+	{
+		scleraGridDetections.push_back(waitAll(threadPool, scleraDetectorFutures));
+	}
+
+	// end detector grids
+
+
+	// pair scores, [sclera detector][pupil grid point][sclera grid point][dataset]
+
+	std::vector<std::vector<std::vector<SweepDatasetScores>>> scores;
+	size_t datasetsCount = datasetNames.size();
+
+	for (const std::vector<std::vector<SweepDetection>>& scleraDetectorGridDetections : scleraGridDetections)
+	{
+		std::vector<std::future<std::vector<SweepDatasetScores>>> scoreFutures;
+
+		for (const std::vector<SweepDetection>& pupilDetections : pupilGridDetections)
+		{
+			scoreFutures.push_back(threadPool.enqueue([&eyes, &pupilDetections, &scleraDetectorGridDetections, datasetsCount]() {
+				return scorePupilGridPoint(eyes, pupilDetections, scleraDetectorGridDetections, datasetsCount);
+			}));
+		}
+
+		scores.push_back(waitAll(threadPool, scoreFutures));
+	}
+
+	// end pair scores
+
+	int64 sweepTicks = cv::getTickCount() - startTicks;
+
+
+	// report
+
+	std::ofstream fout(SWEEP_RESULTS_FILE_NAME);
+
+	if (!fout.is_open())
+	{
+		throw std::runtime_error("Can't write file: " + SWEEP_RESULTS_FILE_NAME);
+	}
+
+	fout << "dataset,sclera_detector,parameters,score,valid_eyes,eyes," <<
+		"pupil_threshold,pupil_erosion,pupil_dilation,sclera_threshold,sclera_erosion,sclera_dilation" << std::endl;
+
+	Parameters bestParameters = parameters;
+	bestParameters.applicationMode = APPLICATION_MODE;
+
+	for (size_t scleraDetectorIndex = 0; scleraDetectorIndex < scleraDetectors.size(); scleraDetectorIndex++)
+	{
+		const SweepDetector& scleraDetector = scleraDetectors[scleraDetectorIndex];
+
+		for (size_t datasetIndex = 0; datasetIndex <= datasetsCount; datasetIndex++)
+		{
+			std::string datasetName = datasetIndex < datasetsCount ? datasetNames[datasetIndex] : "all";
+			const SweepScore& currentScore = scores[scleraDetectorIndex][0][0][datasetIndex];
+			SweepBest best = findSweepBest(scores[scleraDetectorIndex], datasetIndex);
+
+			const CenterDetectorParameters& bestPupilParameters = pupilDetector.grid[best.pupilIndex];
+			const CenterDetectorParameters& bestScleraParameters = scleraDetector.grid[best.scleraIndex];
+
+			std::cout << "Sweep " << datasetName << ", pupil + " << scleraDetector.name << std::endl;
+			std::cout << "\tcurrent score : " << currentScore.getScore() << " (valid eyes " << currentScore.validEyesCount << "/" << currentScore.eyesCount << ")" << std::endl;
+			std::cout << "\tbest score : " << best.score.getScore() << " (valid eyes " << best.score.validEyesCount << "/" << best.score.eyesCount << ")" << std::endl;
+			std::cout << "\tbest pupil : " << formatSweepGridPoint(bestPupilParameters) << std::endl;
+			std::cout << "\tbest sclera : " << formatSweepGridPoint(bestScleraParameters) << std::endl;
+
+			writeSweepResultLine(fout, datasetName, scleraDetector.name, true, currentScore, pupilDetector.grid[0], scleraDetector.grid[0]);
+			writeSweepResultLine(fout, datasetName, scleraDetector.name, false, best.score, bestPupilParameters, bestScleraParameters);
+
+			// the pipeline pairs the pupil with the saturation sclera, the hue sclera only keeps its own best
+			if (datasetIndex == datasetsCount && scleraDetector.channel == SweepChannel::SATURATION)
+			{
+				bestParameters.pupil = bestPupilParameters;
+				bestParameters.saturationSclera = bestScleraParameters;
+			}
+			else if (datasetIndex == datasetsCount && scleraDetector.channel == SweepChannel::HUE)
+			{
+				bestParameters.hueSclera = bestScleraParameters;
+			}
+		}
+	}
+
+	// loadable with --config
+	cv::FileStorage fileStorage(SWEEP_PARAMETERS_FILE_NAME, cv::FileStorage::WRITE);
+	writeParameters(fileStorage, bestParameters);
+
+	size_t scleraGridPointsCount = 0;
+
+	for (const SweepDetector& scleraDetector : scleraDetectors)
+	{
+		scleraGridPointsCount += scleraDetector.grid.size();
+	}
+
+	std::cout << "Sweep images/eyes/threads : " << imagePaths.size() << "/" << eyes.size() << "/" << threadPool.getThreadsCount() << std::endl;
+	std::cout << "Sweep pupil/sclera grid points, pairs : " << pupilDetector.grid.size() << "/" << scleraGridPointsCount <<
+		", " << pupilDetector.grid.size() * scleraGridPointsCount << std::endl;
+	std::cout << "Sweep detection/total time, s : " << ticksToMilliseconds(detectionTicks) / 1000.0 << "/" << ticksToMilliseconds(sweepTicks) / 1000.0 << std::endl;
+
+	// end report
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "Cascades.hpp"
+#include "Constants.hpp"
+#include "Parameters.hpp"
+
+
+// Eye ROI cut and split once, every grid point starts from these planes.
+// Saturation and value are already equalized when the loaded detector parameters equalize.
+struct SweepEye
+{
+	int datasetIndex = 0;
+	int eyeWidth = 0;
+	cv::Mat hue;
+	cv::Mat saturation;
+	cv::Mat value;
+};
+
+
+struct SweepDetection
+{
+	cv::Point center;
+	bool isValid = false; // mask isn't empty and doesn't cover most of the eye
+};
+
+
+enum class SweepChannel
+{
+	HUE,
+	SATURATION,
+	VALUE
+};
+
+
+struct SweepDetector
+{
+	std::string name;
+	SweepChannel channel = SweepChannel::VALUE;
+	int thresholdType = 0;
+	std::vector<CenterDetectorParameters> grid; // the first grid point is the loaded parameters
+};
+
+
+// without ground truth a pupil/sclera pair is scored by how well both centers agree,
+// failed detections count as the full eye width
+struct SweepScore
+{
+	int eyesCount = 0;
+	int validEyesCount = 0;
+	double distanceSum = 0.0;
+
+	double getScore() const;
+};
+
+
+std::vector<CenterDetectorParameters> makeSweepGrid(const CenterDetectorParameters& baseParameters, const std::vector<int>& thresholds);
+std::vector<SweepDetection> evaluateSweepDetector(const std::vector<SweepEye>& eyes, const SweepDetector& detector, const CenterDetectorParameters& parameters);
+void runParameterSweep(const CascadeFile& faceCascadeFile, const CascadeFile& eyesCascadeFile, const Parameters& parameters);
@@ -0,0 +1,364 @@
+#include <iostream>
+#include <sstream>
+
+#include "Parameters.hpp"
+#include "EyeDetectors.hpp"
+
+
+Parameters::Parameters()
+{
+	hueSclera.threshold = HUE_SCLERA_THRESHOLD;
+	hueSclera.maxThreshold = HUE_SCLERA_MAX_THRESHOLD;
+	hueSclera.isErosionEnabled = IS_HUE_SCLERA_EROSION_ENABLED;
+	hueSclera.erosionIterationsCount = HUE_SCLERA_EROSION_ITERATIONS_COUNT;
+	hueSclera.isDilationEnabled = IS_HUE_SCLERA_DILATION_ENABLED;
+	hueSclera.dilationIterationsCount = HUE_SCLERA_DILATION_ITERATIONS_COUNT;
+
+	saturationSclera.isHistogramEqualizationEnabled = IS_SATURATION_SCLERA_HISTOGRAM_EQUALIZATION_ENABLED;
+	saturationSclera.threshold = SATURATION_SCLERA_THRESHOLD;
+	saturationSclera.maxThreshold = SATURATION_SCLERA_MAX_THRESHOLD;
+	saturationSclera.isErosionEnabled = IS_SATURATION_SCLERA_EROSION_ENABLED;
+	saturationSclera.erosionIterationsCount = SATURATION_SCLERA_EROSION_ITERATIONS_COUNT;
+	saturationSclera.isDilationEnabled = IS_SATURATION_SCLERA_DILATION_ENABLED;
+	saturationSclera.dilationIterationsCount = SATURATION_SCLERA_DILATION_ITERATIONS_COUNT;
+
+	pupil.isHistogramEqualizationEnabled = IS_PUPIL_HISTOGRAM_EQUALIZATION_ENABLED;
+	pupil.threshold = PUPIL_THRESHOLD;
+	pupil.maxThreshold = PUPIL_MAX_THRESHOLD;
+	pupil.isErosionEnabled = IS_PUPIL_EROSION_ENABLED;
+	pupil.erosionIterationsCount = PUPIL_EROSION_ITERATIONS_COUNT;
+	pupil.isDilationEnabled = IS_PUPIL_DILATION_ENABLED;
+	pupil.dilationIterationsCount = PUPIL_DILATION_ITERATIONS_COUNT;
+
+	resolveEyeDetectors(*this);
+	resolveProcessingModes(*this);
+}
+
+
+void resolveEyeDetectors(Parameters& parameters)
+{
+	parameters.eyeDetectors = getEyeDetectors(parameters.detectors);
+}
+
+
+void resolveProcessingModes(Parameters& parameters)
+{
+	ProcessingModes& modes = parameters.modes;
+	modes.isDebugActive = IS_DEBUG && !isVideoMode(parameters);
+	modes.isDebugVideoActive = IS_DEBUG_VIDEO_MODE && isVideoMode(parameters);
+
+	bool isDebugTapping = modes.isDebugActive || modes.isDebugVideoActive;
+	modes.isParallelProcessingActive = IS_PARALLEL_PROCESSING_ENABLED && !isDebugTapping;
+	modes.isFusedEyeProcessingActive = IS_FUSED_EYE_PROCESSING_ENABLED && !isDebugTapping;
+	modes.isMaskMorphologyActive = IS_MASK_MORPHOLOGY_ENABLED && !isDebugTapping;
+	modes.isVideoPipelineActive = IS_VIDEO_PIPELINE_ENABLED && !isDebugTapping;
+}
+
+
+// hue is circular and its detector doesn't equalize, so the hue sclera has no equalization parameter
+template <typename CenterDetectorParametersType, typename Visitor>
+void visitCenterDetectorParameters(const std::string& prefix, CenterDetectorParametersType& parameters, bool isHistogramEqualizationSupported, Visitor&& visitor)
+{
+	if (isHistogramEqualizationSupported)
+	{
+		visitor(prefix + "_histogram_equalization", parameters.isHistogramEqualizationEnabled);
+	}
+
+	visitor(prefix + "_threshold", parameters.threshold);
+	visitor(prefix + "_max_threshold", parameters.maxThreshold);
+	visitor(prefix + "_erosion", parameters.isErosionEnabled);
+	visitor(prefix + "_erosion_iterations", parameters.erosionIterationsCount);
+	visitor(prefix + "_dilation", parameters.isDilationEnabled);
+	visitor(prefix + "_dilation_iterations", parameters.dilationIterationsCount);
+}
+
+
+// single list of the parameter names, shared by reading, overriding and writing
+template <typename ParametersType, typename Visitor>
+void visitParameters(ParametersType& parameters, Visitor&& visitor)
+{
+	visitor("video_file", parameters.videoFilePath);
+	visitor("batch_detector_variants", parameters.batchDetectorVariants);
+
+	visitor("face_scale_factor", parameters.face.scaleFactor);
+	visitor("face_min_neighbours", parameters.face.minNeighbours);
+	visitor("face_min_relative_size", parameters.face.minRelativeSize);
+	visitor("face_max_relative_size", parameters.face.maxRelativeSize);
+	visitor("face_downscale", parameters.face.isDownscaleEnabled);
+	visitor("face_min_working_size", parameters.face.minFaceWorkingSize);
+	visitor("face_tracking", parameters.face.isTrackingEnabled);
+	visitor("face_tracking_search_expansion", parameters.face.trackingSearchExpansion);
+	visitor("face_tracking_redetection_interval", parameters.face.trackingRedetectionInterval);
+	visitor("face_redetection_match_overlap", parameters.face.redetectionMatchOverlap);
+	visitor("face_temporal_equalization", parameters.face.isTemporalEqualizationEnabled);
+	visitor("face_equalization_sampling_step", parameters.face.equalizationSamplingStep);
+	visitor("face_equalization_smoothing", parameters.face.equalizationSmoothing);
+	visitor("face_equalization_rebuild_drift", parameters.face.equalizationRebuildDrift);
+
+	visitor("eye_scale_factor", parameters.eye.scaleFactor);
+	visitor("eye_min_neighbours", parameters.eye.minNeighbours);
+	visitor("eye_min_relative_size", parameters.eye.minRelativeSize);
+	visitor("eye_max_relative_size", parameters.eye.maxRelativeSize);
+	visitor("eye_tracking_search_expansion", parameters.eye.trackingSearchExpansion);
+	visitor("eye_upper_face_search", parameters.eye.isUpperFaceSearchEnabled);
+	visitor("eye_pair_prediction", parameters.eye.isPairPredictionEnabled);
+	visitor("eye_pair_confirmation_interval", parameters.eye.pairConfirmationInterval);
+	visitor("eye_candidate_filtering", parameters.eye.isCandidateFilteringEnabled);
+	visitor("eye_candidate_max_overlap", parameters.eye.candidateMaxOverlap);
+	visitor("eye_pair_min_size_ratio", parameters.eye.pairMinSizeRatio);
+	visitor("eye_pair_max_vertical_offset", parameters.eye.pairMaxVerticalOffset);
+	visitor("eye_candidate_tracking_radius", parameters.eye.candidateTrackingRadius);
+	visitor("eye_cut_top_offset", parameters.eye.cutTopOffset);
+	visitor("eye_cut_bottom_offset", parameters.eye.cutBottomOffset);
+
+	visitor("sclera_detector", parameters.detectors.scleraDetector);
+	visitor("pupil_detector", parameters.detectors.pupilDetector);
+
+	visitCenterDetectorParameters("hue_sclera", parameters.hueSclera, false, visitor);
+	visitCenterDetectorParameters("saturation_sclera", parameters.saturationSclera, true, visitor);
+	visitCenterDetectorParameters("pupil", parameters.pupil, true, visitor);
+
+	visitor("pupil_refinement", parameters.pupilRefinement.isEnabled);
+	visitor("pupil_refinement_window_relative_size", parameters.pupilRefinement.windowRelativeSize);
+	visitor("pupil_refinement_max_window_radius", parameters.pupilRefinement.maxWindowRadius);
+	visitor("pupil_refinement_min_radius", parameters.pupilRefinement.minRadius);
+	visitor("pupil_refinement_min_gradient_ratio", parameters.pupilRefinement.minGradientRatio);
+}
+
+
+const std::vector<std::pair<std::string, ApplicationMode>> APPLICATION_MODE_NAMES = {
+	{ "test_image", ApplicationMode::TEST_IMAGE },
+	{ "video", ApplicationMode::VIDEO },
+	{ "batch", ApplicationMode::BATCH },
+	{ "benchmark", ApplicationMode::BENCHMARK },
+	{ "sweep", ApplicationMode::SWEEP },
+	{ "self_check", ApplicationMode::SELF_CHECK },
+	{ "headless_video", ApplicationMode::HEADLESS_VIDEO }
+};
+
+
+ApplicationMode parseApplicationMode(const std::string& modeName)
+{
+	for (const std::pair<std::string, ApplicationMode>& modeNamePair : APPLICATION_MODE_NAMES)
+	{
+		if (modeNamePair.first == modeName)
+		{
+			return modeNamePair.second;
+		}
+	}
+
+	throw std::runtime_error("Unknown application mode: " + modeName);
+}
+
+
+std::string getApplicationModeName(ApplicationMode applicationMode)
+{
+	for (const std::pair<std::string, ApplicationMode>& modeNamePair : APPLICATION_MODE_NAMES)
+	{
+		if (modeNamePair.second == applicationMode)
+		{
+			return modeNamePair.first;
+		}
+	}
+
+	return "";
+}
+
+
+bool isVideoMode(const Parameters& parameters)
+{
+	return parameters.applicationMode == ApplicationMode::VIDEO || parameters.applicationMode == ApplicationMode::HEADLESS_VIDEO;
+}
+
+
+void readParameterValue(const cv::FileNode& node, bool& value)
+{
+	value = (int)node != 0;
+}
+
+
+void readParameterValue(const cv::FileNode& node, int& value)
+{
+	value = (int)node;
+}
+
+
+void readParameterValue(const cv::FileNode& node, double& value)
+{
+	value = (double)node;
+}
+
+
+void readParameterValue(const cv::FileNode& node, std::string& value)
+{
+	value = (std::string)node;
+}
+
+
+void readParameters(const cv::FileNode& node, Parameters& parameters)
+{
+	if (!node["mode"].empty())
+	{
+		parameters.applicationMode = parseApplicationMode((std::string)node["mode"]);
+		resolveProcessingModes(parameters);
+	}
+
+	visitParameters(parameters, [&node](const std::string& name, auto& value) {
+		cv::FileNode valueNode = node[name];
+
+		if (!valueNode.empty())
+		{
+			readParameterValue(valueNode, value);
+		}
+	});
+
+	resolveEyeDetectors(parameters);
+}
+
+
+void parseParameterValue(const std::string& text, bool& value)
+{
+	if (text == "true" || text == "1")
+	{
+		value = true;
+	}
+	else if (text == "false" || text == "0")
+	{
+		value = false;
+	}
+	else
+	{
+		throw std::runtime_error("Bad boolean value: " + text);
+	}
+}
+
+
+void parseParameterValue(const std::string& text, std::string& value)
+{
+	value = text;
+}
+
+
+template <typename T>
+void parseParameterValue(const std::string& text, T& value)
+{
+	std::istringstream textStream(text);
+
+	if (!(textStream >> value) || !textStream.eof())
+	{
+		throw std::runtime_error("Bad numeric value: " + text);
+	}
+}
+
+
+void setParameter(Parameters& parameters, const std::string& name, const std::string& value)
+{
+	if (name == "mode")
+	{
+		parameters.applicationMode = parseApplicationMode(value);
+		resolveProcessingModes(parameters);
+		return;
+	}
+
+	bool isFound = false;
+
+	visitParameters(parameters, [&name, &value, &isFound](const std::string& parameterName, auto& parameterValue) {
+		if (parameterName == name)
+		{
+			parseParameterValue(value, parameterValue);
+			isFound = true;
+		}
+	});
+
+	if (!isFound)
+	{
+		throw std::runtime_error("Unknown parameter: " + name);
+	}
+
+	resolveEyeDetectors(parameters);
+}
+
+
+Parameters loadParameters(int argc, const char** argv)
+{
+	Parameters parameters;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+
+		if (argument == "--config")
+		{
+			if (i + 1 >= argc)
+			{
+				throw std::runtime_error("Missing config file path");
+			}
+
+			std::string configPath = argv[++i];
+			cv::FileStorage fileStorage(configPath, cv::FileStorage::READ);
+
+			if (!fileStorage.isOpened())
+			{
+				throw std::runtime_error("Can't read config file: " + configPath);
+			}
+
+			readParameters(fileStorage.root(), parameters);
+			continue;
+		}
+
+		size_t separatorIndex = argument.find('=');
+
+		if (argument.rfind("--", 0) != 0 || separatorIndex == std::string::npos)
+		{
+			throw std::runtime_error("Bad argument: " + argument);
+		}
+
+		setParameter(parameters, argument.substr(2, separatorIndex - 2), argument.substr(separatorIndex + 1));
+	}
+
+	return parameters;
+}
+
+
+void writeParameterValue(cv::FileStorage& fileStorage, const std::string& name, bool value)
+{
+	fileStorage.write(name, value ? 1 : 0);
+}
+
+
+void writeParameterValue(cv::FileStorage& fileStorage, const std::string& name, int value)
+{
+	fileStorage.write(name, value);
+}
+
+
+void writeParameterValue(cv::FileStorage& fileStorage, const std::string& name, double value)
+{
+	fileStorage.write(name, value);
+}
+
+
+void writeParameterValue(cv::FileStorage& fileStorage, const std::string& name, const std::string& value)
+{
+	fileStorage.write(name, value);
+}
+
+
+void writeParameters(cv::FileStorage& fileStorage, const Parameters& parameters)
+{
+	fileStorage.write("mode", getApplicationModeName(parameters.applicationMode));
+
+	visitParameters(parameters, [&fileStorage](const std::string& name, const auto& value) {
+		writeParameterValue(fileStorage, name, value);
+	});
+}
+
+
+void printParameters(const Parameters& parameters)
+{
+	std::cout << "mode : " << getApplicationModeName(parameters.applicationMode) << std::endl;
+
+	visitParameters(parameters, [](const std::string& name, const auto& value) {
+		std::cout << name << " : " << value << std::endl;
+	});
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <string>
+
+#include <opencv2/core.hpp>
+
+#include "Constants.hpp"
+
+
+// Tuning parameters, loaded once at startup and passed down by const reference.
+// Constants.hpp values are the defaults, build switches (debug, parallel, fused, ...) stay compile-time
+// and the processing modes are derived from them and the application mode.
+
+struct FaceDetectionParameters
+{
+	double scaleFactor = FACE_SCALE_FACTOR;
+	int minNeighbours = FACE_MIN_NEIGHBOURS;
+	int minRelativeSize = MIN_FACE_RELATIVE_SIZE;
+	int maxRelativeSize = MAX_FACE_RELATIVE_SIZE;
+	bool isDownscaleEnabled = IS_FACE_DETECTION_DOWNSCALE_ENABLED;
+	int minFaceWorkingSize = FACE_DETECTION_MIN_FACE_WORKING_SIZE;
+	bool isTrackingEnabled = IS_FACE_TRACKING_ENABLED;
+	int trackingSearchExpansion = FACE_TRACKING_SEARCH_EXPANSION;
+	int trackingRedetectionInterval = FACE_TRACKING_REDETECTION_INTERVAL;
+	double redetectionMatchOverlap = FACE_REDETECTION_MATCH_OVERLAP;
+	bool isTemporalEqualizationEnabled = IS_TEMPORAL_EQUALIZATION_ENABLED;
+	int equalizationSamplingStep = EQUALIZATION_SAMPLING_STEP;
+	double equalizationSmoothing = EQUALIZATION_SMOOTHING;
+	double equalizationRebuildDrift = EQUALIZATION_REBUILD_DRIFT;
+};
+
+
+struct EyeDetectionParameters
+{
+	double scaleFactor = EYE_SCALE_FACTOR;
+	int minNeighbours = EYE_MIN_NEIGHBOURS;
+	int minRelativeSize = MIN_EYE_RELATIVE_SIZE;
+	int maxRelativeSize = MAX_EYE_RELATIVE_SIZE;
+	int trackingSearchExpansion = EYE_TRACKING_SEARCH_EXPANSION;
+	bool isUpperFaceSearchEnabled = IS_EYE_UPPER_FACE_SEARCH_ENABLED;
+	bool isPairPredictionEnabled = IS_EYE_PAIR_PREDICTION_ENABLED;
+	int pairConfirmationInterval = EYE_PAIR_CONFIRMATION_INTERVAL;
+	bool isCandidateFilteringEnabled = IS_EYE_CANDIDATE_FILTERING_ENABLED;
+	double candidateMaxOverlap = EYE_CANDIDATE_MAX_OVERLAP;
+	double pairMinSizeRatio = EYE_PAIR_MIN_SIZE_RATIO;
+	int pairMaxVerticalOffset = EYE_PAIR_MAX_VERTICAL_OFFSET;
+	int candidateTrackingRadius = EYE_CANDIDATE_TRACKING_RADIUS;
+	int cutTopOffset = EYE_CUT_TOP_OFFSET;
+	int cutBottomOffset = EYE_CUT_BOTTOM_OFFSET;
+};
+
+
+// threshold and morphology of a single channel sclera or pupil detector
+struct CenterDetectorParameters
+{
+	bool isHistogramEqualizationEnabled = false;
+	int threshold = 0;
+	int maxThreshold = 255;
+	bool isErosionEnabled = false;
+	int erosionIterationsCount = 0;
+	bool isDilationEnabled = false;
+	int dilationIterationsCount = 0;
+};
+
+
+// sclera and pupil detectors by name, see EyeDetectors.hpp
+struct EyeDetectorParameters
+{
+	std::string scleraDetector = SCLERA_DETECTOR_NAME;
+	std::string pupilDetector = PUPIL_DETECTOR_NAME;
+};
+
+
+struct CenterDetector;
+
+
+// registry entries of the detector names, resolved once when the names are set, see EyeDetectors.hpp
+struct EyeDetectors
+{
+	const CenterDetector* scleraDetector = nullptr;
+	const CenterDetector* pupilDetector = nullptr;
+	bool isFused = false; // saturation sclera and value pupil, the pair the fused kernel implements
+};
+
+
+struct PupilRefinementParameters
+{
+	bool isEnabled = IS_PUPIL_REFINEMENT_ENABLED;
+	int windowRelativeSize = PUPIL_REFINEMENT_WINDOW_RELATIVE_SIZE;
+	int maxWindowRadius = PUPIL_REFINEMENT_MAX_WINDOW_RADIUS;
+	int minRadius = PUPIL_REFINEMENT_MIN_RADIUS;
+	double minGradientRatio = PUPIL_REFINEMENT_MIN_GRADIENT_RATIO;
+};
+
+
+// Not configurable, resolved from the application mode by resolveProcessingModes.
+// Debug taps need the intermediate images on the calling thread, so the fast paths are off while they run.
+struct ProcessingModes
+{
+	bool isDebugActive = false; // every debug tap, image modes only
+	bool isDebugVideoActive = false; // key debug taps, video modes only
+	bool isParallelProcessingActive = false;
+	bool isFusedEyeProcessingActive = false;
+	bool isMaskMorphologyActive = false;
+	bool isVideoPipelineActive = false;
+};
+
+
+struct Parameters
+{
+	ApplicationMode applicationMode = APPLICATION_MODE;
+	std::string videoFilePath = HEADLESS_VIDEO_FILE_PATH;
+	std::string batchDetectorVariants = BATCH_DETECTOR_VARIANTS;
+	FaceDetectionParameters face;
+	EyeDetectionParameters eye;
+	EyeDetectorParameters detectors;
+	EyeDetectors eyeDetectors; // resolved from detectors
+	CenterDetectorParameters hueSclera;
+	CenterDetectorParameters saturationSclera;
+	CenterDetectorParameters pupil;
+	PupilRefinementParameters pupilRefinement;
+	ProcessingModes modes; // resolved from applicationMode
+
+	Parameters();
+};
+
+
+// Every parameter has a flat name, e.g. face_scale_factor or pupil_threshold.
+// The config file is any FileStorage format (YAML, XML, JSON) with those names as top-level keys.
+// Command line: --config <file> loads a file, --<name>=<value> overrides a single parameter,
+// later arguments win, unknown detector names are rejected when set. The application mode is set with --mode=test_image|video|batch|benchmark|sweep|self_check|headless_video.
+Parameters loadParameters(int argc, const char** argv);
+void readParameters(const cv::FileNode& node, Parameters& parameters);
+void setParameter(Parameters& parameters, const std::string& name, const std::string& value);
+// after detector names are changed directly, throws for unknown names
+void resolveEyeDetectors(Parameters& parameters);
+// after the application mode is changed directly
+void resolveProcessingModes(Parameters& parameters);
+void writeParameters(cv::FileStorage& fileStorage, const Parameters& parameters);
+void printParameters(const Parameters& parameters);
+// video and headless video, frames come from a stream
+bool isVideoMode(const Parameters& parameters);
@@ -1,7 +1,10 @@
 #pragma once
 
-#include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 
+#include "CenterOfMass.hpp"
+#include "Parameters.hpp"
 
-cv::Point detectPupilCenterValue(cv::Mat processingImage, int eyeIndex);
+
+// threshold and morphology run in a single pass when isMaskMorphologyActive, as separate tapped steps otherwise
+DetectedCenter detectPupilCenterValue(cv::Mat processingImage, int eyeIndex, const CenterDetectorParameters& parameters, bool isMaskMorphologyActive);
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <cmath>
+
+#include "PupilRefinement.hpp"
+#include "FrameArena.hpp"
+
+
+// bilinear vote, parts outside the grid are dropped
+void splatPupilVote(cv::Mat& votes, float x, float y, float weight)
+{
+	int x0 = (int)std::floor(x);
+	int y0 = (int)std::floor(y);
+
+	if (x0 < 0 || y0 < 0 || x0 + 1 >= votes.cols || y0 + 1 >= votes.rows)
+	{
+		return;
+	}
+
+	float fx = x - x0;
+	float fy = y - y0;
+	float* topPtr = votes.ptr<float>(y0) + x0;
+	float* bottomPtr = votes.ptr<float>(y0 + 1) + x0;
+
+	topPtr[0] += weight * (1 - fx) * (1 - fy);
+	topPtr[1] += weight * fx * (1 - fy);
+	bottomPtr[0] += weight * (1 - fx) * fy;
+	bottomPtr[1] += weight * fx * fy;
+}
+
+
+PupilRefinement refinePupilCenter(const cv::Mat& eyeImage, cv::Point coarseCenter, const PupilRefinementParameters& parameters)
+{
+	CV_Assert(eyeImage.type() == CV_8UC3);
+
+	int64 startTicks = cv::getTickCount();
+
+	PupilRefinement refinement;
+	refinement.center = cv::Point2f((float)coarseCenter.x, (float)coarseCenter.y);
+
+	int radius = std::min(std::max(eyeImage.cols * parameters.windowRelativeSize / 100, parameters.minRadius + 1), parameters.maxWindowRadius);
+
+	// one more pixel around the window for the gradients
+	cv::Rect windowRect = cv::Rect(coarseCenter.x - radius - 1, coarseCenter.y - radius - 1, 2 * radius + 3, 2 * radius + 3) &
+		cv::Rect(0, 0, eyeImage.cols, eyeImage.rows);
+
+	if (windowRect.width < 5 || windowRect.height < 5)
+	{
+		refinement.ticks = cv::getTickCount() - startTicks;
+		return refinement;
+	}
+
+	FrameArenaScope arenaScope;
+	int rows = windowRect.height;
+	int cols = windowRect.width;
+
+
+	// value plane of the window
+
+	cv::Mat value = arenaScope.acquire(rows, cols, CV_8UC1);
+
+	for (int i = 0; i < rows; i++)
+	{
+		const uint8_t* sourcePtr = eyeImage.ptr<uint8_t>(windowRect.y + i) + windowRect.x * 3;
+		uint8_t* valuePtr = value.ptr<uint8_t>(i);
+
+		for (int j = 0; j < cols; j++)
+		{
+			valuePtr[j] = std::max(std::max(sourcePtr[j * 3], sourcePtr[j * 3 + 1]), sourcePtr[j * 3 + 2]);
+		}
+	}
+
+	// end value plane
+
+
+	// gradients of the inner pixels, 3x3 Sobel
+
+	cv::Mat gradients = arenaScope.acquire(rows, cols, CV_32FC3); // x, y, magnitude
+	float maxMagnitude = 0;
+
+	for (int i = 1; i < rows - 1; i++)
+	{
+		const uint8_t* topPtr = value.ptr<uint8_t>(i - 1);
+		const uint8_t* middlePtr = value.ptr<uint8_t>(i);
+		const uint8_t* bottomPtr = value.ptr<uint8_t>(i + 1);
+		float* gradientPtr = gradients.ptr<float>(i);
+
+		for (int j = 1; j < cols - 1; j++)
+		{
+			float dx = (float)(topPtr[j + 1] - topPtr[j - 1] + 2 * (middlePtr[j + 1] - middlePtr[j - 1]) + bottomPtr[j + 1] - bottomPtr[j - 1]);
+			float dy = (float)(bottomPtr[j - 1] - topPtr[j - 1] + 2 * (bottomPtr[j] - topPtr[j]) + bottomPtr[j + 1] - topPtr[j + 1]);
+			float magnitude = std::sqrt(dx * dx + dy * dy);
+
+			gradientPtr[j * 3] = dx;
+			gradientPtr[j * 3 + 1] = dy;
+			gradientPtr[j * 3 + 2] = magnitude;
+			maxMagnitude = std::max(maxMagnitude, magnitude);
+		}
+	}
+
+	// end gradients
+
+
+	// radial symmetry vote
+
+	if (maxMagnitude > 0)
+	{
+		cv::Mat votes = arenaScope.acquire(rows, cols, CV_32FC1);
+		std::fill(votes.ptr<float>(), votes.ptr<float>() + votes.total(), 0.0f);
+
+		float minMagnitude = (float)(maxMagnitude * parameters.minGradientRatio);
+
+		for (int i = 1; i < rows - 1; i++)
+		{
+			const float* gradientPtr = gradients.ptr<float>(i);
+
+			for (int j = 1; j < cols - 1; j++)
+			{
+				float magnitude = gradientPtr[j * 3 + 2];
+
+				if (magnitude < minMagnitude || magnitude == 0)
+				{
+					continue;
+				}
+
+				float directionX = gradientPtr[j * 3] / magnitude;
+				float directionY = gradientPtr[j * 3 + 1] / magnitude;
+
+				for (int r = parameters.minRadius; r <= radius; r++)
+				{
+					splatPupilVote(votes, j - r * directionX, i - r * directionY, magnitude);
+				}
+			}
+		}
+
+		cv::Point peak;
+		double peakVotes = 0;
+		cv::minMaxLoc(votes, nullptr, &peakVotes, nullptr, &peak);
+
+		if (peakVotes > 0)
+		{
+			double votesSum = 0;
+			double xSum = 0;
+			double ySum = 0;
+
+			for (int i = std::max(peak.y - 1, 0); i <= std::min(peak.y + 1, rows - 1); i++)
+			{
+				const float* votesPtr = votes.ptr<float>(i);
+
+				for (int j = std::max(peak.x - 1, 0); j <= std::min(peak.x + 1, cols - 1); j++)
+				{
+					votesSum += votesPtr[j];
+					xSum += votesPtr[j] * j;
+					ySum += votesPtr[j] * i;
+				}
+			}
+
+			refinement.center = cv::Point2f((float)(windowRect.x + xSum / votesSum), (float)(windowRect.y + ySum / votesSum));
+			refinement.isRefined = true;
+		}
+	}
+
+	// end radial symmetry vote
+
+	refinement.ticks = cv::getTickCount() - startTicks;
+
+	return refinement;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include "Constants.hpp"
+#include "Parameters.hpp"
+
+
+struct PupilRefinement
+{
+	cv::Point2f center;
+	bool isRefined = false; // false when the window has no edges to vote, the center is the coarse one
+	int64 ticks = 0;
+};
+
+
+// Sub-pixel pupil center from a radial symmetry vote around the coarse center.
+// The value plane (max of B, G, R) is computed only inside the window, every gradient stronger than
+// minGradientRatio of the strongest one votes opposite to its direction, towards the dark side, at every radius
+// from minRadius to the window radius. Votes are splatted bilinearly and the center is the vote centroid
+// around the peak, so a round dark blob wins over eyelash and shadow edges that don't agree on a center.
+// The window radius is windowRelativeSize percent of the eye width capped at maxWindowRadius, which bounds the cost.
+PupilRefinement refinePupilCenter(const cv::Mat& eyeImage, cv::Point coarseCenter, const PupilRefinementParameters& parameters);
@@ -0,0 +1,168 @@
+#include <iostream>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include "ResultWriter.hpp"
+#include "Utils.hpp"
+
+
+ResultWriter::ResultWriter(size_t queueCapacity) :
+	images(queueCapacity),
+	writtenCount(0),
+	failedCount(0)
+{
+	writer = std::thread(&ResultWriter::writerLoop, this);
+}
+
+
+ResultWriter::~ResultWriter()
+{
+	finish();
+}
+
+
+void ResultWriter::write(const std::string& filePath, const cv::Mat& image)
+{
+	ResultImage resultImage;
+	resultImage.filePath = filePath;
+	resultImage.image = image.clone();
+
+	images.push(std::move(resultImage), std::chrono::milliseconds(RESULT_WRITER_MAX_DELAY_MS));
+}
+
+
+void ResultWriter::finish()
+{
+	images.close();
+
+	if (writer.joinable())
+	{
+		writer.join();
+	}
+}
+
+
+size_t ResultWriter::getWrittenCount() const
+{
+	return writtenCount;
+}
+
+
+size_t ResultWriter::getFailedCount() const
+{
+	return failedCount;
+}
+
+
+size_t ResultWriter::getDroppedCount() const
+{
+	return images.getDroppedCount();
+}
+
+
+size_t ResultWriter::getDelayedCount() const
+{
+	return images.getDelayedCount();
+}
+
+
+void ResultWriter::writerLoop()
+{
+	ResultImage resultImage;
+
+	while (images.pop(resultImage))
+	{
+		// the writer thread must not die on a single bad image
+		bool isWritten = false;
+
+		try
+		{
+			isWritten = encodeResultImage(resultImage.filePath, resultImage.image);
+		}
+		catch (const cv::Exception&)
+		{
+		}
+
+		if (isWritten)
+		{
+			writtenCount++;
+		}
+		else
+		{
+			failedCount++;
+		}
+	}
+}
+
+
+std::string getResultImageExtension(const cv::Mat& image)
+{
+	switch (RESULT_IMAGE_ENCODER)
+	{
+	case ResultImageEncoder::RAW:
+		return image.channels() == 1 ? "pgm" : "ppm";
+	case ResultImageEncoder::JPEG:
+		return "jpg";
+	case ResultImageEncoder::PNG:
+	default:
+		return "png";
+	}
+}
+
+
+std::vector<int> getResultImageEncoderParams()
+{
+	switch (RESULT_IMAGE_ENCODER)
+	{
+	case ResultImageEncoder::RAW:
+		return { cv::IMWRITE_PXM_BINARY, 1 };
+	case ResultImageEncoder::JPEG:
+		return { cv::IMWRITE_JPEG_QUALITY, RESULT_IMAGE_JPEG_QUALITY };
+	case ResultImageEncoder::PNG:
+	default:
+		return { cv::IMWRITE_PNG_COMPRESSION, RESULT_IMAGE_PNG_COMPRESSION };
+	}
+}
+
+
+bool encodeResultImage(const std::string& filePath, const cv::Mat& image)
+{
+	return cv::imwrite(filePath, image, getResultImageEncoderParams());
+}
+
+
+ResultWriter& getResultWriter()
+{
+	static ResultWriter resultWriter(RESULT_WRITER_QUEUE_CAPACITY);
+	return resultWriter;
+}
+
+
+// waits for the queued images and reports the writer statistics
+void finishResultWriter()
+{
+	if (!IS_RESULT_WRITER_ASYNC || !isResultImageWriteEnabled())
+	{
+		return;
+	}
+
+	ResultWriter& resultWriter = getResultWriter();
+	resultWriter.finish();
+
+	std::cout << "Result images written/failed/dropped/delayed : " <<
+		resultWriter.getWrittenCount() << "/" << resultWriter.getFailedCount() << "/" <<
+		resultWriter.getDroppedCount() << "/" << resultWriter.getDelayedCount() << std::endl;
+}
+
+
+ResultWriterScope::~ResultWriterScope()
+{
+	try
+	{
+		finishResultWriter();
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << e.what() << std::endl;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "BoundedQueue.hpp"
+#include "Constants.hpp"
+
+
+struct ResultImage
+{
+	std::string filePath;
+	cv::Mat image;
+};
+
+
+// Encodes and writes result images on a background thread, so processing doesn't wait for the disk.
+class ResultWriter
+{
+public:
+	explicit ResultWriter(size_t queueCapacity);
+	~ResultWriter();
+
+	ResultWriter(const ResultWriter&) = delete;
+	ResultWriter& operator=(const ResultWriter&) = delete;
+
+	// the image is copied, the caller may reuse it right away
+	void write(const std::string& filePath, const cv::Mat& image);
+	// writes the queued images and stops the writer thread
+	void finish();
+
+	size_t getWrittenCount() const;
+	size_t getFailedCount() const;
+	size_t getDroppedCount() const;
+	size_t getDelayedCount() const;
+
+private:
+	void writerLoop();
+
+	BoundedQueue<ResultImage> images;
+	std::thread writer;
+	std::atomic<size_t> writtenCount;
+	std::atomic<size_t> failedCount;
+};
+
+
+std::string getResultImageExtension(const cv::Mat& image);
+std::vector<int> getResultImageEncoderParams();
+bool encodeResultImage(const std::string& filePath, const cv::Mat& image);
+ResultWriter& getResultWriter();
+void finishResultWriter();
+
+
+// Calls finishResultWriter on scope exit, so early returns and exceptions don't drop queued images.
+class ResultWriterScope
+{
+public:
+	ResultWriterScope() = default;
+	~ResultWriterScope();
+
+	ResultWriterScope(const ResultWriterScope&) = delete;
+	ResultWriterScope& operator=(const ResultWriterScope&) = delete;
+};
@@ -1,140 +1,82 @@
 #include "ScleraProcessing.hpp"
 #include "Constants.hpp"
 #include "CvUtils.hpp"
-#include "Utils.hpp"
+#include "DebugTap.hpp"
+#include "MaskMorphology.hpp"
 
 
-cv::Point detectScleraCenterHue(cv::Mat processingImage, int eyeIndex)
+DebugWindowLayout getScleraHueDebugWindowLayout(int eyeIndex, int row)
 {
-	std::stringstream windowNameStringStream;
-	std::string windowName;
+	return makeDebugWindowLayout(500 + eyeIndex * 200, 50 + row * 100);
+}
 
-	int windowOffsetX = 500 + (int)eyeIndex * 200;
-	int windowOffsetY = 50 + (int)eyeIndex * 0;
 
+DetectedCenter detectScleraCenterHue(cv::Mat processingImage, int eyeIndex, const CenterDetectorParameters& parameters, bool isMaskMorphologyActive)
+{
 	// original image
 
-	if (IS_DEBUG || (IS_VIDEO_MODE && IS_DEBUG_VIDEO_MODE))
-	{
-		windowNameStringStream << "Sclera " << eyeIndex << " Hue channel";
-		windowName = windowNameStringStream.str();
-		cv::imshow(windowName, processingImage);
-		cv::moveWindow(windowName, windowOffsetX, windowOffsetY);
-		windowNameStringStream.str("");
-
-		writeResult(windowName, processingImage);
-
-		windowOffsetY += 100;
-	}
+	KeyDebugTap::tap("Sclera hue channel", eyeIndex, processingImage, getScleraHueDebugWindowLayout(eyeIndex, 0));
 
 	// end original image
 
 
 	// threshold
 
-	cv::threshold(processingImage, processingImage, HUE_SCLERA_THRESHOLD, HUE_SCLERA_MAX_THRESHOLD, cv::THRESH_BINARY);
-
-	if (IS_DEBUG || (IS_VIDEO_MODE && IS_DEBUG_VIDEO_MODE))
+	if (isMaskMorphologyActive)
 	{
-		windowNameStringStream << "Sclera " << eyeIndex << " threshold";
-		windowName = windowNameStringStream.str();
-		cv::imshow(windowName, processingImage);
-		cv::moveWindow(windowName, windowOffsetX, windowOffsetY);
-		windowNameStringStream.str("");
-
-		writeResult(windowName, processingImage);
-
-		windowOffsetY += 100;
+		// erosion and dilation are folded into the same passes
+		thresholdMaskMorphology(processingImage, processingImage, parameters, cv::THRESH_BINARY);
 	}
+	else
+	{
+		cv::threshold(processingImage, processingImage, parameters.threshold, parameters.maxThreshold, cv::THRESH_BINARY);
+	}
+
+	KeyDebugTap::tap("Sclera hue threshold", eyeIndex, processingImage, getScleraHueDebugWindowLayout(eyeIndex, 1));
 
 	// end threshold
 
 
 	// start erode
-	if (IS_HUE_SCLERA_EROSION_ENABLED)
+	if (!isMaskMorphologyActive && parameters.isErosionEnabled)
 	{
 		const cv::Mat kernel = cv::Mat();
 		const cv::Point anchor = cv::Point(-1, -1);
-		cv::erode(processingImage, processingImage, kernel, anchor, HUE_SCLERA_EROSION_ITERATIONS_COUNT);
+		cv::erode(processingImage, processingImage, kernel, anchor, parameters.erosionIterationsCount);
 
-		if (IS_DEBUG)
-		{
-			windowNameStringStream << "Sclera " << eyeIndex << " erode";
-			windowName = windowNameStringStream.str();
-			cv::imshow(windowName, processingImage);
-			cv::moveWindow(windowName, windowOffsetX, windowOffsetY);
-			windowNameStringStream.str("");
-
-			writeResult(windowName, processingImage);
-
-			windowOffsetY += 100;
-		}
+		DebugTap::tap("Sclera hue erode", eyeIndex, processingImage, getScleraHueDebugWindowLayout(eyeIndex, 2));
 	}
 	// end erode
 
 
 	// start dilate
-	if (IS_HUE_SCLERA_DILATION_ENABLED)
+	if (!isMaskMorphologyActive && parameters.isDilationEnabled)
 	{
 		const cv::Mat kernel = cv::Mat();
 		const cv::Point anchor = cv::Point(-1, -1);
-		cv::dilate(processingImage, processingImage, kernel, anchor, HUE_SCLERA_DILATION_ITERATIONS_COUNT);
-
-		if (IS_DEBUG)
-		{
-			windowNameStringStream << "Sclera " << eyeIndex << " dilate";
-			windowName = windowNameStringStream.str();
-			cv::imshow(windowName, processingImage);
-			cv::moveWindow(windowName, windowOffsetX, windowOffsetY);
-			windowNameStringStream.str("");
+		cv::dilate(processingImage, processingImage, kernel, anchor, parameters.dilationIterationsCount);
 
-			writeResult(windowName, processingImage);
-
-			windowOffsetY += 100;
-		}
+		DebugTap::tap("Sclera hue dilate", eyeIndex, processingImage, getScleraHueDebugWindowLayout(eyeIndex, 3));
 	}
 	// end dilate
 
 
 	// center of mass
 
-	// TODO: check incorrect result by (0, 0)
-	cv::Point center = getCenterOfMass8UC1(processingImage);
+	CenterOfMass centerOfMass = getCenterOfMass8UC1(processingImage);
+	// empty mask, fall back to the image center and report it as not found
+	DetectedCenter detectedCenter = getDetectedCenter(centerOfMass, processingImage.size());
 
 	// end center of mass
 
 
 	// draw center
 
-	if (IS_DEBUG || (IS_VIDEO_MODE && IS_DEBUG_VIDEO_MODE))
-	{
-		int rows = processingImage.rows;
-		int cols = processingImage.cols;
-		
-		int markerSize = std::min(rows, cols);
-		int markerThickness = std::max(markerSize / 100, 1);
-
-		cv::Mat coloredImage = cv::Mat(rows, cols, CV_8UC3);
-
-		cv::cvtColor(processingImage, coloredImage, cv::COLOR_GRAY2BGR);
-
-		if (IS_DRAWING)
-		{
-			cv::drawMarker(coloredImage, center, CV_RGB(255, 0, 0), cv::MARKER_CROSS, markerSize, markerThickness, cv::LINE_8);
-		}
-
-		windowNameStringStream << "Sclera " << eyeIndex << " center";
-		windowName = windowNameStringStream.str();
-		cv::imshow(windowName, coloredImage);
-		cv::moveWindow(windowName, windowOffsetX, windowOffsetY);
-		windowNameStringStream.str("");
-
-		writeResult(windowName, coloredImage);
-
-		windowOffsetY += 100;
-	}
+	KeyDebugTap::tapLazy("Sclera hue center", eyeIndex, [&]() {
+		return drawCenterOfMassDebugImage(processingImage, detectedCenter.center);
+	}, getScleraHueDebugWindowLayout(eyeIndex, 4));
 
 	// end draw center
 
-	return center;
+	return detectedCenter;
 }
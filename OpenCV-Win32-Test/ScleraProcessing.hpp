@@ -1,7 +1,9 @@
 #pragma once
 
-#include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 
+#include "CenterOfMass.hpp"
+#include "Parameters.hpp"
 
-cv::Point detectScleraCenterHue(cv::Mat processingImage, int eyeIndex);
+
+DetectedCenter detectScleraCenterHue(cv::Mat processingImage, int eyeIndex, const CenterDetectorParameters& parameters, bool isMaskMorphologyActive);
@@ -1,53 +1,32 @@
 #include "ScleraProcessingNew.hpp"
 #include "Constants.hpp"
 #include "CvUtils.hpp"
-#include "Utils.hpp"
+#include "DebugTap.hpp"
+#include "MaskMorphology.hpp"
 
 
-cv::Point detectScleraCenterSaturation(cv::Mat processingImage, int eyeIndex)
+DebugWindowLayout getScleraSaturationDebugWindowLayout(int eyeIndex, int row)
 {
-	std::stringstream windowNameStringStream;
-	std::string windowName;
+	return makeDebugWindowLayout(500 + eyeIndex * 200, 50 + row * 100);
+}
 
-	int windowOffsetX = 500 + (int)eyeIndex * 200;
-	int windowOffsetY = 50 + (int)eyeIndex * 0;
 
+DetectedCenter detectScleraCenterSaturation(cv::Mat processingImage, int eyeIndex, const CenterDetectorParameters& parameters, bool isMaskMorphologyActive)
+{
 	// original image
 
-	if (IS_DEBUG || (IS_VIDEO_MODE && IS_DEBUG_VIDEO_MODE))
-	{
-		windowNameStringStream << "Sclera " << eyeIndex << " Saturation channel";
-		windowName = windowNameStringStream.str();
-		cv::imshow(windowName, processingImage);
-		cv::moveWindow(windowName, windowOffsetX, windowOffsetY);
-		windowNameStringStream.str("");
-
-		writeResult(windowName, processingImage);
-
-		windowOffsetY += 100;
-	}
+	KeyDebugTap::tap("Sclera saturation channel", eyeIndex, processingImage, getScleraSaturationDebugWindowLayout(eyeIndex, 0));
 
 	// end original image
 
 
 	// equalize hist
 
-	if (IS_SATURATION_SCLERA_HISTOGRAM_EQUALIZATION_ENABLED)
+	if (parameters.isHistogramEqualizationEnabled)
 	{
 		cv::equalizeHist(processingImage, processingImage);
 
-		if (IS_DEBUG)
-		{
-			windowNameStringStream << "Sclera " << eyeIndex << " equlize hist";
-			windowName = windowNameStringStream.str();
-			cv::imshow(windowName, processingImage);
-			cv::moveWindow(windowName, windowOffsetX, windowOffsetY);
-			windowNameStringStream.str("");
-
-			writeResult(windowName, processingImage);
-
-			windowOffsetY += 100;
-		}
+		DebugTap::tap("Sclera saturation equalize hist", eyeIndex, processingImage, getScleraSaturationDebugWindowLayout(eyeIndex, 1));
 	}
 
 	// end equalize hist
@@ -55,109 +34,61 @@ cv::Point detectScleraCenterSaturation(cv::Mat processingImage, int eyeIndex)
 
 	// threshold
 
-	cv::threshold(processingImage, processingImage, SATURATION_SCLERA_THRESHOLD, SATURATION_SCLERA_MAX_THRESHOLD, cv::THRESH_BINARY_INV);
-
-	if (IS_DEBUG || (IS_VIDEO_MODE && IS_DEBUG_VIDEO_MODE))
+	if (isMaskMorphologyActive)
 	{
-		windowNameStringStream << "Sclera " << eyeIndex << " threshold";
-		windowName = windowNameStringStream.str();
-		cv::imshow(windowName, processingImage);
-		cv::moveWindow(windowName, windowOffsetX, windowOffsetY);
-		windowNameStringStream.str("");
-
-		writeResult(windowName, processingImage);
-
-		windowOffsetY += 100;
+		// erosion and dilation are folded into the same passes
+		thresholdMaskMorphology(processingImage, processingImage, parameters, cv::THRESH_BINARY_INV);
+	}
+	else
+	{
+		cv::threshold(processingImage, processingImage, parameters.threshold, parameters.maxThreshold, cv::THRESH_BINARY_INV);
 	}
 
+	KeyDebugTap::tap("Sclera saturation threshold", eyeIndex, processingImage, getScleraSaturationDebugWindowLayout(eyeIndex, 2));
+
 	// end threshold
 
 
 	// start erode
-	if (IS_SATURATION_SCLERA_EROSION_ENABLED)
+	if (!isMaskMorphologyActive && parameters.isErosionEnabled)
 	{
 		const cv::Mat kernel = cv::Mat();
 		const cv::Point anchor = cv::Point(-1, -1);
-		cv::erode(processingImage, processingImage, kernel, anchor, SATURATION_SCLERA_EROSION_ITERATIONS_COUNT);
-
-		if (IS_DEBUG)
-		{
-			windowNameStringStream << "Sclera " << eyeIndex << " erode";
-			windowName = windowNameStringStream.str();
-			cv::imshow(windowName, processingImage);
-			cv::moveWindow(windowName, windowOffsetX, windowOffsetY);
-			windowNameStringStream.str("");
+		cv::erode(processingImage, processingImage, kernel, anchor, parameters.erosionIterationsCount);
 
-			writeResult(windowName, processingImage);
-
-			windowOffsetY += 100;
-		}
+		DebugTap::tap("Sclera saturation erode", eyeIndex, processingImage, getScleraSaturationDebugWindowLayout(eyeIndex, 3));
 	}
 	// end erode
 
 
 	// start dilate
-	if (IS_SATURATION_SCLERA_DILATION_ENABLED)
+	if (!isMaskMorphologyActive && parameters.isDilationEnabled)
 	{
 		const cv::Mat kernel = cv::Mat();
 		const cv::Point anchor = cv::Point(-1, -1);
-		cv::dilate(processingImage, processingImage, kernel, anchor, SATURATION_SCLERA_DILATION_ITERATIONS_COUNT);
-
-		if (IS_DEBUG)
-		{
-			windowNameStringStream << "Sclera " << eyeIndex << " dilate";
-			windowName = windowNameStringStream.str();
-			cv::imshow(windowName, processingImage);
-			cv::moveWindow(windowName, windowOffsetX, windowOffsetY);
-			windowNameStringStream.str("");
+		cv::dilate(processingImage, processingImage, kernel, anchor, parameters.dilationIterationsCount);
 
-			writeResult(windowName, processingImage);
-
-			windowOffsetY += 100;
-		}
+		DebugTap::tap("Sclera saturation dilate", eyeIndex, processingImage, getScleraSaturationDebugWindowLayout(eyeIndex, 4));
 	}
 	// end dilate
 
 
 	// center of mass
 
-	// TODO: check incorrect result by (0, 0)
-	cv::Point center = getCenterOfMass8UC1(processingImage);
+	CenterOfMass centerOfMass = getCenterOfMass8UC1(processingImage);
+	// empty mask, fall back to the image center and report it as not found
+	DetectedCenter detectedCenter = getDetectedCenter(centerOfMass, processingImage.size());
 
 	// end center of mass
 
 
 	// draw center
 
-	if (IS_DEBUG || (IS_VIDEO_MODE && IS_DEBUG_VIDEO_MODE))
-	{
-		int rows = processingImage.rows;
-		int cols = processingImage.cols;
-		
-		int markerSize = std::min(rows, cols);
-		int markerThickness = std::max(markerSize / 100, 1);
-
-		cv::Mat coloredImage = cv::Mat(rows, cols, CV_8UC3);
-
-		cv::cvtColor(processingImage, coloredImage, cv::COLOR_GRAY2BGR);
-
-		if (IS_DRAWING)
-		{
-			cv::drawMarker(coloredImage, center, CV_RGB(255, 0, 0), cv::MARKER_CROSS, markerSize, markerThickness, cv::LINE_8);
-		}
-
-		windowNameStringStream << "Sclera " << eyeIndex << " center";
-		windowName = windowNameStringStream.str();
-		cv::imshow(windowName, coloredImage);
-		cv::moveWindow(windowName, windowOffsetX, windowOffsetY);
-		windowNameStringStream.str("");
-
-		writeResult(windowName, coloredImage);
-
-		windowOffsetY += 100;
-	}
+	KeyDebugTap::tapLazy("Sclera saturation center", eyeIndex, [&]() {
+		return drawCenterOfMassDebugImage(processingImage, detectedCenter.center);
+	}, getScleraSaturationDebugWindowLayout(eyeIndex, 5));
 
 	// end draw center
 
-	return center;
+	return detectedCenter;
 }
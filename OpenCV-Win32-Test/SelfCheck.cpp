@@ -0,0 +1,348 @@
+#include <filesystem>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "SelfCheck.hpp"
+#include "Cascades.hpp"
+#include "CenterOfMass.hpp"
+#include "CvUtils.hpp"
+#include "DebugTap.hpp"
+#include "EyeChannels.hpp"
+#include "EyeDetectors.hpp"
+#include "EyeProcessing.hpp"
+#include "FusedEyeProcessing.hpp"
+#include "MaskMorphology.hpp"
+
+
+bool runSelfChecks(const Parameters& parameters)
+{
+	bool isPassed = true;
+
+	// intermediate images aren't needed
+	setDebugTapSink(nullptr);
+
+	isPassed = checkCenterOfMassDataset() && isPassed;
+	isPassed = checkFusedEyeProcessing(parameters) && isPassed;
+	isPassed = checkMaskMorphology() && isPassed;
+	isPassed = checkEyeChannels() && isPassed;
+	isPassed = checkHaarCascades(parameters) && isPassed;
+
+	std::cout << "Self check " << (isPassed ? "passed" : "failed") << std::endl;
+
+	return isPassed;
+}
+
+
+bool isSameCenterOfMass(const CenterOfMass& first, const CenterOfMass& second)
+{
+	return first.isEmpty == second.isEmpty && (first.isEmpty || first.center == second.center);
+}
+
+
+bool checkCenterOfMass(const std::string& caseName, const cv::Mat& image)
+{
+	CenterOfMass reference = getCenterOfMass8UC1Reference(image);
+
+	bool isPassed = true;
+
+	for (int bandsCount : { 1, 3 })
+	{
+		CenterOfMass centerOfMass = getCenterOfMass8UC1(image, bandsCount);
+
+		if (!isSameCenterOfMass(centerOfMass, reference))
+		{
+			std::cout << "Center of mass mismatch, " << caseName << ", bands " << bandsCount << " : (" <<
+				centerOfMass.center.x << ", " << centerOfMass.center.y << ") instead of (" <<
+				reference.center.x << ", " << reference.center.y << ")" << std::endl;
+			isPassed = false;
+		}
+	}
+
+	return isPassed;
+}
+
+
+bool checkCenterOfMassDataset()
+{
+	bool isPassed = true;
+
+	cv::Mat emptyImage = cv::Mat::zeros(CENTER_OF_MASS_MIN_BAND_ROWS_COUNT, CENTER_OF_MASS_MIN_BAND_ROWS_COUNT, CV_8UC1);
+
+	if (!getCenterOfMass8UC1(emptyImage).isEmpty)
+	{
+		std::cout << "Center of mass of empty mask isn't reported as empty" << std::endl;
+		isPassed = false;
+	}
+
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(CENTER_OF_MASS_DATASET_NAME))
+	{
+		std::string filePath = entry.path().string();
+		std::string fileName = entry.path().filename().string();
+
+		cv::Mat image = cv::imread(filePath, cv::IMREAD_GRAYSCALE);
+
+		if (image.empty())
+		{
+			throw std::runtime_error("Can't read image: " + filePath);
+		}
+
+		// upscaled fixture is wider than vector registers and has odd size for the scalar tail
+		cv::Mat scaledImage;
+		cv::resize(image, scaledImage, cv::Size(), 37, 29, cv::INTER_NEAREST);
+
+		// ROI inside a bright border checks that the row step is respected
+		cv::Mat paddedImage;
+		cv::copyMakeBorder(scaledImage, paddedImage, 3, 5, 7, 11, cv::BORDER_CONSTANT, cv::Scalar(255));
+		cv::Mat roiImage = paddedImage(cv::Rect(7, 3, scaledImage.cols, scaledImage.rows));
+
+		isPassed = checkCenterOfMass(fileName, image) && isPassed;
+		isPassed = checkCenterOfMass(fileName + " scaled", scaledImage) && isPassed;
+		isPassed = checkCenterOfMass(fileName + " ROI", roiImage) && isPassed;
+
+		CenterOfMass centerOfMass = getCenterOfMass8UC1(image);
+		std::cout << fileName << " : (" << centerOfMass.center.x << ", " << centerOfMass.center.y << ")" << std::endl;
+	}
+
+	return isPassed;
+}
+
+
+// fused kernel has to give the same centers as HSV conversion, split and the separate detectors
+bool checkFusedEyeProcessing(const Parameters& parameters)
+{
+	const std::vector<std::string> datasetNames = {
+		"dataset_mobile_camera_480p", "dataset_webcam", "dataset_webcam_light", "dataset_webcam_no_light"
+	};
+	const int cropsPerSideCount = 8;
+
+	// the fused kernel implements the saturation sclera and value pupil detectors only
+	if (!parameters.eyeDetectors.isFused)
+	{
+		std::cout << "Fused eye processing skipped, detectors aren't saturation sclera and value pupil" << std::endl;
+		return true;
+	}
+
+	bool isPassed = true;
+	int checkedCropsCount = 0;
+
+	for (const std::string& datasetName : datasetNames)
+	{
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(datasetName))
+		{
+			std::string filePath = entry.path().string();
+			cv::Mat image = cv::imread(filePath, cv::IMREAD_COLOR);
+
+			if (image.empty())
+			{
+				throw std::runtime_error("Can't read image: " + filePath);
+			}
+
+			cv::Size cropSize = cv::Size(image.cols / cropsPerSideCount, image.rows / (cropsPerSideCount * 2));
+
+			for (int i = 0; i + cropSize.height <= image.rows; i += cropSize.height)
+			{
+				for (int j = 0; j + cropSize.width <= image.cols; j += cropSize.width)
+				{
+					cv::Mat crop = image(cv::Rect(cv::Point(j, i), cropSize));
+
+					EyeCenters expected = detectEyeCentersSeparated(crop, 0, parameters);
+					EyeCenters actual = detectEyeCentersFused(crop, parameters);
+
+					if (actual.scleraCenter != expected.scleraCenter || actual.pupilCenter != expected.pupilCenter)
+					{
+						std::cout << "Fused eye processing mismatch, " << filePath << " at (" << j << ", " << i << ")" << std::endl;
+						isPassed = false;
+					}
+
+					checkedCropsCount++;
+				}
+			}
+		}
+	}
+
+	std::cout << "Fused eye processing crops checked : " << checkedCropsCount << std::endl;
+
+	return isPassed;
+}
+
+
+// single pass morphology has to be bit-identical to cv::threshold, cv::erode and cv::dilate
+bool checkMaskMorphology()
+{
+	const int casesCount = 2000;
+	const int maxSize = 40;
+	const int maxIterationsCount = 5;
+
+	cv::RNG rng(0x5EED);
+	bool isPassed = true;
+
+	for (int caseIndex = 0; caseIndex < casesCount; caseIndex++)
+	{
+		cv::Mat source = cv::Mat(rng.uniform(1, maxSize + 1), rng.uniform(1, maxSize + 1), CV_8UC1);
+		rng.fill(source, cv::RNG::UNIFORM, 0, 256);
+
+		CenterDetectorParameters parameters;
+		parameters.threshold = rng.uniform(-5, 261);
+		parameters.maxThreshold = caseIndex % 7 == 0 ? rng.uniform(0, 2) : 255;
+		parameters.erosionIterationsCount = rng.uniform(0, maxIterationsCount + 1);
+		parameters.isErosionEnabled = rng.uniform(0, 4) != 0;
+		parameters.dilationIterationsCount = rng.uniform(0, maxIterationsCount + 1);
+		parameters.isDilationEnabled = rng.uniform(0, 4) != 0;
+		int thresholdType = caseIndex % 2 == 0 ? cv::THRESH_BINARY : cv::THRESH_BINARY_INV;
+
+		cv::Mat expected;
+		cv::threshold(source, expected, parameters.threshold, parameters.maxThreshold, thresholdType);
+
+		if (parameters.isErosionEnabled)
+		{
+			cv::erode(expected, expected, cv::Mat(), cv::Point(-1, -1), parameters.erosionIterationsCount);
+		}
+
+		if (parameters.isDilationEnabled)
+		{
+			cv::dilate(expected, expected, cv::Mat(), cv::Point(-1, -1), parameters.dilationIterationsCount);
+		}
+
+		cv::Mat actual;
+		thresholdMaskMorphology(source, actual, parameters, thresholdType);
+
+		// in place, as the detectors call it
+		cv::Mat inPlace = source.clone();
+		thresholdMaskMorphology(inPlace, inPlace, parameters, thresholdType);
+
+		if (cv::countNonZero(actual != expected) > 0 || cv::countNonZero(inPlace != expected) > 0)
+		{
+			std::cout << "Mask morphology mismatch, case " << caseIndex << " : " << source.cols << "x" << source.rows <<
+				", threshold " << parameters.threshold << ", erosion " << parameters.erosionIterationsCount <<
+				", dilation " << parameters.dilationIterationsCount << std::endl;
+			isPassed = false;
+		}
+	}
+
+	std::cout << "Mask morphology cases checked : " << casesCount << std::endl;
+
+	return isPassed;
+}
+
+
+bool checkHaarCascade(const std::string& caseName, DetectionCascade& cascade, const cv::Mat& image, double scaleFactor, int minNeighbours)
+{
+	bool isPassed = true;
+
+	// raw candidates show single window differences, grouped objects are what the detection returns
+	for (int neighbours : { 0, minNeighbours })
+	{
+		std::vector<cv::Rect> expected;
+		std::vector<cv::Rect> actual;
+
+		cascade.classifier.detectMultiScale(image, expected, scaleFactor, neighbours, 0);
+		detectHaarCascade(cascade.haarCascade, image, actual, scaleFactor, neighbours, cv::Size(), cv::Size());
+
+		if (!isSameRects(actual, expected))
+		{
+			std::cout << "Haar cascade mismatch, " << caseName << ", min neighbours " << neighbours << " : " <<
+				actual.size() << " rects instead of " << expected.size() << std::endl;
+			isPassed = false;
+		}
+	}
+
+	return isPassed;
+}
+
+
+// the flat evaluator has to find the same windows as cv::CascadeClassifier, eyes are checked on the found faces
+bool checkHaarCascades(const Parameters& parameters)
+{
+	const std::vector<std::string> datasetNames = {
+		"dataset_mobile_camera_480p", "dataset_webcam", "dataset_webcam_light", "dataset_webcam_no_light"
+	};
+
+	DetectionCascade face_cascade = loadCascade(readCascade(FACE_CASCADE_FILE_NAME), "face", true);
+	DetectionCascade eyes_cascade = loadCascade(readCascade(EYES_CASCADE_FILE_NAME), "eyes", true);
+
+	bool isPassed = true;
+	int checkedImagesCount = 0;
+	int checkedFacesCount = 0;
+
+	for (const std::string& datasetName : datasetNames)
+	{
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(datasetName))
+		{
+			std::string filePath = entry.path().string();
+			cv::Mat image = cv::imread(filePath, cv::IMREAD_GRAYSCALE);
+
+			if (image.empty())
+			{
+				throw std::runtime_error("Can't read image: " + filePath);
+			}
+
+			cv::equalizeHist(image, image);
+
+			isPassed = checkHaarCascade(filePath + " face", face_cascade, image, parameters.face.scaleFactor, parameters.face.minNeighbours) && isPassed;
+
+			std::vector<cv::Rect> faceRects;
+			face_cascade.classifier.detectMultiScale(image, faceRects, parameters.face.scaleFactor, parameters.face.minNeighbours, 0);
+
+			for (const cv::Rect& faceRect : faceRects)
+			{
+				isPassed = checkHaarCascade(filePath + " eyes", eyes_cascade, image(faceRect), parameters.eye.scaleFactor, parameters.eye.minNeighbours) && isPassed;
+				checkedFacesCount++;
+			}
+
+			checkedImagesCount++;
+		}
+	}
+
+	std::cout << "Haar cascade images checked : " << checkedImagesCount << ", faces : " << checkedFacesCount << std::endl;
+
+	return isPassed;
+}
+
+
+// planes of any channel set have to be bit-identical to cv::cvtColor and cv::split
+bool checkEyeChannels()
+{
+	const int casesCount = 500;
+	const int maxSize = 64;
+
+	cv::RNG rng(0xC4A7);
+	bool isPassed = true;
+
+	for (int caseIndex = 0; caseIndex < casesCount; caseIndex++)
+	{
+		cv::Mat image = cv::Mat(rng.uniform(1, maxSize + 1), rng.uniform(1, maxSize + 1), CV_8UC3);
+		rng.fill(image, cv::RNG::UNIFORM, 0, 256);
+
+		// submatrix, as the eye crops are
+		cv::Mat eyeImage = image(cv::Rect(0, 0, rng.uniform(1, image.cols + 1), image.rows));
+
+		cv::Mat hsvImage;
+		cv::cvtColor(eyeImage, hsvImage, cv::COLOR_BGR2HSV);
+
+		std::vector<cv::Mat> expected;
+		cv::split(hsvImage, expected);
+
+		int channels = rng.uniform(1, 8);
+
+		cv::Mat hue;
+		cv::Mat saturation;
+		cv::Mat value;
+		computeEyeChannels(eyeImage, channels, hue, saturation, value);
+
+		bool isHueSame = !(channels & EYE_CHANNEL_HUE) || cv::countNonZero(hue != expected[0]) == 0;
+		bool isSaturationSame = !(channels & EYE_CHANNEL_SATURATION) || cv::countNonZero(saturation != expected[1]) == 0;
+		bool isValueSame = !(channels & EYE_CHANNEL_VALUE) || cv::countNonZero(value != expected[2]) == 0;
+
+		if (!isHueSame || !isSaturationSame || !isValueSame)
+		{
+			std::cout << "Eye channels mismatch, case " << caseIndex << " : " << eyeImage.cols << "x" << eyeImage.rows <<
+				", channels " << channels << std::endl;
+			isPassed = false;
+		}
+	}
+
+	std::cout << "Eye channels cases checked : " << casesCount << std::endl;
+
+	return isPassed;
+}
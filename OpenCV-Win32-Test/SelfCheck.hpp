@@ -0,0 +1,17 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+#include <opencv2/core.hpp>
+
+#include "Constants.hpp"
+#include "Parameters.hpp"
+
+
+bool runSelfChecks(const Parameters& parameters);
+bool checkCenterOfMassDataset();
+bool checkFusedEyeProcessing(const Parameters& parameters);
+bool checkMaskMorphology();
+bool checkEyeChannels();
+bool checkHaarCascades(const Parameters& parameters);
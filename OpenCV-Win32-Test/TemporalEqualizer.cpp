@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/imgproc.hpp>
+
+#include "TemporalEqualizer.hpp"
+#include "CvUtils.hpp"
+
+
+// normalized histogram of every samplingStep-th pixel of every samplingStep-th row
+std::array<float, 256> getSampledHistogram(const cv::Mat& image, int samplingStep)
+{
+	std::array<int, 256> histogram = {};
+	int samplesCount = 0;
+
+	for (int row = 0; row < image.rows; row += samplingStep)
+	{
+		const uint8_t* rowPointer = image.ptr<uint8_t>(row);
+
+		for (int col = 0; col < image.cols; col += samplingStep)
+		{
+			histogram[rowPointer[col]]++;
+		}
+
+		samplesCount += (image.cols + samplingStep - 1) / samplingStep;
+	}
+
+	std::array<float, 256> normalizedHistogram;
+
+	for (int i = 0; i < 256; i++)
+	{
+		normalizedHistogram[i] = samplesCount > 0 ? (float)histogram[i] / samplesCount : 0.f;
+	}
+
+	return normalizedHistogram;
+}
+
+
+// half L1 distance, 0 for equal histograms and 1 for disjoint ones
+float getHistogramDrift(const std::array<float, 256>& first, const std::array<float, 256>& second)
+{
+	float distance = 0.f;
+
+	for (int i = 0; i < 256; i++)
+	{
+		distance += std::abs(first[i] - second[i]);
+	}
+
+	return distance / 2;
+}
+
+
+// equalization LUT of the normalized sampled histogram, same construction as cv::equalizeHist
+std::array<float, 256> getSampledEqualizeLut(const std::array<float, 256>& histogram)
+{
+	std::array<float, 256> lut = {};
+
+	int i = 0;
+	while (i < 256 && histogram[i] == 0.f)
+	{
+		i++;
+	}
+
+	if (i == 256)
+	{
+		return lut;
+	}
+
+	if (histogram[i] >= 1.f)
+	{
+		lut.fill((float)i);
+		return lut;
+	}
+
+	float scale = (256 - 1.f) / (1.f - histogram[i]);
+	float sum = 0.f;
+
+	for (lut[i++] = 0.f; i < 256; i++)
+	{
+		sum += histogram[i];
+		lut[i] = std::min(sum * scale, 255.f);
+	}
+
+	return lut;
+}
+
+
+TemporalEqualizer::TemporalEqualizer()
+{
+	referenceHistogram.fill(0.f);
+	smoothedLut.fill(0.f);
+	lut.fill(0);
+}
+
+
+void TemporalEqualizer::equalize(const cv::Mat& source, cv::Mat& destination, const FaceDetectionParameters& parameters)
+{
+	CV_Assert(source.type() == CV_8UC1);
+
+	framesCount++;
+
+	std::array<float, 256> sampledHistogram = getSampledHistogram(source, std::max(parameters.equalizationSamplingStep, 1));
+
+	if (!isInitialized || getHistogramDrift(sampledHistogram, referenceHistogram) > parameters.equalizationRebuildDrift)
+	{
+		rebuild(source, sampledHistogram);
+	}
+	else
+	{
+		std::array<float, 256> sampledLut = getSampledEqualizeLut(sampledHistogram);
+		float smoothing = (float)parameters.equalizationSmoothing;
+
+		for (int i = 0; i < 256; i++)
+		{
+			smoothedLut[i] += smoothing * (sampledLut[i] - smoothedLut[i]);
+			lut[i] = cv::saturate_cast<uint8_t>(smoothedLut[i]);
+		}
+	}
+
+	cv::LUT(source, cv::Mat(1, 256, CV_8UC1, lut.data()), destination);
+}
+
+
+// exact cv::equalizeHist LUT of the full frame, the sampled histogram becomes the drift reference
+void TemporalEqualizer::rebuild(const cv::Mat& source, const std::array<float, 256>& sampledHistogram)
+{
+	int histogram[256] = {};
+
+	for (int row = 0; row < source.rows; row++)
+	{
+		const uint8_t* rowPointer = source.ptr<uint8_t>(row);
+
+		for (int col = 0; col < source.cols; col++)
+		{
+			histogram[rowPointer[col]]++;
+		}
+	}
+
+	buildEqualizeHistLut(histogram, source.rows * source.cols, lut.data());
+
+	for (int i = 0; i < 256; i++)
+	{
+		smoothedLut[i] = lut[i];
+	}
+
+	referenceHistogram = sampledHistogram;
+	isInitialized = true;
+	rebuildsCount++;
+}
+
+
+void TemporalEqualizer::reset()
+{
+	isInitialized = false;
+	framesCount = 0;
+	rebuildsCount = 0;
+}
+
+
+int64 TemporalEqualizer::getFramesCount() const
+{
+	return framesCount;
+}
+
+
+int64 TemporalEqualizer::getRebuildsCount() const
+{
+	return rebuildsCount;
+}
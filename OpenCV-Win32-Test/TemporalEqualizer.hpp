@@ -0,0 +1,36 @@
+#pragma once
+
+#include <array>
+
+#include <opencv2/core.hpp>
+
+#include "Constants.hpp"
+#include "Parameters.hpp"
+
+
+// Histogram equalization for a steady video stream.
+// The histogram is taken on a subsampled grid and the LUT is smoothed over frames,
+// the first frame and frames whose histogram drifted get the exact full resolution LUT.
+// The LUT is applied with cv::LUT in a single pass.
+class TemporalEqualizer
+{
+public:
+	TemporalEqualizer();
+
+	// source and destination may be the same 8-bit single channel Mat
+	void equalize(const cv::Mat& source, cv::Mat& destination, const FaceDetectionParameters& parameters);
+	void reset();
+
+	int64 getFramesCount() const;
+	int64 getRebuildsCount() const;
+
+private:
+	void rebuild(const cv::Mat& source, const std::array<float, 256>& sampledHistogram);
+
+	bool isInitialized = false;
+	std::array<float, 256> referenceHistogram; // normalized, sampled on the last rebuild frame
+	std::array<float, 256> smoothedLut;
+	std::array<uint8_t, 256> lut;
+	int64 framesCount = 0;
+	int64 rebuildsCount = 0;
+};
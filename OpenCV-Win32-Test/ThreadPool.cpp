@@ -0,0 +1,134 @@
+#include <algorithm>
+
+#include "ThreadPool.hpp"
+
+
+// task run by this thread, 0 outside of tasks
+thread_local uint64_t currentTaskId = 0;
+
+
+ThreadPool::ThreadPool(size_t threadsCount)
+{
+	threadsCount = std::max(threadsCount, (size_t)1);
+
+	for (size_t i = 0; i < threadsCount; i++)
+	{
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(tasksMutex);
+		isStopping = true;
+	}
+
+	tasksCondition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+
+size_t ThreadPool::getThreadsCount() const
+{
+	return workers.size();
+}
+
+
+void ThreadPool::pushTask(std::function<void()>&& run)
+{
+	{
+		std::lock_guard<std::mutex> lock(tasksMutex);
+
+		PendingTask task;
+		task.id = ++lastTaskId;
+		task.parentId = currentTaskId;
+		task.run = std::move(run);
+		tasks.push_back(std::move(task));
+	}
+
+	tasksCondition.notify_one();
+	// the parent may be waiting with nothing to run
+	completionCondition.notify_all();
+}
+
+
+void ThreadPool::runTask(PendingTask& task)
+{
+	uint64_t parentTaskId = currentTaskId;
+	currentTaskId = task.id;
+
+	// packaged tasks keep exceptions in their futures
+	task.run();
+
+	currentTaskId = parentTaskId;
+
+	// waiters check their future under the lock, so taking it here means none of them misses the notification
+	{
+		std::lock_guard<std::mutex> lock(tasksMutex);
+	}
+
+	completionCondition.notify_all();
+}
+
+
+void ThreadPool::waitUntil(bool (*isReady)(void*), void* context)
+{
+	std::unique_lock<std::mutex> lock(tasksMutex);
+
+	while (!isReady(context))
+	{
+		std::deque<PendingTask>::iterator childTask = std::find_if(tasks.begin(), tasks.end(), [](const PendingTask& task) {
+			return task.parentId == currentTaskId;
+		});
+
+		if (childTask == tasks.end())
+		{
+			completionCondition.wait(lock);
+			continue;
+		}
+
+		PendingTask task = std::move(*childTask);
+		tasks.erase(childTask);
+
+		lock.unlock();
+		runTask(task);
+		lock.lock();
+	}
+}
+
+
+void ThreadPool::workerLoop()
+{
+	while (true)
+	{
+		PendingTask task;
+
+		{
+			std::unique_lock<std::mutex> lock(tasksMutex);
+			tasksCondition.wait(lock, [this]() { return isStopping || !tasks.empty(); });
+
+			if (isStopping && tasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+
+		runTask(task);
+	}
+}
+
+
+ThreadPool& getProcessingThreadPool()
+{
+	static ThreadPool threadPool(std::thread::hardware_concurrency());
+	return threadPool;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+// Every task remembers the task that enqueued it (0 for threads outside the pool).
+// A waiting task only helps with its own children, so unrelated tasks never nest on its stack,
+// and blocks on a condition when it has none left to run.
+class ThreadPool
+{
+public:
+	explicit ThreadPool(size_t threadsCount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	template <typename Function>
+	std::future<std::invoke_result_t<std::decay_t<Function>>> enqueue(Function&& function);
+
+	// waits for the future and runs the caller's own pending tasks meanwhile, so tasks may wait for nested tasks
+	template <typename Result>
+	Result wait(std::future<Result>& future);
+
+	// waits for every valid future and drops their results and exceptions,
+	// used before rethrowing so that no task outlives the locals it references
+	template <typename Result>
+	void drain(std::vector<std::future<Result>>& futures) noexcept;
+
+	// runs task(index) for every index below count with at most one task per thread enqueued at a time,
+	// the next one is enqueued as the oldest finishes; results are in index order
+	template <typename Function>
+	std::vector<std::invoke_result_t<Function&, size_t>> map(size_t count, Function&& task);
+
+	size_t getThreadsCount() const;
+
+private:
+	struct PendingTask
+	{
+		uint64_t id = 0;
+		uint64_t parentId = 0;
+		std::function<void()> run;
+	};
+
+	void pushTask(std::function<void()>&& run);
+	void runTask(PendingTask& task);
+	void waitUntil(bool (*isReady)(void*), void* context);
+	void workerLoop();
+
+	std::vector<std::thread> workers;
+	std::deque<PendingTask> tasks;
+	std::mutex tasksMutex;
+	std::condition_variable tasksCondition; // a task was enqueued or the pool stops
+	std::condition_variable completionCondition; // a task finished or was enqueued
+	uint64_t lastTaskId = 0;
+	bool isStopping = false;
+};
+
+
+ThreadPool& getProcessingThreadPool();
+
+
+template <typename Function>
+std::future<std::invoke_result_t<std::decay_t<Function>>> ThreadPool::enqueue(Function&& function)
+{
+	typedef std::invoke_result_t<std::decay_t<Function>> Result;
+
+	auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+	std::future<Result> future = task->get_future();
+
+	pushTask([task]() { (*task)(); });
+
+	return future;
+}
+
+
+template <typename Result>
+Result ThreadPool::wait(std::future<Result>& future)
+{
+	waitUntil([](void* context) {
+		return ((std::future<Result>*)context)->wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}, &future);
+
+	return future.get();
+}
+
+
+template <typename Result>
+void ThreadPool::drain(std::vector<std::future<Result>>& futures) noexcept
+{
+	for (std::future<Result>& future : futures)
+	{
+		if (!future.valid())
+		{
+			continue;
+		}
+
+		try
+		{
+			wait(future);
+		}
+		catch (...)
+		{
+		}
+	}
+}
+
+
+template <typename Function>
+std::vector<std::invoke_result_t<Function&, size_t>> ThreadPool::map(size_t count, Function&& task)
+{
+	typedef std::invoke_result_t<Function&, size_t> Result;
+
+	std::vector<std::future<Result>> futures(count);
+	std::vector<Result> results;
+	results.reserve(count);
+
+	size_t enqueuedCount = 0;
+
+	try
+	{
+		for (size_t index = 0; index < count; index++)
+		{
+			for (; enqueuedCount < count && enqueuedCount < index + getThreadsCount(); enqueuedCount++)
+			{
+				futures[enqueuedCount] = enqueue([&task, enqueuedIndex = enqueuedCount]() {
+					return task(enqueuedIndex);
+				});
+			}
+
+			results.push_back(wait(futures[index]));
+		}
+	}
+	catch (...)
+	{
+		drain(futures);
+		throw;
+	}
+
+	return results;
+}
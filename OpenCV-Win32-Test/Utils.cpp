@@ -1,22 +1,30 @@
+#include <atomic>
+#include <cstdlib>
 #include <filesystem>
 #include "Utils.hpp"
+#include "MappedFile.hpp"
+#include "ResultWriter.hpp"
+#include "CvUtils.hpp"
+
+
+// set during static initialization, as close to the process launch as possible
+const int64 startupTicks = cv::getTickCount();
+
 
 std::string getEnvironmentVariable(const std::string& variable)
 {
-	size_t bufferSize = 0;
+	// portable getenv, the value is copied before anything else can touch the environment
+#ifdef _MSC_VER
+#pragma warning(suppress: 4996)
+#endif
+	const char* value = std::getenv(variable.c_str());
 
-	getenv_s(&bufferSize, nullptr, 0, variable.c_str());
-
-	if (bufferSize <= 0)
+	if (value == nullptr)
 	{
 		throw std::runtime_error("Can't find environment variable: " + variable);
 	}
 
-	std::unique_ptr<char[]> buffer(new char[bufferSize]);
-	getenv_s(&bufferSize, buffer.get(), bufferSize, variable.c_str());
-	std::string result = std::move(buffer.get());
-
-	return std::move(result);
+	return value;
 }
 
 
@@ -93,13 +101,49 @@ cv::Mat readImageAsBinaryStream(const std::string& filePath)
 }
 
 
-std::string getImageFileSavePath(const std::string& fileName)
+// decodes straight from the file mapping, the compressed data isn't copied;
+// missing, locked and empty files fall back to cv::imread, so they come back as an empty Mat instead of throwing
+cv::Mat readImageMapped(const std::string& filePath)
+{
+	try
+	{
+		MappedFile mappedFile(filePath);
+
+		cv::Mat data = cv::Mat(1, (int)mappedFile.getSize(), CV_8UC1, (void*)mappedFile.getData());
+		return cv::imdecode(data, cv::IMREAD_COLOR);
+	}
+	catch (const std::runtime_error&)
+	{
+		return cv::imread(filePath, cv::IMREAD_COLOR);
+	}
+}
+
+
+std::string quoteCsvField(const std::string& field)
+{
+	std::string quotedField = "\"";
+
+	for (char character : field)
+	{
+		if (character == '"')
+		{
+			quotedField += '"';
+		}
+
+		quotedField += character;
+	}
+
+	return quotedField + "\"";
+}
+
+
+std::string getImageFileSavePath(const std::string& fileName, const std::string& extension)
 {
-	return RESULT_IMAGE_RELATIVE_PATH + "\\" + fileName + "." + RESULT_IMAGE_EXTENSION;
+	return (std::filesystem::path(RESULT_IMAGE_RELATIVE_PATH) / (fileName + "." + extension)).string();
 }
 
 
-int outputGlobalCounter = 0;
+std::atomic<int> outputGlobalCounter(0);
 
 int getOutputGlobalCounter()
 {
@@ -107,39 +151,52 @@ int getOutputGlobalCounter()
 }
 
 
-std::string getResultFilePath(const std::string& fileName)
+// video mode is chosen at runtime, so the compile-time default is refined once at startup
+std::atomic<bool> isResultImageWriteEnabledFlag(IS_RESULT_IMAGE_WRITRE_ENABLED);
+
+void setResultImageWriteEnabled(bool isEnabled)
+{
+	isResultImageWriteEnabledFlag = IS_RESULT_IMAGE_WRITRE_ENABLED && isEnabled;
+}
+
+
+bool isResultImageWriteEnabled()
+{
+	return isResultImageWriteEnabledFlag;
+}
+
+
+std::string getResultFilePath(const std::string& fileName, const std::string& extension)
 {
 	std::stringstream ss;
 	ss << getOutputGlobalCounter() << "---" << fileName;
-	return getImageFileSavePath(ss.str());
+	return getImageFileSavePath(ss.str(), extension);
 }
 
 
-void writeResult(const std::string& fileName, cv::Mat& image)
+void writeResult(const std::string& fileName, const cv::Mat& image)
 {
-	if (IS_VIDEO_MODE)
+	if (!isResultImageWriteEnabled())
 	{
 		return;
 	}
 
-	if (!IS_RESULT_IMAGE_WRITRE_ENABLED)
+	std::string outputFilePath = getResultFilePath(fileName, getResultImageExtension(image));
+
+	if (IS_RESULT_WRITER_ASYNC)
 	{
-		return;
+		getResultWriter().write(outputFilePath, image);
+	}
+	else
+	{
+		encodeResultImage(outputFilePath, image);
 	}
-
-	std::string outputFilePath = getResultFilePath(fileName);
-	cv::imwrite(outputFilePath, image);
 }
 
 
 void checkResultsFolder()
 {
-	if (IS_VIDEO_MODE)
-	{
-		return;
-	}
-
-	if (!IS_RESULT_IMAGE_WRITRE_ENABLED)
+	if (!isResultImageWriteEnabled())
 	{
 		return;
 	}
@@ -148,3 +205,9 @@ void checkResultsFolder()
 	std::filesystem::remove_all(resultsPath);
 	std::filesystem::create_directory(resultsPath);
 }
+
+
+void reportStartupTime(const std::string& stageName)
+{
+	std::cout << "Startup, " << stageName << ", ms : " << ticksToMilliseconds(cv::getTickCount() - startupTicks) << std::endl;
+}
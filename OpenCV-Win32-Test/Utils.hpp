@@ -3,7 +3,7 @@
 #include <iostream>
 #include <fstream>
 
-#include <opencv2/highgui.hpp>
+#include <opencv2/imgcodecs.hpp>
 
 #include "Constants.hpp"
 
@@ -13,8 +13,14 @@ std::string readTextFile(const std::string& filePath);
 cv::Mat readImage(const std::string& filePath);
 cv::Mat readImageAsBinary(const std::string& filePath);
 cv::Mat readImageAsBinaryStream(const std::string& filePath);
-std::string getImageFileSavePath(const std::string& fileName);
+cv::Mat readImageMapped(const std::string& filePath);
+std::string getImageFileSavePath(const std::string& fileName, const std::string& extension);
 int getOutputGlobalCounter();
-std::string getResultFilePath(const std::string& fileName);
-void writeResult(const std::string& fileName, cv::Mat& image);
+void setResultImageWriteEnabled(bool isEnabled);
+bool isResultImageWriteEnabled();
+std::string getResultFilePath(const std::string& fileName, const std::string& extension);
+// quoted CSV field, quotes inside are doubled
+std::string quoteCsvField(const std::string& field);
+void writeResult(const std::string& fileName, const cv::Mat& image);
 void checkResultsFolder();
+void reportStartupTime(const std::string& stageName);
@@ -0,0 +1,148 @@
+#include <atomic>
+#include <thread>
+
+#include "VideoPipeline.hpp"
+#include "BoundedQueue.hpp"
+#include "CvUtils.hpp"
+
+
+// live sources drop the oldest frame, file sources wait for the next stage
+template <typename T>
+void pushVideoItem(BoundedQueue<T>& queue, T item, bool isLiveSource)
+{
+	if (isLiveSource)
+	{
+		queue.push(std::move(item));
+	}
+	else
+	{
+		queue.pushWaiting(std::move(item));
+	}
+}
+
+
+VideoPipelineStatistics runVideoPipeline(cv::VideoCapture& capture, DetectionCascade& face_cascade, DetectionCascade& eyes_cascade,
+	const Parameters& parameters, bool isLiveSource, const VideoFrameSink& frameSink)
+{
+	BoundedQueue<VideoFrame> capturedFrames(VIDEO_PIPELINE_QUEUE_CAPACITY);
+	BoundedQueue<VideoFrame> detectedFrames(VIDEO_PIPELINE_QUEUE_CAPACITY);
+	BoundedQueue<VideoFrame> analyzedFrames(VIDEO_PIPELINE_QUEUE_CAPACITY);
+	// output frame buffers go back to the capture stage, so capturing doesn't allocate in steady state
+	BoundedQueue<cv::Mat> recycledImages(3 * VIDEO_PIPELINE_QUEUE_CAPACITY + 2);
+
+	std::atomic<bool> isStopping(false);
+	std::atomic<int64> capturedFramesCount(0);
+	FaceTrackingState trackingState;
+
+	// capture stage
+
+	std::thread captureThread([&]() {
+		while (!isStopping)
+		{
+			VideoFrame videoFrame;
+			recycledImages.tryPop(videoFrame.image);
+
+			if (!capture.read(videoFrame.image) || videoFrame.image.empty())
+			{
+				break;
+			}
+
+			videoFrame.frameIndex = capturedFramesCount++;
+			videoFrame.captureTicks = cv::getTickCount();
+
+			pushVideoItem(capturedFrames, std::move(videoFrame), isLiveSource);
+		}
+
+		capturedFrames.close();
+	});
+
+	// end capture stage
+
+
+	// face and eyes detection stage
+
+	std::thread detectionThread([&]() {
+		VideoFrame videoFrame;
+
+		while (capturedFrames.pop(videoFrame))
+		{
+			videoFrame.faceResults = detectFacesAndEyes(face_cascade, eyes_cascade, videoFrame.image, trackingState, parameters);
+			pushVideoItem(detectedFrames, std::move(videoFrame), isLiveSource);
+		}
+
+		detectedFrames.close();
+	});
+
+	// end face and eyes detection stage
+
+
+	// eyes analysis stage
+
+	std::thread analysisThread([&]() {
+		VideoFrame videoFrame;
+
+		while (detectedFrames.pop(videoFrame))
+		{
+			processEyes(videoFrame.image, videoFrame.faceResults, parameters);
+			// results are streamed before the output stage, consumers don't wait for the sink
+			writeFrameResult(makeFrameResult(videoFrame.frameIndex, videoFrame.captureTicks, videoFrame.faceResults));
+			pushVideoItem(analyzedFrames, std::move(videoFrame), isLiveSource);
+		}
+
+		analyzedFrames.close();
+	});
+
+	// end eyes analysis stage
+
+
+	// output stage, the sink runs on the calling thread, HighGUI has to stay on the main thread
+
+	VideoPipelineStatistics statistics;
+
+	VideoFrame videoFrame;
+	while (analyzedFrames.pop(videoFrame))
+	{
+		int64 outputStartTicks = cv::getTickCount();
+		bool isContinuing = !frameSink || frameSink(videoFrame);
+		int64 outputEndTicks = cv::getTickCount();
+
+		statistics.outputFramesCount++;
+		statistics.outputTicksSum += outputEndTicks - outputStartTicks;
+		statistics.latencyTicksSum += outputEndTicks - videoFrame.captureTicks;
+
+		recycledImages.push(std::move(videoFrame.image));
+		videoFrame.faceResults.clear();
+
+		if (!isContinuing)
+		{
+			break;
+		}
+	}
+
+	// end output stage
+
+	isStopping = true;
+
+	capturedFrames.close();
+	detectedFrames.close();
+	analyzedFrames.close();
+
+	captureThread.join();
+	detectionThread.join();
+	analysisThread.join();
+
+	statistics.capturedFramesCount = capturedFramesCount;
+
+	double averageLatency = statistics.outputFramesCount > 0 ? ticksToMilliseconds(statistics.latencyTicksSum) / statistics.outputFramesCount : 0.0;
+	double averageOutput = statistics.outputFramesCount > 0 ? ticksToMilliseconds(statistics.outputTicksSum) / statistics.outputFramesCount : 0.0;
+
+	std::cout << "Captured/Output frames : " << statistics.capturedFramesCount << "/" << statistics.outputFramesCount << std::endl;
+	std::cout << "Dropped frames (capture/detection/analysis) : " << capturedFrames.getDroppedCount() << "/" <<
+		detectedFrames.getDroppedCount() << "/" << analyzedFrames.getDroppedCount() << std::endl;
+	std::cout << "Average capture to output latency, ms : " << averageLatency << std::endl;
+	std::cout << "Average output stage, ms : " << averageOutput << std::endl;
+
+	printFaceTrackingStatistics(trackingState);
+
+	return statistics;
+}
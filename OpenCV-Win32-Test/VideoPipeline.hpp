@@ -0,0 +1,37 @@
+#pragma once
+
+#include <functional>
+
+#include <opencv2/videoio.hpp>
+#include <opencv2/objdetect.hpp>
+
+#include "Constants.hpp"
+#include "FaceProcessing.hpp"
+
+
+struct VideoFrame
+{
+	int64 frameIndex = 0;
+	int64 captureTicks = 0;
+	cv::Mat image;
+	std::vector<FaceDetectionResult> faceResults;
+};
+
+
+// output stage of an analyzed frame, runs on the calling thread, returns false to stop the pipeline
+typedef std::function<bool(VideoFrame& videoFrame)> VideoFrameSink;
+
+
+struct VideoPipelineStatistics
+{
+	int64 capturedFramesCount = 0;
+	int64 outputFramesCount = 0;
+	int64 latencyTicksSum = 0;
+	int64 outputTicksSum = 0;
+};
+
+
+// A live source drops the oldest frame when a stage falls behind, a file source waits and keeps every frame.
+// Without a sink the frames are only analyzed and streamed as results.
+VideoPipelineStatistics runVideoPipeline(cv::VideoCapture& capture, DetectionCascade& face_cascade, DetectionCascade& eyes_cascade,
+	const Parameters& parameters, bool isLiveSource, const VideoFrameSink& frameSink);
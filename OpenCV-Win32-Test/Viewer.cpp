@@ -0,0 +1,123 @@
+#include <opencv2/highgui.hpp>
+
+#include "Viewer.hpp"
+#include "CvUtils.hpp"
+#include "FaceProcessing.hpp"
+#include "Utils.hpp"
+#include "VideoPipeline.hpp"
+
+
+void showDebugWindow(const std::string& tapName, const cv::Mat& image, const DebugWindowLayout& layout)
+{
+	if (layout.sizeDivider > 0)
+	{
+		cv::namedWindow(tapName, cv::WINDOW_NORMAL);
+	}
+
+	cv::imshow(tapName, image);
+
+	if (layout.sizeDivider > 0)
+	{
+		cv::resizeWindow(tapName, image.size() / layout.sizeDivider);
+	}
+
+	if (layout.position.x >= 0 && layout.position.y >= 0)
+	{
+		cv::moveWindow(tapName, layout.position.x, layout.position.y);
+	}
+
+	writeResult(tapName, image);
+}
+
+
+void runViewerCamera(DetectionCascade& face_cascade, DetectionCascade& eyes_cascade, const Parameters& parameters)
+{
+	setDebugTapSink(showDebugWindow);
+
+	int cameraId = 0;
+	cv::VideoCapture capture(cameraId);
+	if (!capture.isOpened())
+	{
+		throw std::runtime_error("Can't use camera with id: " + std::to_string(cameraId));
+	}
+
+	if (parameters.modes.isVideoPipelineActive)
+	{
+		runVideoPipeline(capture, face_cascade, eyes_cascade, parameters, true, [](VideoFrame& videoFrame) {
+			drawFaceDetectionResults(videoFrame.image, videoFrame.faceResults);
+			cv::imshow("Runtime face detection", videoFrame.image);
+
+			return cv::waitKey(1) != 27; // escape
+		});
+		return;
+	}
+
+	FaceTrackingState trackingState;
+	int64 frameIndex = 0;
+
+	cv::Mat frame;
+	while (capture.read(frame))
+	{
+		if (frame.empty())
+		{
+			throw std::runtime_error("Can't read frames from camera with id: " + std::to_string(cameraId));
+		}
+
+		processFaceDetection(face_cascade, eyes_cascade, frame, trackingState, parameters, frameIndex);
+
+		if (frameIndex == 0)
+		{
+			reportStartupTime("first detection");
+		}
+
+		frameIndex++;
+
+		cv::imshow("Runtime face detection", frame);
+
+		if (cv::waitKey(16.6) == 27)
+		{
+			break; // escape
+		}
+	}
+
+	printFaceTrackingStatistics(trackingState);
+}
+
+
+void runViewerTestImage(DetectionCascade& face_cascade, DetectionCascade& eyes_cascade, const Parameters& parameters)
+{
+	setDebugTapSink(showDebugWindow);
+
+	const std::string testImageFilePath = TEST_DATASET_NAME + "/" + TEST_IMAGE_NAME + "." + TEST_IMAGE_EXTENSION;
+	const std::string windowName = TEST_DATASET_NAME + "-" + TEST_IMAGE_NAME;
+
+	//cv::Mat faceImage = readImage(testImageFilePath);
+	//cv::Mat faceImage = readImageAsBinary(testImageFilePath);
+	cv::Mat faceImage = readImageMapped(testImageFilePath);
+	//cv::Mat faceImage = readImageAsBinaryStream(testImageFilePath);
+
+	if (faceImage.empty())
+	{
+		throw std::runtime_error("Can't read image: " + testImageFilePath);
+	}
+
+	float imageWidth = faceImage.cols;
+	float imageHeight = faceImage.rows;
+
+	float aspectRatio = imageWidth / imageHeight;
+
+	float width = DEBUG_RESULT_WINDOW_WIDTH;
+	float height = width / aspectRatio;
+
+	FaceTrackingState trackingState;
+	processFaceDetection(face_cascade, eyes_cascade, faceImage, trackingState, parameters);
+	reportStartupTime("first detection");
+
+	cv::namedWindow(windowName, cv::WINDOW_NORMAL);
+	cv::resizeWindow(windowName, width, height);
+	cv::imshow(windowName, faceImage);
+
+	writeResult(windowName, faceImage);
+
+	cv::waitKey(0);
+}
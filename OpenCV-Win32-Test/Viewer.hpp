@@ -0,0 +1,15 @@
+#pragma once
+
+#include <opencv2/objdetect.hpp>
+
+#include "Cascades.hpp"
+#include "Constants.hpp"
+#include "DebugTap.hpp"
+#include "Parameters.hpp"
+
+
+// Interactive front-end, the only place that uses HighGUI.
+// Debug taps are shown as windows and the frames are displayed until escape is pressed.
+void showDebugWindow(const std::string& tapName, const cv::Mat& image, const DebugWindowLayout& layout);
+void runViewerCamera(DetectionCascade& face_cascade, DetectionCascade& eyes_cascade, const Parameters& parameters);
+void runViewerTestImage(DetectionCascade& face_cascade, DetectionCascade& eyes_cascade, const Parameters& parameters);
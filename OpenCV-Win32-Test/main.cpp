@@ -1,48 +1,82 @@
 #include "Constants.hpp"
 #include "Utils.hpp"
+#include "CvUtils.hpp"
 #include "FaceProcessing.hpp"
-
-
-void processCameraImage(cv::CascadeClassifier& face_cascade, cv::CascadeClassifier& eyes_cascade);
-void processTestFaceImage(cv::CascadeClassifier& face_cascade, cv::CascadeClassifier& eyes_cascade);
+#include "VideoPipeline.hpp"
+#include "SelfCheck.hpp"
+#include "Cascades.hpp"
+#include "BatchProcessing.hpp"
+#include "Benchmark.hpp"
+#include "ParameterSweep.hpp"
+#include "ResultWriter.hpp"
+#include "Parameters.hpp"
+#include "DebugTap.hpp"
+#include "Viewer.hpp"
+#include "HeadlessVideo.hpp"
 
 
 int main(int argc, const char** argv)
 {
 	try
 	{
-		checkResultsFolder();
+		Parameters parameters = loadParameters(argc, argv);
+
+		if (IS_LOGGING)
+		{
+			printParameters(parameters);
+		}
 
-		std::string faceCascadePath = 
-			getEnvironmentVariable(OPENCV_ENVIRONMENT_VARIABLE_NAME) + HAAR_CASCADES_RELATIVE_PATH + "\\" + FACE_CASCADE_FILE_NAME;
-		std::string eyesCascadePath = 
-			getEnvironmentVariable(OPENCV_ENVIRONMENT_VARIABLE_NAME) + HAAR_CASCADES_RELATIVE_PATH + "\\" + EYES_CASCADE_FILE_NAME;
+		setResultImageWriteEnabled(!isVideoMode(parameters));
+		setDebugTapsActive(parameters.modes.isDebugActive, parameters.modes.isDebugVideoActive);
 
-		std::string faceCascadeFileContent = readTextFile(faceCascadePath);
-		std::string eyesCascadeFileContent = readTextFile(eyesCascadePath);
+		// every mode below may queue result images
+		ResultWriterScope resultWriterScope;
 
-		cv::FileStorage faceFileStorage(faceCascadeFileContent, cv::FileStorage::MEMORY);
-		cv::FileStorage eyesFileStorage(eyesCascadeFileContent, cv::FileStorage::MEMORY);
+		if (parameters.applicationMode == ApplicationMode::SELF_CHECK)
+		{
+			return runSelfChecks(parameters) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		checkResultsFolder();
 
-		cv::CascadeClassifier face_cascade;
-		cv::CascadeClassifier eyes_cascade;
+		CascadeFile faceCascadeFile = readCascade(FACE_CASCADE_FILE_NAME);
+		CascadeFile eyesCascadeFile = readCascade(EYES_CASCADE_FILE_NAME);
 
-		if (!face_cascade.read(faceFileStorage.getFirstTopLevelNode()))
+		if (parameters.applicationMode == ApplicationMode::BATCH)
 		{
-			throw std::runtime_error("Can't read face cascade");
+			runBatchProcessing(faceCascadeFile, eyesCascadeFile, parameters);
+			return EXIT_SUCCESS;
 		}
-		if (!eyes_cascade.read(eyesFileStorage.getFirstTopLevelNode()))
+
+		if (parameters.applicationMode == ApplicationMode::BENCHMARK)
 		{
-			throw std::runtime_error("Can't read eyes cascade");
+			runBenchmark(faceCascadeFile, eyesCascadeFile, parameters);
+			return EXIT_SUCCESS;
 		}
 
-		if (IS_VIDEO_MODE)
+		if (parameters.applicationMode == ApplicationMode::SWEEP)
 		{
-			processCameraImage(face_cascade, eyes_cascade);
+			runParameterSweep(faceCascadeFile, eyesCascadeFile, parameters);
+			return EXIT_SUCCESS;
 		}
-		else
+
+		DetectionCascade face_cascade = loadCascade(faceCascadeFile, "face");
+		DetectionCascade eyes_cascade = loadCascade(eyesCascadeFile, "eyes");
+
+		reportStartupTime("cascades loaded, face/eyes cascade cache " + getCascadeCacheStatus(faceCascadeFile) + "/" + getCascadeCacheStatus(eyesCascadeFile));
+
+		switch (parameters.applicationMode)
 		{
-			processTestFaceImage(face_cascade, eyes_cascade);
+		case ApplicationMode::VIDEO:
+			runViewerCamera(face_cascade, eyes_cascade, parameters);
+			break;
+		case ApplicationMode::HEADLESS_VIDEO:
+			runHeadlessVideo(face_cascade, eyes_cascade, parameters);
+			break;
+		case ApplicationMode::TEST_IMAGE:
+		default:
+			runViewerTestImage(face_cascade, eyes_cascade, parameters);
+			break;
 		}
 	}
 	catch (const std::exception& e)
@@ -53,59 +87,3 @@ int main(int argc, const char** argv)
 	
 	return EXIT_SUCCESS;
 }
-
-
-void processCameraImage(cv::CascadeClassifier& face_cascade, cv::CascadeClassifier& eyes_cascade)
-{
-	int cameraId = 0;
-	cv::VideoCapture capture(cameraId);
-	if (!capture.isOpened())
-	{
-		throw std::runtime_error("Can't use camera with id: " + std::to_string(cameraId));
-	}
-
-	cv::Mat frame;
-	while (capture.read(frame))
-	{
-		if (frame.empty())
-		{
-			throw std::runtime_error("Can't read frames from camera with id: " + std::to_string(cameraId));
-		}
-
-		processFaceDetection(face_cascade, eyes_cascade, frame);
-		cv::imshow("Runtime face detection", frame);
-
-		if (cv::waitKey(16.6) == 27)
-		{
-			break; // escape
-		}
-	}
-}
-
-
-void processTestFaceImage(cv::CascadeClassifier& face_cascade, cv::CascadeClassifier& eyes_cascade)
-{
-	const std::string testImageFilePath = TEST_DATASET_NAME + "/" + TEST_IMAGE_NAME + "." + TEST_IMAGE_EXTENSION;
-	const std::string windowName = TEST_DATASET_NAME + "-" + TEST_IMAGE_NAME;
-
-	//cv::Mat faceImage = readImage(testImageFilePath);
-	cv::Mat faceImage = readImageAsBinary(testImageFilePath);
-	//cv::Mat faceImage = readImageAsBinaryStream(testImageFilePath);
-
-	float imageWidth = faceImage.cols;
-	float imageHeight = faceImage.rows;
-
-	float aspectRatio = imageWidth / imageHeight;
-
-	float width = DEBUG_RESULT_WINDOW_WIDTH;
-	float height = width / aspectRatio;
-
-	processFaceDetection(face_cascade, eyes_cascade, faceImage);
-	cv::namedWindow(windowName, cv::WINDOW_NORMAL);
-	cv::resizeWindow(windowName, width, height);
-	cv::imshow(windowName, faceImage);
-
-	writeResult(windowName, faceImage);
-
-	cv::waitKey(0);
-}